@@ -0,0 +1,80 @@
+#ifndef ADAPTIVE_SAMPLER_H
+#define ADAPTIVE_SAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-interface sampling intervals that follow each interface's variability.
+//
+// Every interface starts at the slow base interval. Each sample updates an
+// EWMA of its rate and of the rate's variance. When the coefficient of
+// variation goes above kBurstVariation, the interface's interval is halved
+// (down to the minimum). When it stays below kQuietVariation, the interval
+// is doubled (back up to the base).
+//
+// The global budget caps the total samples per second. If the intervals
+// the interfaces want would exceed it, every interval is raised to a
+// common floor, chosen as the smallest one that fits (water-filling).
+// Quiet interfaces already above the floor are not touched, so the budget
+// is taken from the fastest, burstiest interfaces first. If even the base
+// rate of every interface is over budget, all wanted intervals are
+// stretched by the same factor instead, so bursty interfaces stay faster.
+//
+// Indices are those of the interface stats table; only tracked indices
+// count towards the budget.
+class AdaptiveSampler {
+public:
+    AdaptiveSampler(int64_t min_interval_ns, int64_t base_interval_ns, double budget_per_second);
+
+    void resize(size_t count);
+
+    // Start or stop scheduling an interface; tracked interfaces restart
+    // at the base interval and are due immediately
+    void track(size_t index);
+    void untrack(size_t index);
+
+    // Whether a tracked interface should be sampled at now_ns (steady clock)
+    bool due(size_t index, int64_t now_ns) const;
+    bool anyDue(int64_t now_ns) const;
+
+    // Record that an interface was sampled at now_ns with the given rate;
+    // may change its interval
+    void sampled(size_t index, int64_t now_ns, double rate_bps);
+
+    // Apply the budget after intervals changed (cheap when nothing did)
+    void rebalance();
+
+    // Interval the interface is currently scheduled at
+    int64_t intervalNs(size_t index) const { return effective_ns_[index]; }
+
+    // Samples per second the current schedule takes
+    double demand() const { return demand_; }
+    double budget() const { return budget_; }
+
+private:
+    static const double kBurstVariation;
+    static const double kQuietVariation;
+    static const double kRateFloorBps;
+    static const double kSmoothing;
+
+    double scheduledDemand(int64_t floor_ns) const;
+    void schedule(int64_t floor_ns, double scale);
+
+    int64_t min_interval_ns_;
+    int64_t base_interval_ns_;
+    int64_t tolerance_ns_;          // Half a minimum interval of timer jitter
+    double budget_;
+    double demand_;
+    bool changed_;
+
+    std::vector<uint8_t> tracked_;
+    std::vector<int64_t> wanted_ns_;        // Interval from the variability alone
+    std::vector<int64_t> effective_ns_;     // After the budget
+    std::vector<int64_t> last_ns_;          // Previous sample, 0 = never
+    std::vector<double> mean_;
+    std::vector<double> variance_;
+    std::vector<uint32_t> samples_;
+};
+
+#endif // ADAPTIVE_SAMPLER_H
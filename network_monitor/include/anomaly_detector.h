@@ -0,0 +1,110 @@
+#ifndef ANOMALY_DETECTOR_H
+#define ANOMALY_DETECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Baseline model used for every series of a detector
+enum class AnomalyMethod {
+    EWMA,               // Exponentially weighted mean and variance
+    HOLT_WINTERS        // Additive level + trend + seasonal profile
+};
+
+// Quantities the monitor watches; names appear in alerts and CSV rows
+enum AnomalyMetric {
+    ANOMALY_DOWNLOAD,
+    ANOMALY_UPLOAD,
+    ANOMALY_RTT,
+    ANOMALY_LOSS,
+    kAnomalyMetrics
+};
+
+const char* anomalyMetricName(int metric);
+
+// "ewma" or "holt-winters"
+bool parseAnomalyMethod(const std::string& text, AnomalyMethod& method);
+
+struct AnomalyConfig {
+    AnomalyMethod method;
+    double threshold;           // |z| that raises an alert; it clears below half of it
+    double alpha;               // Per-sample smoothing of the EWMA mean and residual variance
+    double min_deviation;       // Floor of the standard deviation, in the series' unit
+    size_t warmup;              // Samples before a series may alert
+
+    // Holt-Winters: the season is split into a fixed number of time slots.
+    // Samples are averaged per slot, and the model takes one step per slot.
+    // The first season only learns the profile; alerts start after it.
+    int64_t season_ns;
+    size_t season_slots;
+    double level_alpha;
+    double trend_beta;
+    double seasonal_gamma;
+
+    AnomalyConfig()
+        : method(AnomalyMethod::EWMA), threshold(4.0), alpha(0.05), min_deviation(1.0), warmup(30),
+          season_ns(86400LL * 1000000000LL), season_slots(288),
+          level_alpha(0.1), trend_beta(0.01), seasonal_gamma(0.2) {}
+};
+
+// A series entering or leaving the anomalous state
+struct AnomalyEvent {
+    bool active;            // true = alert raised, false = cleared
+    double value;
+    double expected;        // Baseline prediction for this sample
+    double score;           // (value - expected) / standard deviation
+};
+
+// Streaming detectors for many series that share one configuration.
+//
+// Series are addressed by a dense index chosen by the caller (for example
+// stats table index * 2 + direction), so observing a sample is a vector
+// access and a few multiply-adds. There is no lookup and no allocation.
+// EWMA keeps five numbers per series. Holt-Winters adds season_slots
+// seasonal coefficients per series, so the memory stays fixed however long
+// the detector runs. Samples beyond the threshold are clipped before they
+// update the baseline, so a single spike does not drag it along. A lasting
+// shift still raises the variance until the alert clears.
+class AnomalyDetector {
+public:
+    explicit AnomalyDetector(const AnomalyConfig& config);
+
+    const AnomalyConfig& config() const { return config_; }
+
+    // Make room for series [0, count); new series start unlearned
+    void resize(size_t count);
+    size_t size() const { return series_.size(); }
+
+    // Forget a series' baseline (interface recreated, target replaced)
+    void reset(size_t series);
+
+    // Feed one sample taken at wall-clock time_ns. Returns true and fills
+    // event when the series starts or stops being anomalous.
+    bool observe(size_t series, int64_t time_ns, double value, AnomalyEvent& event);
+
+private:
+    struct Series {
+        double mean;            // EWMA: mean; Holt-Winters: level
+        double trend;           // Holt-Winters, per slot
+        double variance;        // Of the residuals against the prediction
+        uint64_t samples;
+        int64_t slot;           // Holt-Winters: current slot number
+        double slot_sum;
+        uint32_t slot_samples;
+        uint32_t slots_closed;  // Holt-Winters: slots seen while learning the first season
+        bool learned;           // A baseline exists
+        bool active;            // Currently alerting
+    };
+
+    void closeSlot(Series& s, size_t series);
+    double& seasonal(size_t series, int64_t slot);
+    double seasonalAt(size_t series, int64_t time_ns);
+
+    AnomalyConfig config_;
+    int64_t slot_ns_;
+    std::vector<Series> series_;
+    std::vector<double> seasonal_;      // season_slots per series, NaN = not seen yet
+};
+
+#endif // ANOMALY_DETECTOR_H
@@ -0,0 +1,36 @@
+#ifndef COUNTER_SNAPSHOT_H
+#define COUNTER_SNAPSHOT_H
+
+#include "interface_stats.h"
+#include <map>
+#include <string>
+
+// Interface counters of a previous run, kept in a small state file so a
+// one-shot measurement can compute a rate without sleeping.
+//
+// The file records the kernel boot ID and, per interface, its ifindex, the
+// CLOCK_MONOTONIC time of the reading and the counters. A snapshot is only
+// used while the boot ID matches (the monotonic clock and counters restart
+// at boot). Each interface must also keep the same ifindex, because a
+// recreated interface starts its counters from zero.
+//
+// File layout (text, one interface per line):
+//   netmonitor-state 1
+//   boot_id <uuid>
+//   <name>\t<ifindex>\t<monotonic_ns>\t<rx_bytes>\t<tx_bytes>\t<rx_packets>\t<tx_packets>
+
+// $XDG_RUNTIME_DIR/netmonitor.state, or /tmp/netmonitor-<uid>/state in a
+// directory created with mode 0700. Returns "" (no snapshot) if that
+// directory exists but is not private to this user.
+std::string defaultCounterSnapshotPath();
+
+// Load the entries that are still valid for this boot and these interfaces.
+// Returns false (and leaves stats empty) if the file is missing, unreadable,
+// from another boot, or not a regular file owned by the effective user and
+// writable only by it.
+bool loadCounterSnapshot(const std::string& path, std::map<std::string, InterfaceStats>& stats);
+
+// Replace the state file atomically (write to a temporary file, then rename)
+bool saveCounterSnapshot(const std::string& path, const std::map<std::string, InterfaceStats>& stats);
+
+#endif // COUNTER_SNAPSHOT_H
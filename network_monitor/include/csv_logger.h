@@ -0,0 +1,97 @@
+#ifndef CSV_LOGGER_H
+#define CSV_LOGGER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <ctime>
+#include <cstddef>
+
+// One row for the CSV writer. Fixed size so it can live in the ring buffer
+// without allocating.
+struct LogRecord {
+    enum Kind { BANDWIDTH, LATENCY, PACKET_LOSS, CONNECTIONS, ALERT };
+
+    Kind kind;
+    time_t wall_time;           // Seconds since the epoch when the row was taken
+    char name[256];             // Interface or host (empty for connections)
+    double values[8];
+    long long counts[4];
+};
+
+// Long-lived CSV writer fed through a lock-free multi-producer ring.
+//
+// A measuring thread only claims a ring slot with one compare-and-swap and
+// copies a LogRecord into it; each slot carries a sequence number that tells
+// the single consumer when the copy is complete, so producers on different
+// threads (daemon collectors) never wait for each other. A background
+// thread formats rows (reusing the timestamp prefix within a second), appends
+// them to a buffer and writes the buffer with one write() when it reaches
+// kFlushBytes, every flush_interval_ms, and on close. It sleeps on an eventfd
+// between flushes; producers only signal it once the ring is filling up.
+//
+// New files start with the header. An existing file is appended to only if
+// it starts with the same header; otherwise it is renamed to the first free
+// <filename>.<n> and a new file is started, so columns never change mid-file.
+class CsvLogger {
+public:
+    CsvLogger(const std::string& filename, const char* header, int flush_interval_ms = 1000);
+    ~CsvLogger();
+
+    // Whether the file could be opened
+    bool isOpen() const { return fd_ >= 0; }
+
+    // Queue a row without locking; waits (yielding) only if the writer has
+    // fallen a full ring behind. Safe to call from several threads.
+    void push(const LogRecord& record);
+
+    // Stop the writer thread after writing everything queued
+    void close();
+
+    // Header line for a record kind
+    static const char* headerFor(LogRecord::Kind kind);
+
+private:
+    CsvLogger(const CsvLogger&);
+    CsvLogger& operator=(const CsvLogger&);
+
+    static const size_t kRingSize = 4096;       // Power of two
+    static const size_t kWakeRecords = kRingSize / 4;
+    static const size_t kFlushBytes = 64 * 1024;
+
+    // A ring slot is free for the producer that claims position p when
+    // sequence == p, and holds a finished record for the consumer when
+    // sequence == p + 1
+    struct Slot {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    void writerLoop();
+    void wakeWriter();
+    void formatRecord(const LogRecord& record);
+    void flushBuffer();
+
+    int fd_;
+    int wake_fd_;                   // eventfd the writer sleeps on
+    int flush_interval_ms_;
+    std::unique_ptr<Slot[]> ring_;
+
+    // Producer and consumer indices padded onto separate cache lines
+    char pad0_[64];
+    std::atomic<size_t> head_;
+    char pad1_[64];
+    std::atomic<size_t> tail_;
+    char pad2_[64];
+    std::atomic<bool> wake_pending_;
+    std::atomic<bool> stopping_;
+
+    std::string buffer_;
+    time_t cached_second_;
+    char cached_prefix_[32];
+    size_t cached_prefix_len_;
+    std::thread writer_;
+};
+
+#endif // CSV_LOGGER_H
@@ -0,0 +1,71 @@
+#ifndef FLOW_TRACKER_H
+#define FLOW_TRACKER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class SockDiagClient;
+
+// Per-flow TCP throughput between two sock_diag snapshots
+struct FlowRate {
+    uint64_t cookie;            // Kernel socket cookie
+    int family;                 // AF_INET or AF_INET6
+    int state;                  // TCP_* state
+    uint8_t local_address[16];  // Network byte order (first 4 bytes for IPv4)
+    uint8_t remote_address[16];
+    uint16_t local_port;        // Host byte order
+    uint16_t remote_port;
+    double tx_bps;              // Rate of bytes acked by the peer
+    double rx_bps;              // Rate of bytes received
+    double delivery_bps;        // Kernel delivery-rate estimate (0 if unknown)
+    double rtt_ms;              // Smoothed RTT
+};
+
+// Ranks TCP flows by throughput using tcp_info from sock_diag.
+//
+// Each sample() dumps every connected TCP socket with INET_DIAG_INFO and
+// updates a hash map keyed by socket cookie, so rates come from the byte
+// counters of the same socket in consecutive snapshots. Sockets that are gone
+// are dropped by generation stamp. topK() keeps a size-K min-heap while
+// scanning the map, which costs O(n log K) instead of sorting every flow.
+class TcpFlowTracker {
+public:
+    explicit TcpFlowTracker(SockDiagClient& client);
+
+    // Take a snapshot. Flows seen for the first time get a rate on the
+    // next sample.
+    bool sample();
+
+    // Up to k flows with the highest tx + rx rate, busiest first. Idle
+    // flows are never reported.
+    void topK(size_t k, std::vector<FlowRate>& out) const;
+
+    // Sockets in the last snapshot
+    size_t flowCount() const { return flows_.size(); }
+
+    // Sockets that moved data since the previous snapshot
+    size_t activeCount() const { return active_; }
+
+private:
+    struct FlowEntry {
+        FlowRate rate;
+        uint64_t bytes_acked;
+        uint64_t bytes_received;
+        uint64_t generation;    // Last snapshot that saw the socket
+        bool has_rate;
+    };
+
+    TcpFlowTracker(const TcpFlowTracker&);
+    TcpFlowTracker& operator=(const TcpFlowTracker&);
+
+    SockDiagClient& client_;
+    std::unordered_map<uint64_t, FlowEntry> flows_;
+    uint64_t generation_;
+    size_t active_;
+    std::chrono::steady_clock::time_point last_sample_;
+};
+
+#endif // FLOW_TRACKER_H
@@ -0,0 +1,67 @@
+#ifndef ICMP_PROBER_H
+#define ICMP_PROBER_H
+
+#include "icmp_socket.h"
+#include <chrono>
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+// Settings for a windowed echo run
+struct ProbeWindowOptions {
+    int count;          // Number of probes to send
+    int interval_ms;    // Time between consecutive sends
+    int window;         // Maximum number of unanswered probes in flight
+    int timeout_ms;     // Time after which an unanswered probe counts as lost
+};
+
+// Counters for a windowed echo run
+struct ProbeWindowResult {
+    int sent;
+    int received;       // Replies that arrived before their timeout
+    int late;           // Replies that arrived after their probe timed out
+    int duplicates;     // Extra replies for an already answered probe
+    TimestampSource clock_source;   // Least precise clock used for any RTT
+};
+
+// Pipelined ICMP echo prober.
+//
+// Probes are sent on a fixed schedule and up to `window` of them can be
+// outstanding at once. A single epoll loop waits on the socket and a timerfd
+// armed for the next send or timeout deadline, and replies are matched to a
+// per-sequence table, so a reply for an older probe is never discarded while
+// a newer one is waited for. Run time is about count * interval + timeout.
+// RTTs use kernel timestamps when the socket has them enabled.
+class WindowedProber {
+public:
+    // Called for every in-time reply with the probe number (1-based) and RTT
+    typedef std::function<void(int probe, double rtt_ms)> ReplyHandler;
+
+    WindowedProber();
+    ~WindowedProber();
+
+    bool run(IcmpSocket& socket, const struct sockaddr_in& dest, uint16_t id,
+             const ProbeWindowOptions& options, const ReplyHandler& on_reply,
+             ProbeWindowResult& result);
+
+private:
+    WindowedProber(const WindowedProber&);
+    WindowedProber& operator=(const WindowedProber&);
+
+    enum SlotState : uint8_t { UNSENT, IN_FLIGHT, REPLIED, TIMED_OUT };
+
+    struct Slot {
+        PacketTimestamps sent;
+        SlotState state;
+    };
+
+    int epoll_fd_;
+    int timer_fd_;
+    std::vector<Slot> slots_;
+    std::vector<int> tx_key_probe_;     // Kernel send timestamp key -> probe
+
+    bool setup(int socket_fd);
+    void armTimer(std::chrono::steady_clock::time_point deadline);
+};
+
+#endif // ICMP_PROBER_H
@@ -0,0 +1,92 @@
+#ifndef ICMP_SOCKET_H
+#define ICMP_SOCKET_H
+
+#include <chrono>
+#include <cstdint>
+#include <netinet/in.h>
+
+// Internet checksum (RFC 1071) over a buffer
+unsigned short icmpChecksum(const void* data, int length);
+
+// Clock used for an RTT sample, from least to most precise
+enum class TimestampSource {
+    USERSPACE,      // steady_clock around sendto()/recvfrom()
+    KERNEL_RX,      // Kernel receive timestamp, userspace send time
+    KERNEL,         // Kernel software timestamps on send and receive
+    HARDWARE        // NIC hardware timestamps on send and receive
+};
+
+const char* timestampSourceName(TimestampSource source);
+
+// Send or receive times of one packet. Kernel times are in nanoseconds,
+// 0 when the kernel did not provide them.
+struct PacketTimestamps {
+    std::chrono::steady_clock::time_point user;
+    long long user_realtime_ns;     // CLOCK_REALTIME next to `user`
+    long long software_ns;          // Kernel software timestamp (CLOCK_REALTIME)
+    long long hardware_ns;          // Raw NIC hardware timestamp
+};
+
+// RTT in milliseconds from the best clock available on both sides
+double computeRtt(const PacketTimestamps& sent, const PacketTimestamps& received,
+                  TimestampSource& source);
+
+// Fold one error-queue entry into a probe's send times. The kernel reports
+// software and hardware send stamps as separate entries for the same key,
+// so only the fields this entry carries are taken.
+void mergeTxTimestamps(PacketTimestamps& sent, const PacketTimestamps& entry);
+
+// An ICMP echo reply read from the socket
+struct IcmpEchoReply {
+    uint16_t id;
+    uint16_t sequence;
+    struct sockaddr_in from;
+    PacketTimestamps timestamps;
+};
+
+// Raw ICMP socket for echo probes (requires root or CAP_NET_RAW)
+class IcmpSocket {
+public:
+    IcmpSocket();
+    ~IcmpSocket();
+
+    // Create the socket; non-blocking sockets are meant for epoll loops
+    bool open(bool nonblocking);
+    void close();
+    int fd() const { return sock_; }
+
+    bool setReceiveTimeout(int timeout_ms);
+
+    // Ask the kernel for send/receive timestamps (SO_TIMESTAMPING, falling
+    // back to receive-only SO_TIMESTAMPNS). Hardware timestamps are used when
+    // the NIC has been configured to produce them. Returns false if neither
+    // option is supported; userspace timing is used then.
+    bool enableTimestamps();
+    bool txTimestampsEnabled() const { return tx_timestamps_; }
+
+    // Send an echo request. `sent` receives the userspace send time and
+    // `tx_key` the key under which a kernel send timestamp will be reported.
+    bool sendEcho(const struct sockaddr_in& dest, uint16_t id, uint16_t sequence,
+                  PacketTimestamps* sent = nullptr, uint32_t* tx_key = nullptr);
+
+    // Read the next echo reply, skipping other ICMP traffic.
+    // Returns 1 on a reply, 0 when nothing is pending (or on timeout), -1 on error.
+    int receiveEcho(IcmpEchoReply& reply);
+
+    // Read one kernel send timestamp from the error queue. Only the kernel
+    // fields of `sent` are set, to this entry's values (0 for a clock the
+    // entry does not carry; see mergeTxTimestamps()). Returns 1 if one was
+    // read, 0 otherwise.
+    int receiveTxTimestamp(uint32_t& tx_key, PacketTimestamps& sent);
+
+private:
+    IcmpSocket(const IcmpSocket&);
+    IcmpSocket& operator=(const IcmpSocket&);
+
+    int sock_;
+    bool rx_timestamps_;
+    bool tx_timestamps_;
+    uint32_t next_tx_key_;
+};
+
+#endif // ICMP_SOCKET_H
@@ -0,0 +1,74 @@
+#ifndef INTERFACE_HISTORY_H
+#define INTERFACE_HISTORY_H
+
+#include "interface_stats.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Counters kept in the history, in InterfaceStats order
+enum HistoryCounter {
+    HISTORY_RX_BYTES,
+    HISTORY_TX_BYTES,
+    HISTORY_RX_PACKETS,
+    HISTORY_TX_PACKETS,
+    HISTORY_RX_ERRORS,
+    HISTORY_RX_DROPPED,
+    HISTORY_RX_FIFO,
+    HISTORY_RX_FRAME,
+    HISTORY_RX_COMPRESSED,
+    HISTORY_RX_MULTICAST,
+    HISTORY_TX_ERRORS,
+    HISTORY_TX_DROPPED,
+    HISTORY_TX_FIFO,
+    HISTORY_TX_COLLISIONS,
+    HISTORY_TX_CARRIER,
+    HISTORY_TX_COMPRESSED,
+    kHistoryCounters
+};
+
+// Per-second rates of one counter over a window
+struct RateSummary {
+    size_t samples;         // Readings in the window
+    double seconds;         // Time between the first and last reading
+    double min;             // Lowest rate between consecutive readings
+    double max;             // Highest rate between consecutive readings
+    double avg;             // (last - first) / seconds
+    double last;            // Rate between the two newest readings
+};
+
+// Fixed-size ring of interface readings, stored as one array per counter.
+//
+// A windowed query over one counter walks that counter's array and the
+// timestamp array in order (at most two contiguous runs because of the
+// wrap). It never touches the other counters and never goes back to the
+// kernel. Intervals where a counter went backwards (interface recreated)
+// are skipped.
+class InterfaceHistory {
+public:
+    explicit InterfaceHistory(size_t capacity);
+
+    // Record a reading, overwriting the oldest one when full
+    void append(const InterfaceStats& stats);
+
+    size_t size() const { return count_; }
+    size_t capacity() const { return timestamps_.size(); }
+
+    // Rates of a counter over the readings of the last window_ns (0 = all).
+    // Returns false with fewer than two readings in the window.
+    bool rates(HistoryCounter counter, int64_t window_ns, RateSummary& summary) const;
+
+private:
+    std::vector<int64_t> timestamps_;                   // steady_clock ns
+    std::vector<uint64_t> counters_[kHistoryCounters];
+    size_t head_;           // Next slot to write
+    size_t count_;
+
+    // Physical slot of the i-th oldest reading
+    size_t slot(size_t logical) const {
+        size_t index = head_ + timestamps_.size() - count_ + logical;
+        return index >= timestamps_.size() ? index - timestamps_.size() : index;
+    }
+};
+
+#endif // INTERFACE_HISTORY_H
@@ -0,0 +1,39 @@
+#ifndef INTERFACE_STATS_H
+#define INTERFACE_STATS_H
+
+#include <string>
+#include <chrono>
+
+// Structure to hold network interface statistics
+struct InterfaceStats {
+    std::string interface_name;
+    unsigned long long bytes_received;
+    unsigned long long bytes_sent;
+    unsigned long long packets_received;
+    unsigned long long packets_sent;
+    
+    // Remaining /proc/net/dev columns (netlink counters are folded the same way)
+    unsigned long long receive_errors;
+    unsigned long long receive_dropped;         // Includes missed
+    unsigned long long receive_fifo_errors;
+    unsigned long long receive_frame_errors;    // Length, overrun, CRC and frame
+    unsigned long long receive_compressed;
+    unsigned long long receive_multicast;
+    unsigned long long transmit_errors;
+    unsigned long long transmit_dropped;
+    unsigned long long transmit_fifo_errors;
+    unsigned long long transmit_collisions;
+    unsigned long long transmit_carrier_errors; // Carrier, aborted, window and heartbeat
+    unsigned long long transmit_compressed;
+    
+    std::chrono::steady_clock::time_point timestamp;
+    
+    InterfaceStats()
+        : bytes_received(0), bytes_sent(0), packets_received(0), packets_sent(0),
+          receive_errors(0), receive_dropped(0), receive_fifo_errors(0), receive_frame_errors(0),
+          receive_compressed(0), receive_multicast(0), transmit_errors(0), transmit_dropped(0),
+          transmit_fifo_errors(0), transmit_collisions(0), transmit_carrier_errors(0),
+          transmit_compressed(0) {}
+};
+
+#endif // INTERFACE_STATS_H
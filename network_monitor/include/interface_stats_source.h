@@ -0,0 +1,89 @@
+#ifndef INTERFACE_STATS_SOURCE_H
+#define INTERFACE_STATS_SOURCE_H
+
+#include "interface_stats.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Base class for interface counter collectors.
+//
+// A source keeps a flat table of InterfaceStats. An interface keeps its
+// index for as long as it is present, so callers can hold on to an index
+// across samples. Rows of interfaces that vanish are reused for new ones;
+// rowId() changes when that happens, so per-index state can be reset.
+// Backends only differ in how sample() fills the table.
+//
+// Lookups try the row seen at the same listing position last time, then a
+// name hash, so a sample stays O(N) after interfaces come and go, and the
+// table only allocates when it grows past its largest size so far.
+class InterfaceStatsSource {
+public:
+    InterfaceStatsSource();
+    virtual ~InterfaceStatsSource();
+
+    // Take a new snapshot of every interface
+    virtual bool sample() = 0;
+
+    // Short backend name for messages ("proc", "netlink")
+    virtual const char* name() const = 0;
+
+    // Number of table rows, including free ones (indices are [0, size()))
+    size_t size() const { return table_.size(); }
+
+    // Stats for a table index (valid until the next sample())
+    const InterfaceStats& at(size_t index) const { return table_[index]; }
+
+    // Whether the interface was present in the most recent sample
+    bool present(size_t index) const { return seen_[index] == sample_seq_; }
+
+    // Identity of the interface in a row: unique for every insert, 0 if free
+    unsigned long long rowId(size_t index) const { return row_ids_[index]; }
+
+    // Index for an interface name, or -1 if it has never been seen
+    int findIndex(const std::string& name) const;
+
+    // Incremented every time an interface is added to (or reuses) a row
+    unsigned long long generation() const { return generation_; }
+
+protected:
+    // Start a new sample; rows not marked afterwards are reported as absent.
+    // Rows that were absent from the last completed sample are freed for
+    // reuse, so a failed sample never retires interfaces it did not reach.
+    void beginSample();
+
+    // Mark the current sample as complete (call only when sample() succeeds)
+    void commitSample() { committed_seq_ = sample_seq_; }
+
+    // Mark a table row as present in the current sample
+    void markPresent(size_t index) { seen_[index] = sample_seq_; }
+
+    // Locate an interface row, adding it if it is new. hint is the row's
+    // position in the kernel's listing, which is tried first.
+    size_t findOrInsert(const char* name, size_t name_len, size_t hint);
+
+    InterfaceStats& row(size_t index) { return table_[index]; }
+
+private:
+    InterfaceStatsSource(const InterfaceStatsSource&);
+    InterfaceStatsSource& operator=(const InterfaceStatsSource&);
+
+    size_t hashSlot(const char* name, size_t name_len) const;
+    size_t lookup(const char* name, size_t name_len) const;
+    void hashInsert(size_t index);
+    void hashErase(size_t index);
+    void releaseRow(size_t index);
+
+    std::vector<InterfaceStats> table_;
+    std::vector<unsigned long long> seen_;
+    std::vector<unsigned long long> row_ids_;
+    std::vector<size_t> free_rows_;
+    std::vector<size_t> position_rows_;     // Listing position -> row, from earlier samples
+    std::vector<size_t> slots_;             // Open-addressing name hash, row + 1 (0 = empty)
+    unsigned long long sample_seq_;
+    unsigned long long committed_seq_;      // Last sample that completed
+    unsigned long long generation_;
+    unsigned long long next_row_id_;
+};
+
+#endif // INTERFACE_STATS_SOURCE_H
@@ -0,0 +1,42 @@
+#ifndef INTERVAL_TIMER_H
+#define INTERVAL_TIMER_H
+
+#include <chrono>
+#include <cstdint>
+
+// Periodic wake-ups on absolute CLOCK_MONOTONIC deadlines.
+//
+// The timerfd is armed once with TFD_TIMER_ABSTIME, so deadlines stay at
+// start + k * period no matter how long the work between waits takes.
+// When work overruns one or more periods the kernel counts the expirations;
+// wait() reports them as missed deadlines instead of silently stretching
+// the interval.
+class IntervalTimer {
+public:
+    IntervalTimer();
+    ~IntervalTimer();
+
+    // Arm the timer; the first deadline is one period from now
+    bool start(std::chrono::nanoseconds period);
+
+    // Block until the next deadline. missed is set to the number of
+    // deadlines that passed before this wait. Returns false when a shutdown
+    // is requested or the timer fails.
+    bool wait(uint64_t& missed);
+
+    // Deadlines missed since start()
+    uint64_t missedTotal() const { return missed_total_; }
+
+    // Deadlines reached since start() (including missed ones)
+    uint64_t ticks() const { return ticks_; }
+
+private:
+    IntervalTimer(const IntervalTimer&);
+    IntervalTimer& operator=(const IntervalTimer&);
+
+    int fd_;
+    uint64_t missed_total_;
+    uint64_t ticks_;
+};
+
+#endif // INTERVAL_TIMER_H
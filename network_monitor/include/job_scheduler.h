@@ -0,0 +1,81 @@
+#ifndef JOB_SCHEDULER_H
+#define JOB_SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Small worker pool that runs periodic jobs from a deadline-ordered queue.
+//
+// Each periodic job has its own period and absolute next deadline; idle
+// workers sleep until the earliest deadline. A job never overlaps itself:
+// it is re-queued only after it returns, and periods it overran are skipped
+// and counted instead of being run back to back. Long-running tasks (event
+// loops with their own timing) permanently occupy one worker each, so the
+// pool must be at least as large as the number of tasks plus the number of
+// periodic jobs that may block.
+class JobScheduler {
+public:
+    typedef std::function<void()> Job;
+
+    explicit JobScheduler(size_t workers);
+    ~JobScheduler();
+
+    // Run job every period, the first time right away
+    void addPeriodic(const std::string& name, std::chrono::nanoseconds period, const Job& job);
+
+    // Run a long-lived task once; on_stop must make it return
+    void addTask(const std::string& name, const Job& task, const Job& on_stop);
+
+    // Start the workers and block until SIGINT/SIGTERM or stop()
+    void run();
+
+    // Ask run() to return (safe from any thread, including jobs)
+    void stop();
+
+    size_t jobCount() const { return jobs_.size(); }
+    const std::string& jobName(size_t index) const { return jobs_[index].name; }
+
+    // Runs completed and periods skipped because the job overran
+    uint64_t runs(size_t index) const;
+    uint64_t skipped(size_t index) const;
+
+private:
+    JobScheduler(const JobScheduler&);
+    JobScheduler& operator=(const JobScheduler&);
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct JobEntry {
+        std::string name;
+        Job job;
+        Job on_stop;                    // Tasks only
+        Clock::duration period;         // Zero for tasks
+        uint64_t runs;
+        uint64_t skipped;
+    };
+
+    // Queue entry; the queue is a min-heap on deadline
+    struct Pending {
+        Clock::time_point deadline;
+        size_t job;
+        bool operator<(const Pending& other) const { return deadline > other.deadline; }
+    };
+
+    void workerLoop();
+
+    size_t worker_count_;
+    std::vector<JobEntry> jobs_;
+    std::vector<Pending> queue_;
+    std::vector<std::thread> workers_;
+    mutable std::mutex mutex_;
+    std::condition_variable wakeup_;
+    bool stopping_;
+};
+
+#endif // JOB_SCHEDULER_H
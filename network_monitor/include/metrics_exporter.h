@@ -0,0 +1,101 @@
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include "triple_buffer.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Latest counters and rates of one interface
+struct InterfaceMetric {
+    std::string name;
+    unsigned long long bytes_received;
+    unsigned long long bytes_sent;
+    unsigned long long packets_received;
+    unsigned long long packets_sent;
+    double download_bps;
+    double upload_bps;
+};
+
+// Latest report window and running totals of one probe target
+struct ProbeMetric {
+    std::string host;
+    unsigned long long sent_total;
+    unsigned long long received_total;
+    unsigned long long lost_total;
+    double loss_ratio;          // Last report window
+    double rtt_min_ms;
+    double rtt_avg_ms;
+    double rtt_max_ms;
+    double rtt_p50_ms;
+    double rtt_p90_ms;
+    double rtt_p99_ms;
+    double jitter_ms;
+    bool has_rtt;
+};
+
+struct ConnectionMetric {
+    bool valid;
+    int tcp_total;
+    int tcp_established;
+    int udp_total;
+};
+
+// Section of the snapshot written by one collector
+template <typename T>
+struct MetricsSection {
+    T data;
+    int64_t updated_ms;         // Wall clock of the last publish (0 = never)
+
+    MetricsSection() : data(), updated_ms(0) {}
+};
+
+// Embedded HTTP endpoint serving GET /metrics in OpenMetrics text format.
+//
+// Each collector owns one section and publishes it through a triple buffer,
+// so a collector never waits for a scrape and a scrape never blocks a
+// collector. The serving thread accepts one connection at a time with
+// socket timeouts; a slow scraper only delays other scrapers.
+class MetricsExporter {
+public:
+    MetricsExporter();
+    ~MetricsExporter();
+
+    // Listen on address:port and start the serving thread
+    bool start(const std::string& address, int port);
+    void stop();
+
+    // Collector side: fill writeBuffer() completely, then publish()
+    TripleBuffer<MetricsSection<std::vector<InterfaceMetric> > >& interfaces() { return interfaces_; }
+    TripleBuffer<MetricsSection<std::vector<ProbeMetric> > >& probes() { return probes_; }
+    TripleBuffer<MetricsSection<ConnectionMetric> >& connections() { return connections_; }
+
+    // Port actually bound (useful with port 0)
+    int port() const { return port_; }
+
+private:
+    MetricsExporter(const MetricsExporter&);
+    MetricsExporter& operator=(const MetricsExporter&);
+
+    void serveLoop();
+    void handleClient(int fd);
+    void render(std::string& out);
+
+    TripleBuffer<MetricsSection<std::vector<InterfaceMetric> > > interfaces_;
+    TripleBuffer<MetricsSection<std::vector<ProbeMetric> > > probes_;
+    TripleBuffer<MetricsSection<ConnectionMetric> > connections_;
+
+    int listen_fd_;
+    int port_;
+    std::atomic<bool> stopping_;
+    std::thread thread_;
+    std::string body_;          // Reused render buffer (serving thread only)
+    std::string response_;
+};
+
+// Wall clock in milliseconds since the epoch
+int64_t metricsNowMs();
+
+#endif // METRICS_EXPORTER_H
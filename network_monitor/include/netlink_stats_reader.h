@@ -0,0 +1,31 @@
+#ifndef NETLINK_STATS_READER_H
+#define NETLINK_STATS_READER_H
+
+#include "interface_stats_source.h"
+#include <vector>
+#include <cstddef>
+
+// Interface counters over rtnetlink.
+//
+// Each sample sends one RTM_GETLINK dump request on a long-lived
+// NETLINK_ROUTE socket and copies IFLA_STATS64 (struct rtnl_link_stats64)
+// straight into the flat table. The kernel does no text formatting and
+// nothing has to be parsed as numbers in userspace.
+class NetlinkStatsReader : public InterfaceStatsSource {
+public:
+    NetlinkStatsReader();
+    ~NetlinkStatsReader();
+
+    bool sample();
+    const char* name() const { return "netlink"; }
+
+private:
+    int sock_;
+    unsigned int seq_;
+    std::vector<char> buffer_;
+
+    bool openSocket();
+    bool sendDumpRequest();
+};
+
+#endif // NETLINK_STATS_READER_H
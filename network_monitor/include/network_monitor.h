@@ -5,15 +5,29 @@
 #include <map>
 #include <vector>
 #include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include "interface_stats.h"
+#include "interface_stats_source.h"
+#include "icmp_socket.h"
+#include "rtt_histogram.h"
+#include "rollup_store.h"
+#include "metrics_exporter.h"
+#include "proc_net_parser.h"
+#include "interface_history.h"
+#include "anomaly_detector.h"
+#include "adaptive_sampler.h"
 
-// Structure to hold network interface statistics
-struct InterfaceStats {
-    std::string interface_name;
-    unsigned long long bytes_received;
-    unsigned long long bytes_sent;
-    unsigned long long packets_received;
-    unsigned long long packets_sent;
-    std::chrono::steady_clock::time_point timestamp;
+// One bandwidth measurement: two counter readings of an interface
+struct BandwidthResult {
+    std::string interface;
+    bool success;
+    InterfaceStats current;     // Second reading
+    double download_bps;
+    double upload_bps;
+    double interval_seconds;    // Time between the two readings
+    bool from_snapshot;         // First reading came from a previous run's state file
 };
 
 // Structure to hold latency measurement results
@@ -21,6 +35,7 @@ struct LatencyResult {
     double rtt_ms;          // Round-trip time in milliseconds
     bool success;           // Whether the ping was successful
     std::string host;       // Target host
+    TimestampSource clock_source;   // Clock the RTT was measured with
 };
 
 // Structure to hold packet loss statistics
@@ -32,8 +47,69 @@ struct PacketLossStats {
     double max_rtt;
     double avg_rtt;
     double jitter;          // Standard deviation of RTT
+    double p50_rtt;
+    double p90_rtt;
+    double p99_rtt;
+    double p999_rtt;
+    int late_replies;       // Replies received after the probe timed out
+    int duplicate_replies;  // Repeated replies for an answered probe
+    TimestampSource clock_source;   // Least precise clock used for any RTT
+    RttHistogram rtt_histogram;     // Every RTT sample, mergeable across runs
 };
 
+// Structure to hold connection counts
+struct ConnectionStats {
+    int tcp_total;
+    int tcp_established;
+    int udp_total;
+};
+
+// TCP sockets by state plus socket churn since the previous sample
+struct ConnectionStateSample {
+    uint64_t tcp_states[kTcpStateSlots];    // Indexed by TCP state (TCP_ESTABLISHED, ...)
+    uint64_t tcp_total;
+    uint64_t udp_total;
+    uint64_t opened;            // Sockets that appeared since the previous sample
+    uint64_t closed;            // Sockets that went away (including into TIME_WAIT)
+    bool has_churn;             // False for the first sample
+    double interval_seconds;    // Time since the previous sample
+};
+
+// Interface counter collectors
+enum class StatsBackend {
+    PROC_NET_DEV,   // Text parsing of /proc/net/dev
+    NETLINK         // RTM_GETLINK dump with IFLA_STATS64
+};
+
+// Connection statistics collectors
+enum class ConnectionBackend {
+    PROC_NET,       // Parallel text parsing of /proc/net/{tcp,udp}{,6}
+    SOCK_DIAG       // NETLINK_SOCK_DIAG with kernel-side state filtering
+};
+
+// Collectors and schedules for --daemon
+struct DaemonOptions {
+    std::vector<std::string> interfaces;    // Interface selectors for bandwidth
+    int bandwidth_interval_ms;
+    std::string targets_file;               // Probe target list ("" = no probing)
+    int probe_report_interval_ms;
+    int probe_timeout_ms;
+    int probe_default_interval_ms;
+    int connections_interval_ms;            // 0 = no connection statistics
+    std::string log_file;                   // CSV base name ("" = no CSV)
+    bool dashboard;                         // Live full-screen view instead of lines (TTY only)
+};
+
+class SockDiagClient;
+class ProcNetTableParser;
+class SocketChurnTracker;
+class ResolverCache;
+class ProbeSession;
+class CsvLogger;
+class ProbeScheduler;
+class ShmPublisher;
+class TerminalScreen;
+
 // Main Network Monitor class
 class NetworkMonitor {
 public:
@@ -41,51 +117,235 @@ public:
     ~NetworkMonitor();
     
     // Bandwidth monitoring
+    bool setStatsBackend(StatsBackend backend);
     bool detectInterfaces();
     std::vector<std::string> getAvailableInterfaces() const;
     bool readInterfaceStats(const std::string& interface, InterfaceStats& stats);
     void calculateBandwidth(const InterfaceStats& prev, const InterfaceStats& current,
                            double& download_bps, double& upload_bps);
     
+    // Rate since the previous run's counters when a usable snapshot exists,
+    // otherwise sample the interface twice, sample_ms apart
+    BandwidthResult measureBandwidth(const std::string& interface, int sample_ms = 1000);
+    
+    // Keep the last counters of one-shot measurements in a state file
+    // (see counter_snapshot.h)
+    void useCounterSnapshot(const std::string& path);
+    
     // Display functions
     void displayBandwidth(const std::string& interface);
     bool getBandwidth(const std::string& interface, double& download_bps, double& upload_bps);
-    void monitorBandwidthContinuous(const std::string& interface, int interval_seconds = 1,
+    void monitorBandwidthContinuous(const std::string& interface, int interval_ms = 1000,
                                     const std::string& log_file = "");
+    void monitorBandwidthContinuous(const std::vector<std::string>& selectors, int interval_ms = 1000,
+                                    const std::string& log_file = "");
+    
+    // Length of the in-memory counter history kept by the continuous
+    // monitors; its windowed rates are printed on exit (0 = no history)
+    void setHistoryWindow(int seconds) { history_seconds_ = seconds; }
+    
+    // Sample each interface between min_interval_ms and the monitoring
+    // interval depending on how bursty it is, within a global budget of
+    // interface samples per second (0 = unlimited). 0 ms turns it off.
+    void setAdaptiveSampling(int min_interval_ms, double samples_per_second) {
+        adaptive_min_interval_ms_ = min_interval_ms;
+        sample_budget_ = samples_per_second;
+    }
+    
+    // Watch download/upload rates and probe RTT/loss for departures from
+    // their baselines in the continuous modes. Alerts are printed and, with
+    // a log file, written to "<log>-alerts.csv".
+    void enableAnomalyDetection(const AnomalyConfig& bandwidth, const AnomalyConfig& probes,
+                                const std::string& log_file);
     
-    // Latency measurement (to be implemented in Phase 2)
+    // Interface selection ("all", exact names or shell globs such as "veth*")
+    static bool matchesInterfaceSelector(const std::string& interface,
+                                         const std::vector<std::string>& selectors);
+    
+    // Stream for progress lines of one-shot measurements (default std::cout)
+    void setProgressStream(std::ostream& out) { progress_ = &out; }
+    
+    // Latency measurement (Phase 2); sockets are kept per host between calls
     LatencyResult measureLatency(const std::string& host, int timeout_ms = 1000);
     
-    // Packet loss detection (to be implemented in Phase 3)
-    PacketLossStats detectPacketLoss(const std::string& host, int count = 10);
+    // Packet loss detection (Phase 3), up to `window` probes in flight
+    PacketLossStats detectPacketLoss(const std::string& host, int count = 10, int timeout_ms = 1000,
+                                     int interval_ms = 100, int window = 16);
+    
+    // Continuous latency/loss for a list of targets on one raw socket
+    bool monitorProbeTargets(const std::string& targets_file, int report_interval_ms = 1000,
+                             int duration_seconds = 0, int timeout_ms = 1000,
+                             int default_interval_ms = 1000, const std::string& log_file = "");
+    
+    // Serve the latest metrics over HTTP in OpenMetrics format (continuous modes)
+    bool startMetricsExporter(const std::string& address, int port);
+    
+    // Publish rates and probe results to a seqlocked shared-memory segment
+    // (see shm_metrics.h for the reader side)
+    bool startShmPublisher(const std::string& name);
+    
+    // Run bandwidth, probe and connection collectors concurrently, each on
+    // its own schedule, until SIGINT/SIGTERM
+    bool runDaemon(const DaemonOptions& options);
     
     // Connection statistics (Phase 3)
+    void setConnectionBackend(ConnectionBackend backend);
     void displayActiveConnections();
     bool getConnectionStats(int& tcp_total, int& tcp_established, int& udp_total);
+    bool getConnectionStats(ConnectionStats& stats);
+    
+    // Count every TCP state and the sockets opened and closed since the
+    // previous call (inode diff against the last snapshot)
+    bool sampleConnectionStates(ConnectionStateSample& sample);
+    
+    // Report state counts and churn every interval until Ctrl+C (or duration_seconds)
+    bool monitorConnectionsContinuous(int interval_ms = 1000, int duration_seconds = 0,
+                                      const std::string& log_file = "");
+    
+    // Rank TCP flows by throughput from tcp_info every interval until
+    // Ctrl+C (or duration_seconds), printing the top_k busiest
+    bool monitorTopTalkers(size_t top_k, int interval_ms = 1000, int duration_seconds = 0);
     
-    // Data logging (Phase 4)
+    // Measure /proc/net/tcp{,6} parsing throughput on synthetic tables
+    void benchmarkConnectionParsing(size_t sockets);
+    
+    // Data logging (Phase 4); rows are queued to a background writer per file
     void logToCSV(const std::string& filename);
     bool logBandwidthToCSV(const std::string& filename, const std::string& interface, 
-                          double download_bps, double upload_bps);
+                          double download_bps, double upload_bps, double interval_seconds);
     bool logLatencyToCSV(const std::string& filename, const LatencyResult& result);
     bool logPacketLossToCSV(const std::string& filename, const std::string& host, 
                            const PacketLossStats& stats);
     bool logConnectionsToCSV(const std::string& filename, int tcp_total, int tcp_established, 
                             int udp_total);
+    bool logAlertToCSV(const std::string& filename, const std::string& series, int metric,
+                       const AnomalyEvent& event);
+    
+    // Binary time-series store with rollup tiers (used alongside or instead
+    // of CSV). retention_ns holds one limit per tier, nullptr for defaults.
+    bool openStore(const std::string& directory, const int64_t* retention_ns = nullptr);
+    bool storeBandwidth(const InterfaceStats& current, double download_bps, double upload_bps);
+    bool storeLatency(const LatencyResult& result);
+    bool storePacketLoss(const std::string& host, const PacketLossStats& stats);
+    bool storeConnections(int tcp_total, int tcp_established, int udp_total);
+    
+    // Write stored rows of one kind in the matching CSV layout. An empty
+    // name list exports every series of that kind. A non-zero resolution
+    // reads a rollup tier and writes per-bucket averages.
+    bool exportStoreToCSV(const std::string& directory, const std::string& filename, SeriesKind kind,
+                          const std::vector<std::string>& names, int64_t from_ns, int64_t to_ns,
+                          int64_t resolution_ns = 0);
 
 private:
+    // Rates between the last two readings of an interface
+    struct InterfaceRates {
+        double download_bps;
+        double upload_bps;
+        double rx_packets_per_second;
+        double tx_packets_per_second;
+        double drops_per_second;
+        double errors_per_second;
+        double interval_seconds;
+        
+        InterfaceRates()
+            : download_bps(0.0), upload_bps(0.0), rx_packets_per_second(0.0), tx_packets_per_second(0.0),
+              drops_per_second(0.0), errors_per_second(0.0), interval_seconds(0.0) {}
+    };
+    
+    // What the dashboard shows. Collectors fill their part outside the lock
+    // and copy or swap it in; the dashboard copies the whole view out.
+    struct DashboardInterface {
+        std::string name;
+        InterfaceRates rates;
+    };
+    struct DashboardView {
+        std::vector<DashboardInterface> interfaces;
+        std::vector<ProbeMetric> probes;
+        ConnectionStateSample connections;
+        bool has_connections;
+        std::vector<std::string> events;        // Latest alert and error lines
+        
+        DashboardView() : has_connections(false) {}
+    };
+    
+    // Interface selection and previous samples for continuous bandwidth
+    struct BandwidthState {
+        std::vector<std::string> selectors;
+        std::vector<char> selected;             // Per stats table index
+        std::vector<unsigned long long> row_ids;    // Stats row identity the entries belong to
+        std::vector<char> has_prev;
+        std::vector<InterfaceStats> prev_stats;
+        unsigned long long resolved_generation;
+        bool log_notice_shown;
+        std::vector<InterfaceMetric> metrics;   // Latest rates for exporter/shm
+        std::vector<std::unique_ptr<InterfaceHistory> > history;   // Per stats table index
+        size_t history_capacity;                // Readings per interface, 0 = none
+        std::unique_ptr<AnomalyDetector> anomalies;    // Series 2*index (down), 2*index+1 (up)
+        std::unique_ptr<AdaptiveSampler> adaptive;     // Per-interface intervals, null = every tick
+        std::vector<InterfaceRates> rates;      // Latest rates per index
+        
+        BandwidthState() : resolved_generation(~0ULL), log_notice_shown(false), history_capacity(0) {}
+    };
+    
     std::vector<std::string> available_interfaces_;
-    std::map<std::string, InterfaceStats> last_stats_;
+    std::map<std::string, InterfaceStats> last_stats_;    // From the counter snapshot
+    std::string snapshot_path_;
+    int history_seconds_;
+    int adaptive_min_interval_ms_;
+    double sample_budget_;
+    std::unique_ptr<InterfaceStatsSource> stats_source_;
+    ConnectionBackend connection_backend_;
+    std::unique_ptr<ProcNetTableParser> proc_net_parser_;
+    std::unique_ptr<SockDiagClient> sock_diag_;
+    std::unique_ptr<SocketChurnTracker> churn_;
+    std::vector<uint64_t> inode_scratch_;
+    std::chrono::steady_clock::time_point last_connection_sample_;
+    ConnectionStateSample connection_states_;      // Latest sample, copied to the dashboard
+    std::unique_ptr<ResolverCache> resolver_;
+    std::map<std::string, std::unique_ptr<ProbeSession> > probe_sessions_;
+    std::map<std::string, std::unique_ptr<CsvLogger> > csv_loggers_;
+    std::unique_ptr<RollupStore> store_;
+    std::unique_ptr<MetricsExporter> exporter_;
+    std::unique_ptr<ShmPublisher> shm_;
+    std::vector<ProbeMetric> probe_metrics_;
+    std::unique_ptr<AnomalyConfig> bandwidth_anomaly_config_;
+    std::unique_ptr<AnomalyConfig> probe_anomaly_config_;
+    std::unique_ptr<AnomalyDetector> probe_anomalies_;     // Series 2*target (rtt), 2*target+1 (loss)
+    std::string alert_log_;
+    std::ostream* progress_;
+    
+    // Collectors may run on different threads in daemon mode
+    std::mutex csv_mutex_;
+    std::mutex store_mutex_;
     
     // Helper functions
-    bool parseProcNetDev(std::map<std::string, InterfaceStats>& stats);
+    bool sampleInterfaces();
+    bool resolveBandwidthSelection(BandwidthState& state);
+    void collectBandwidth(BandwidthState& state, const std::string& time_str,
+                          std::ostream& output, const std::string& log_file);
+    void startBandwidthHistory(BandwidthState& state, int interval_ms);
+    void fillDashboardInterfaces(const BandwidthState& state, std::vector<DashboardInterface>& rows) const;
+    void composeDashboard(const DashboardView& view, TerminalScreen& screen) const;
+    int startAdaptiveSampling(BandwidthState& state, int interval_ms);
+    void reportAnomaly(const std::string& time_str, const std::string& series, int metric,
+                       const AnomalyEvent& event, std::ostream& output);
+    void reportBandwidthHistory(const BandwidthState& state, std::ostream& output);
+    bool addProbeTargets(const std::string& targets_file, int default_interval_ms,
+                         ProbeScheduler& scheduler);
+    void reportProbeWindow(const ProbeScheduler& probes, const std::string& time_str,
+                           std::ostream& output, const std::string& log_file);
+    bool collectConnections(const std::string& time_str, std::ostream& output,
+                            const std::string& log_file);
+    bool parseProcNetConnections(ConnectionStats& stats);
+    bool querySockDiagConnections(ConnectionStats& stats);
     double calculateTimeDiff(const std::chrono::steady_clock::time_point& start,
                             const std::chrono::steady_clock::time_point& end);
     
     // ICMP helper functions for Phase 2
-    unsigned short calculateChecksum(unsigned short* buffer, int length);
     bool resolveHostname(const std::string& hostname, struct sockaddr_in* addr);
-    int createRawSocket();
+    
+    // CSV writer for a file, opened on first use (nullptr if it cannot be opened)
+    CsvLogger* csvLogger(const std::string& filename, int kind);
 };
 
 #endif // NETWORK_MONITOR_H
@@ -0,0 +1,137 @@
+#ifndef PROBE_SCHEDULER_H
+#define PROBE_SCHEDULER_H
+
+#include "icmp_socket.h"
+#include "rtt_histogram.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// One line of a target list: "<host> [interval_ms]"
+struct ProbeTargetConfig {
+    std::string host;
+    int interval_ms;
+};
+
+// Read a target list file. Blank lines and lines starting with '#' are
+// skipped; targets without an interval use default_interval_ms.
+bool loadProbeTargets(const std::string& path, int default_interval_ms,
+                      std::vector<ProbeTargetConfig>& targets);
+
+// Probe counters for one target over a reporting window
+struct ProbeTargetStats {
+    unsigned long long sent;
+    unsigned long long received;
+    unsigned long long lost;        // Probes that reached their timeout unanswered
+    unsigned long long late;        // Replies after the timeout
+    unsigned long long duplicates;
+    RttHistogram rtt;
+    TimestampSource clock_source;   // Least precise clock used for any RTT
+};
+
+// Continuous ICMP prober for many targets on one raw socket.
+//
+// Sends and timeouts are scheduled on a hashed timing wheel. A one-shot
+// timerfd is armed for the next occupied wheel slot (or report), so the loop
+// only wakes when something is due. A bitmap of occupied slots lets the
+// wheel jump straight to the next slot with events, including when catching
+// up after a stall. Replies are demultiplexed by ICMP
+// identifier (one per target) and sequence number. Work is proportional to
+// the number of probes due, so cost grows with the probe rate rather than
+// with the number of targets or threads. RTTs use kernel timestamps when
+// available.
+class ProbeScheduler {
+public:
+    // Called every report interval; windowStats() is reset afterwards
+    typedef std::function<void(const ProbeScheduler& scheduler)> ReportHandler;
+
+    ProbeScheduler(int timeout_ms, int tick_ms = 1);
+    ~ProbeScheduler();
+
+    // Returns false if the timeout spans more probes than sequence numbers
+    // can tell apart (timeout / interval above 32767)
+    bool addTarget(const std::string& name, const struct sockaddr_in& addr, int interval_ms);
+
+    size_t targetCount() const { return targets_.size(); }
+    const std::string& targetName(size_t index) const { return targets_[index].name; }
+    const ProbeTargetStats& windowStats(size_t index) const { return targets_[index].window; }
+    const ProbeTargetStats& totalStats(size_t index) const { return targets_[index].total; }
+
+    // Probe until duration_ms elapses (0 = until stop()) and report every
+    // report_interval_ms. Returns false if the socket or timers cannot be set up.
+    bool run(int duration_ms, int report_interval_ms, const ReportHandler& on_report);
+
+    // Ask the loop to return (safe from other threads). A stop requested
+    // before run() makes run() return immediately.
+    void stop();
+
+private:
+    ProbeScheduler(const ProbeScheduler&);
+    ProbeScheduler& operator=(const ProbeScheduler&);
+
+    // Outstanding probes per target, indexed by sequence & ring_mask. Rings
+    // have at least kProbeRing slots and always hold every probe that can
+    // be in flight within the timeout.
+    static const size_t kProbeRing = 64;
+    static const size_t kMaxProbeRing = 32768;
+
+    enum ProbeState : uint8_t { FREE, IN_FLIGHT, REPLIED, TIMED_OUT };
+
+    // Recent kernel send timestamp keys, indexed by key & (kTxKeyRing - 1)
+    static const size_t kTxKeyRing = 4096;
+
+    struct ProbeSlot {
+        PacketTimestamps sent;
+        uint16_t sequence;
+        ProbeState state;
+    };
+
+    struct Target {
+        std::string name;
+        struct sockaddr_in addr;
+        uint16_t icmp_id;
+        uint16_t next_sequence;
+        uint32_t interval_ticks;
+        std::vector<ProbeSlot> ring;
+        uint16_t ring_mask;
+        ProbeTargetStats window;
+        ProbeTargetStats total;
+    };
+
+    enum EventKind : uint8_t { SEND_PROBE, PROBE_TIMEOUT };
+
+    struct WheelEntry {
+        uint32_t target;
+        uint32_t rounds;        // Remaining full wheel revolutions
+        uint16_t sequence;
+        EventKind kind;
+    };
+
+    std::vector<Target> targets_;
+    std::vector<std::vector<WheelEntry> > wheel_;
+    std::vector<uint64_t> occupied_;        // Bit per wheel slot holding events
+    std::vector<WheelEntry> scratch_;
+    std::vector<std::pair<uint32_t, uint16_t> > tx_keys_;  // key -> (target, sequence)
+    size_t wheel_position_;
+    int tick_ms_;
+    uint32_t timeout_ticks_;
+    uint16_t id_base_;
+    IcmpSocket socket_;
+    int wake_fd_;                   // eventfd that interrupts the loop on stop()
+    std::atomic<bool> stop_requested_;
+
+    void schedule(uint32_t target, EventKind kind, uint16_t sequence, uint32_t ticks);
+    void advanceTick();
+    void advanceTicks(unsigned long long ticks);
+    bool nextOccupiedTick(uint32_t& ticks) const;
+    void sendProbe(uint32_t target);
+    void expireProbe(uint32_t target, uint16_t sequence);
+    void handleTxTimestamps();
+    void handleReplies();
+    void loseSlot(Target& target, ProbeSlot& slot);
+};
+
+#endif // PROBE_SCHEDULER_H
@@ -0,0 +1,49 @@
+#ifndef PROBE_SESSION_H
+#define PROBE_SESSION_H
+
+#include "icmp_socket.h"
+#include <string>
+#include <cstdint>
+
+class ResolverCache;
+
+// Result of one echo probe
+struct ProbeSample {
+    bool success;
+    double rtt_ms;
+    TimestampSource clock_source;
+};
+
+// Reusable echo session for one host.
+//
+// The session owns a raw socket (with kernel timestamps enabled once) and
+// the resolved destination, so repeated measurements only cost one
+// sendto/recvmsg pair. The address is re-read from the resolver cache on
+// every probe, which is a map lookup until the cache entry goes stale.
+class ProbeSession {
+public:
+    ProbeSession(const std::string& host, ResolverCache& resolver);
+    ~ProbeSession();
+
+    // Resolve the host and open the socket; prints the reason on failure
+    bool open();
+    bool isOpen() const { return socket_.fd() >= 0; }
+
+    const std::string& host() const { return host_; }
+
+    // Send one echo request and wait up to timeout_ms for its reply
+    ProbeSample measure(int timeout_ms);
+
+private:
+    ProbeSession(const ProbeSession&);
+    ProbeSession& operator=(const ProbeSession&);
+
+    std::string host_;
+    ResolverCache& resolver_;
+    IcmpSocket socket_;
+    struct sockaddr_in dest_addr_;
+    uint16_t id_;
+    uint16_t next_sequence_;
+};
+
+#endif // PROBE_SESSION_H
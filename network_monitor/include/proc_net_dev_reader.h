@@ -0,0 +1,31 @@
+#ifndef PROC_NET_DEV_READER_H
+#define PROC_NET_DEV_READER_H
+
+#include "interface_stats_source.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Allocation-free reader for /proc/net/dev.
+//
+// The file descriptor stays open for the lifetime of the reader and every
+// sample re-reads it with pread() into a reused buffer. Rows are parsed in a
+// single pass and written into the flat table. Heap allocations only happen
+// when the buffer has to grow or a new interface appears.
+class ProcNetDevReader : public InterfaceStatsSource {
+public:
+    explicit ProcNetDevReader(const char* path = "/proc/net/dev");
+    ~ProcNetDevReader();
+
+    bool sample();
+    const char* name() const { return "proc"; }
+
+private:
+    std::string path_;
+    int fd_;
+    std::vector<char> buffer_;
+
+    bool readFile(size_t& length);
+};
+
+#endif // PROC_NET_DEV_READER_H
@@ -0,0 +1,85 @@
+#ifndef PROC_NET_PARSER_H
+#define PROC_NET_PARSER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// TCP states are 1..11 (TCP_ESTABLISHED..TCP_CLOSING) plus TCP_NEW_SYN_RECV
+const int kTcpStateSlots = 16;
+
+// Kernel name of a TCP state ("ESTABLISHED", "TIME_WAIT", ...), nullptr if unknown
+const char* tcpStateName(int state);
+
+// Rows of one or more /proc/net/{tcp,udp}{,6} tables by socket state
+struct SocketTableCounts {
+    uint64_t rows;
+    uint64_t states[kTcpStateSlots];
+
+    SocketTableCounts() { clear(); }
+    void clear();
+    void add(const SocketTableCounts& other);
+};
+
+// Parallel parser for /proc/net/tcp, tcp6, udp and udp6.
+//
+// A table is read into one reused buffer and split at line boundaries into
+// chunks of at least kMinChunkBytes. Each chunk is scanned by its own
+// thread, which reads the fixed-width hex state column by hand into a
+// private counter array (and, on request, the inode column into a private
+// list). The results are merged once every thread has finished. Small
+// tables are parsed on the calling thread. The worker threads are started
+// on the first table large enough to split and then kept for later calls.
+class ProcNetTableParser {
+public:
+    // threads = 0 uses the number of online CPUs (at most kMaxThreads)
+    explicit ProcNetTableParser(unsigned threads = 0);
+    ~ProcNetTableParser();
+
+    // Add the rows of one table file to counts, and their socket inodes to
+    // inodes if given. A missing file (no IPv6) adds nothing and returns false.
+    bool parseFile(const char* path, SocketTableCounts& counts,
+                   std::vector<uint64_t>* inodes = nullptr);
+
+    // Parse table text (header line first) already in memory
+    void parseBuffer(const char* data, size_t length, SocketTableCounts& counts,
+                     std::vector<uint64_t>* inodes = nullptr);
+
+    // Count rows in [begin, end), which holds whole lines without the header
+    static void parseLines(const char* begin, const char* end, SocketTableCounts& counts,
+                           std::vector<uint64_t>* inodes = nullptr);
+
+    unsigned threads() const { return threads_; }
+
+    static const unsigned kMaxThreads = 16;
+    static const size_t kMinChunkBytes = 256 * 1024;
+
+private:
+    ProcNetTableParser(const ProcNetTableParser&);
+    ProcNetTableParser& operator=(const ProcNetTableParser&);
+
+    // Worker w parses chunk w + 1 of every round; the caller parses chunk 0
+    void workerLoop(size_t worker);
+
+    unsigned threads_;
+    std::vector<char> buffer_;
+    std::vector<std::vector<uint64_t> > chunk_inodes_;  // Per worker, reused
+
+    // Current round, shared with the workers under mutex_
+    std::vector<const char*> bounds_;
+    std::vector<SocketTableCounts> partial_;
+    size_t chunks_;
+    bool want_inodes_;
+    unsigned long long round_;
+    size_t pending_;                // Worker chunks of the round not yet parsed
+    bool stopping_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+};
+
+#endif // PROC_NET_PARSER_H
@@ -0,0 +1,53 @@
+#ifndef RESOLVER_CACHE_H
+#define RESOLVER_CACHE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <netinet/in.h>
+
+// Thread-safe IPv4 hostname cache on top of getaddrinfo().
+//
+// Entries are fresh for ttl_seconds. After that they are still served for
+// another ttl_seconds while a background thread re-resolves them, so callers
+// on a probe loop never wait for DNS once a name has been resolved. Failed
+// lookups are remembered for negative_ttl_seconds. IP literals bypass the
+// cache entirely.
+class ResolverCache {
+public:
+    explicit ResolverCache(int ttl_seconds = 60, int negative_ttl_seconds = 5);
+    ~ResolverCache();
+
+    // Resolve a hostname or dotted-quad address
+    bool resolve(const std::string& hostname, struct sockaddr_in* addr);
+
+private:
+    ResolverCache(const ResolverCache&);
+    ResolverCache& operator=(const ResolverCache&);
+
+    struct Entry {
+        struct in_addr address;
+        bool valid;
+        bool refreshing;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    static bool lookup(const std::string& hostname, struct in_addr& address);
+    void store(const std::string& hostname, bool valid, const struct in_addr& address);
+    void refreshLoop();
+
+    std::chrono::seconds ttl_;
+    std::chrono::seconds negative_ttl_;
+    std::map<std::string, Entry> entries_;
+    std::deque<std::string> refresh_queue_;
+    std::mutex mutex_;
+    std::condition_variable refresh_cv_;
+    bool stopping_;
+    std::thread refresh_thread_;
+};
+
+#endif // RESOLVER_CACHE_H
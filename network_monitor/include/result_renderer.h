@@ -0,0 +1,108 @@
+#ifndef RESULT_RENDERER_H
+#define RESULT_RENDERER_H
+
+#include "network_monitor.h"
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Output formats for one-shot measurements (--format)
+enum class OutputFormat {
+    CONSOLE,
+    CSV,
+    JSON
+};
+
+bool parseOutputFormat(const std::string& text, OutputFormat& format);
+
+// Consumer of one measurement result. Every one-shot mode measures once and
+// hands the same result to each renderer, so the printed, logged and stored
+// values always agree.
+class ResultRenderer {
+public:
+    virtual ~ResultRenderer() {}
+
+    virtual void renderBandwidth(const BandwidthResult& result) = 0;
+    virtual void renderLatency(const LatencyResult& result) = 0;
+    virtual void renderPacketLoss(const std::string& host, const PacketLossStats& stats) = 0;
+    virtual void renderConnections(const ConnectionStats& stats) = 0;
+};
+
+// Human readable report
+class ConsoleRenderer : public ResultRenderer {
+public:
+    explicit ConsoleRenderer(std::ostream& out) : out_(out) {}
+
+    void renderBandwidth(const BandwidthResult& result);
+    void renderLatency(const LatencyResult& result);
+    void renderPacketLoss(const std::string& host, const PacketLossStats& stats);
+    void renderConnections(const ConnectionStats& stats);
+
+private:
+    std::ostream& out_;
+};
+
+// One JSON object per line
+class JsonRenderer : public ResultRenderer {
+public:
+    explicit JsonRenderer(std::ostream& out) : out_(out) {}
+
+    void renderBandwidth(const BandwidthResult& result);
+    void renderLatency(const LatencyResult& result);
+    void renderPacketLoss(const std::string& host, const PacketLossStats& stats);
+    void renderConnections(const ConnectionStats& stats);
+
+private:
+    std::ostream& out_;
+};
+
+// Rows in the --log CSV layout, written through the monitor's CSV writer
+// (a file, or /dev/stdout for --format csv)
+class CsvRenderer : public ResultRenderer {
+public:
+    CsvRenderer(NetworkMonitor& monitor, const std::string& filename)
+        : monitor_(monitor), filename_(filename) {}
+
+    void renderBandwidth(const BandwidthResult& result);
+    void renderLatency(const LatencyResult& result);
+    void renderPacketLoss(const std::string& host, const PacketLossStats& stats);
+    void renderConnections(const ConnectionStats& stats);
+
+private:
+    NetworkMonitor& monitor_;
+    std::string filename_;
+};
+
+// Appends results to the monitor's --store
+class StoreRenderer : public ResultRenderer {
+public:
+    explicit StoreRenderer(NetworkMonitor& monitor) : monitor_(monitor) {}
+
+    void renderBandwidth(const BandwidthResult& result);
+    void renderLatency(const LatencyResult& result);
+    void renderPacketLoss(const std::string& host, const PacketLossStats& stats);
+    void renderConnections(const ConnectionStats& stats);
+
+private:
+    NetworkMonitor& monitor_;
+};
+
+// Fans one result out to several renderers in the order they were added
+class MultiRenderer : public ResultRenderer {
+public:
+    void add(ResultRenderer* renderer) { renderers_.push_back(std::unique_ptr<ResultRenderer>(renderer)); }
+
+    void renderBandwidth(const BandwidthResult& result);
+    void renderLatency(const LatencyResult& result);
+    void renderPacketLoss(const std::string& host, const PacketLossStats& stats);
+    void renderConnections(const ConnectionStats& stats);
+
+private:
+    std::vector<std::unique_ptr<ResultRenderer> > renderers_;
+};
+
+// Renderer for a --format value writing to standard output
+ResultRenderer* createRenderer(OutputFormat format, NetworkMonitor& monitor);
+
+#endif // RESULT_RENDERER_H
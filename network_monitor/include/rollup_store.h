@@ -0,0 +1,130 @@
+#ifndef ROLLUP_STORE_H
+#define ROLLUP_STORE_H
+
+#include "timeseries_store.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Source columns a rollup can aggregate (u64 columns followed by f64 columns)
+const int kMaxRollupColumns = 8;
+
+// Resolution tiers, finest first
+enum RollupTier {
+    TIER_RAW = 0,
+    TIER_MINUTE = 1,
+    TIER_HOUR = 2,
+    kRollupTiers = 3
+};
+
+// One row as seen by queries. Raw samples are reported as buckets of one
+// sample where min, max, avg and last are all the sample value.
+struct RollupRow {
+    int64_t timestamp_ns;       // Sample time, or bucket start for rollups
+    int64_t resolution_ns;      // 0 for raw samples
+    uint64_t samples;
+    int columns;
+    double min[kMaxRollupColumns];
+    double max[kMaxRollupColumns];
+    double avg[kMaxRollupColumns];
+    double last[kMaxRollupColumns];
+};
+
+// Raw store plus downsampled tiers (1 s -> 1 min -> 1 h).
+//
+// Raw rows go to the store in the directory itself; minute and hour rollups
+// live in the rollup-1m and rollup-1h subdirectories. Every raw row is folded
+// into the open minute bucket of its series; a closed minute bucket is
+// written out and folded into the open hour bucket. Each rollup row keeps the
+// sample count and min/max/avg/last of every source column. Retention is per
+// tier and drops whole segments.
+class RollupStore {
+public:
+    RollupStore();
+    ~RollupStore();
+
+    // Open the store. retention_ns holds one limit per tier (0 = keep forever).
+    bool open(const std::string& directory, bool read_only = false,
+              const int64_t* retention_ns = nullptr);
+    void close();
+    bool isOpen() const { return stores_[TIER_RAW].isOpen(); }
+
+    uint32_t seriesId(SeriesKind kind, const std::string& name) {
+        return stores_[TIER_RAW].seriesId(kind, name);
+    }
+
+    // Append a raw row and update the rollups
+    bool append(uint32_t series_id, int64_t timestamp_ns, const uint64_t* u, const double* f);
+
+    // Write open buckets and buffered rows (partial buckets are merged with
+    // their continuation at query time)
+    void flush();
+
+    // Visit rows of a series between from_ns and to_ns from the tier chosen
+    // by selectTier(). Only closed (written) buckets are returned.
+    bool query(SeriesKind kind, const std::string& name, int64_t from_ns, int64_t to_ns,
+               int64_t resolution_ns, const std::function<void(const RollupRow&)>& visit) const;
+
+    // Tier that query() reads: the coarsest one not finer than resolution_ns,
+    // moving to coarser tiers when retention has already dropped from_ns
+    int selectTier(int64_t from_ns, int64_t resolution_ns) const;
+
+    // Oldest and newest timestamp held by any tier, or by one tier
+    bool timeRange(int64_t& first_ns, int64_t& last_ns) const;
+    bool tierTimeRange(int tier, int64_t& first_ns, int64_t& last_ns) const;
+
+    // Apply the retention limits relative to now_ns
+    void enforceRetention(int64_t now_ns);
+
+    const TimeSeriesStore& raw() const { return stores_[TIER_RAW]; }
+
+    static int64_t tierResolution(int tier);
+    static const char* tierName(int tier);
+
+    // Default retention: raw 7 days, minutes 90 days, hours 2 years
+    static void defaultRetention(int64_t* retention_ns);
+
+    // Parse "raw=7d,1m=90d,1h=2y" (any subset) into retention_ns
+    static bool parseRetention(const std::string& spec, int64_t* retention_ns);
+
+private:
+    RollupStore(const RollupStore&);
+    RollupStore& operator=(const RollupStore&);
+
+    // Open aggregation bucket of one series in one tier
+    struct Bucket {
+        int64_t start;
+        uint64_t samples;
+        double min[kMaxRollupColumns];
+        double max[kMaxRollupColumns];
+        double sum[kMaxRollupColumns];
+        double last[kMaxRollupColumns];
+    };
+
+    // Per raw series: column count, rollup series ids and open buckets
+    struct SeriesState {
+        int columns;
+        uint32_t tier_ids[kRollupTiers];
+        bool open[kRollupTiers];
+        Bucket buckets[kRollupTiers];
+    };
+
+    SeriesState& state(uint32_t series_id);
+    void fold(uint32_t series_id, int tier, int64_t timestamp_ns, uint64_t samples,
+              const double* min, const double* max, const double* sum, const double* last);
+    void emit(uint32_t series_id, int tier);
+
+    TimeSeriesStore stores_[kRollupTiers];
+    std::vector<SeriesState> states_;           // Indexed by raw series id - 1
+    int64_t retention_ns_[kRollupTiers];
+    int64_t last_retention_check_ns_;
+    bool read_only_;
+};
+
+// Parse a duration such as "500ms", "10", "5m" or "90d" (plain numbers are
+// seconds; units ms, s, m, h, d, w, y)
+bool parseDuration(const std::string& text, int64_t& ns);
+
+#endif // ROLLUP_STORE_H
@@ -0,0 +1,54 @@
+#ifndef RTT_HISTOGRAM_H
+#define RTT_HISTOGRAM_H
+
+#include <cstdint>
+
+// Fixed-size, log-bucketed RTT histogram (HDR histogram layout).
+//
+// Values are recorded in microseconds. Each power-of-two range is split
+// into kSubBuckets linear sub-buckets, so any reported percentile is within
+// 1 / kSubBuckets (~0.8%) of the true value. Memory is constant no matter
+// how many samples are recorded. Histograms from different runs or targets
+// can be merged by adding their counts. Min, max, mean and standard
+// deviation are tracked exactly alongside the buckets.
+class RttHistogram {
+public:
+    RttHistogram();
+
+    void reset();
+
+    // Record one RTT in milliseconds
+    void record(double rtt_ms);
+
+    // Add every sample of another histogram
+    void merge(const RttHistogram& other);
+
+    uint64_t count() const { return count_; }
+    double min() const;
+    double max() const;
+    double mean() const;
+    double stddev() const;
+
+    // Value at a percentile in [0, 100], in milliseconds
+    double percentile(double percent) const;
+
+private:
+    static const int kSubBucketBits = 7;
+    static const int kSubBuckets = 1 << kSubBucketBits;
+    static const int kHalfSubBuckets = kSubBuckets / 2;
+    static const int kMaxValueBits = 37;    // 2^37 us is about 38 hours
+    static const int kBucketCount = kMaxValueBits - kSubBucketBits + 1;
+    static const int kCountsLength = (kBucketCount + 1) * kHalfSubBuckets;
+
+    static int indexFor(uint64_t value_us);
+    static uint64_t valueAt(int index);
+
+    uint32_t counts_[kCountsLength];
+    uint64_t count_;
+    double min_ms_;
+    double max_ms_;
+    double mean_ms_;
+    double m2_;     // Welford sum of squared deviations
+};
+
+#endif // RTT_HISTOGRAM_H
@@ -0,0 +1,162 @@
+#ifndef SHM_METRICS_H
+#define SHM_METRICS_H
+
+// Shared-memory metrics snapshot published by netmonitor --shm <name>.
+//
+// This header is self-contained so local consumers can include it without
+// linking anything from netmonitor (link with -lrt on older glibc).
+//
+// The segment holds one section per collector. Each section is guarded by
+// its own sequence lock: the writer makes the sequence odd, updates the
+// entries in place and makes it even again. Readers look at the mapped
+// entries directly and retry if the sequence was odd or changed while they
+// were reading, so a read needs no syscall, no lock and no copy.
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+const uint32_t kShmMetricsMagic = 0x4e4d534d;   // "NMSM"
+const uint16_t kShmMetricsVersionMajor = 1;     // Bumped on incompatible layout changes
+const uint16_t kShmMetricsVersionMinor = 0;     // Bumped when fields are appended
+
+const uint32_t kShmMaxInterfaces = 256;
+const uint32_t kShmMaxProbes = 1024;
+
+struct ShmInterfaceEntry {
+    char name[32];
+    uint64_t bytes_received;
+    uint64_t bytes_sent;
+    uint64_t packets_received;
+    uint64_t packets_sent;
+    double download_bps;
+    double upload_bps;
+};
+
+struct ShmProbeEntry {
+    char host[64];
+    uint64_t sent_total;
+    uint64_t received_total;
+    uint64_t lost_total;
+    double loss_ratio;          // Last report window
+    double rtt_min_ms;          // RTT fields are 0 when has_rtt is 0
+    double rtt_avg_ms;
+    double rtt_max_ms;
+    double rtt_p50_ms;
+    double rtt_p90_ms;
+    double rtt_p99_ms;
+    double jitter_ms;
+    uint32_t has_rtt;
+    uint32_t reserved;
+};
+
+// Sequence-locked section; the sequence sits on its own cache line
+template <typename Entry, uint32_t Capacity>
+struct ShmSection {
+    std::atomic<uint64_t> sequence;     // Odd while the writer is updating
+    char pad[56];
+    int64_t updated_ns;                 // Wall clock of the last update (0 = never)
+    uint32_t count;
+    uint32_t reserved;
+    Entry entries[Capacity];
+};
+
+typedef ShmSection<ShmInterfaceEntry, kShmMaxInterfaces> ShmInterfaceSection;
+typedef ShmSection<ShmProbeEntry, kShmMaxProbes> ShmProbeSection;
+
+struct ShmMetricsLayout {
+    uint32_t magic;             // Written last by the writer during setup
+    uint16_t version_major;
+    uint16_t version_minor;
+    uint32_t layout_size;       // sizeof(ShmMetricsLayout) of the writer
+    int32_t writer_pid;
+    int64_t started_ns;
+    char pad[40];
+    ShmInterfaceSection interfaces;
+    ShmProbeSection probes;
+};
+
+// Read-only view of a published snapshot
+class ShmMetricsReader {
+public:
+    ShmMetricsReader() : layout_(nullptr), size_(0) {}
+    ~ShmMetricsReader() { close(); }
+
+    // Map the segment (e.g. "/netmonitor"); fails if it is missing or has
+    // an incompatible layout version
+    bool open(const char* name) {
+        close();
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(ShmMetricsLayout)) {
+            ::close(fd);
+            return false;
+        }
+        void* base = mmap(nullptr, sizeof(ShmMetricsLayout), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            return false;
+        }
+        layout_ = static_cast<const ShmMetricsLayout*>(base);
+        size_ = sizeof(ShmMetricsLayout);
+
+        const std::atomic<uint32_t>* magic = reinterpret_cast<const std::atomic<uint32_t>*>(&layout_->magic);
+        if (magic->load(std::memory_order_acquire) != kShmMetricsMagic ||
+            layout_->version_major != kShmMetricsVersionMajor) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (layout_ != nullptr) {
+            munmap(const_cast<ShmMetricsLayout*>(layout_), size_);
+            layout_ = nullptr;
+        }
+    }
+
+    bool isOpen() const { return layout_ != nullptr; }
+    const ShmMetricsLayout* layout() const { return layout_; }
+
+    // Call visit(section) on the live interface section until it ran
+    // against a consistent snapshot. visit may run more than once and must
+    // only read; anything it wants to keep it should copy.
+    template <typename Visitor>
+    void readInterfaces(Visitor visit) const { readSection(layout_->interfaces, visit); }
+
+    template <typename Visitor>
+    void readProbes(Visitor visit) const { readSection(layout_->probes, visit); }
+
+private:
+    ShmMetricsReader(const ShmMetricsReader&);
+    ShmMetricsReader& operator=(const ShmMetricsReader&);
+
+    template <typename Section, typename Visitor>
+    static void readSection(const Section& section, Visitor& visit) {
+        while (true) {
+            uint64_t before = section.sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            visit(section);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (section.sequence.load(std::memory_order_relaxed) == before) {
+                return;
+            }
+        }
+    }
+
+    const ShmMetricsLayout* layout_;
+    size_t size_;
+};
+
+#endif // SHM_METRICS_H
@@ -0,0 +1,37 @@
+#ifndef SHM_PUBLISHER_H
+#define SHM_PUBLISHER_H
+
+#include "shm_metrics.h"
+#include "metrics_exporter.h"
+#include <string>
+#include <vector>
+
+// Writer side of the shared-memory snapshot (see shm_metrics.h).
+//
+// Each section has a single writer: the bandwidth collector publishes
+// interfaces and the probe collector publishes probes, so the two never
+// contend. The segment is unlinked when the publisher closes. Only one
+// process may publish under a name: open() refuses a segment whose writer
+// is still running, so readers never see two writers.
+class ShmPublisher {
+public:
+    ShmPublisher();
+    ~ShmPublisher();
+
+    // Create the named segment, replacing one left behind by a writer that
+    // is no longer running
+    bool open(const std::string& name);
+    void close();
+
+    void publishInterfaces(const std::vector<InterfaceMetric>& metrics);
+    void publishProbes(const std::vector<ProbeMetric>& metrics);
+
+private:
+    ShmPublisher(const ShmPublisher&);
+    ShmPublisher& operator=(const ShmPublisher&);
+
+    std::string name_;
+    ShmMetricsLayout* layout_;
+};
+
+#endif // SHM_PUBLISHER_H
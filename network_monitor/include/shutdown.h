@@ -0,0 +1,16 @@
+#ifndef SHUTDOWN_H
+#define SHUTDOWN_H
+
+#include <chrono>
+
+// Install SIGINT/SIGTERM handlers that request an orderly shutdown instead
+// of killing the process, so buffered output can be flushed
+void installShutdownHandlers();
+
+// Whether SIGINT/SIGTERM has been received (async-signal-safe flag)
+bool shutdownRequested();
+
+// Sleep for a duration, returning early (and false) if a shutdown is requested
+bool sleepUnlessShutdown(std::chrono::nanoseconds duration);
+
+#endif // SHUTDOWN_H
@@ -0,0 +1,59 @@
+#ifndef SOCK_DIAG_H
+#define SOCK_DIAG_H
+
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+struct inet_diag_msg;
+struct rtattr;
+
+// TCP state bitmask helpers for SockDiagClient::dump()
+const uint32_t kAllSocketStates = 0xFFFFFFFFu;
+inline uint32_t tcpStateMask(int state) { return 1u << state; }
+
+// Socket enumeration over NETLINK_SOCK_DIAG (inet_diag).
+//
+// The kernel applies the state filter before building replies, so asking for
+// one state only costs as much as the number of sockets in that state. The
+// netlink socket and receive buffer are reused between dumps.
+class SockDiagClient {
+public:
+    // Called once per socket with its inet_diag_msg and trailing attributes
+    typedef std::function<void(const struct inet_diag_msg& msg,
+                               const struct rtattr* attrs, int attrs_len)> Visitor;
+
+    SockDiagClient();
+    ~SockDiagClient();
+
+    // Dump sockets of one family (AF_INET/AF_INET6) and protocol
+    // (IPPROTO_TCP/IPPROTO_UDP) whose state is in the states bitmask.
+    // extensions is a bitmask of INET_DIAG_* attributes to request.
+    bool dump(int family, int protocol, uint32_t states, uint8_t extensions,
+              const Visitor& visit);
+
+    // Count matching sockets over IPv4 and IPv6
+    bool count(int protocol, uint32_t states, int& total);
+
+private:
+    SockDiagClient(const SockDiagClient&);
+    SockDiagClient& operator=(const SockDiagClient&);
+
+    int sock_;
+    unsigned int seq_;
+    std::vector<char> buffer_;
+
+    bool openSocket();
+};
+
+// Socket totals from /proc/net/sockstat and /proc/net/sockstat6. This is a
+// handful of per-namespace counters, so it costs the same at any table size.
+struct SockstatSummary {
+    int tcp_inuse;      // Hashed TCP sockets (IPv4 + IPv6), excluding TIME_WAIT
+    int tcp_timewait;   // TIME_WAIT sockets
+    int udp_inuse;      // UDP sockets (IPv4 + IPv6)
+};
+
+bool readSockstat(SockstatSummary& summary);
+
+#endif // SOCK_DIAG_H
@@ -0,0 +1,54 @@
+#ifndef SOCKET_CHURN_H
+#define SOCKET_CHURN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Opened and closed sockets between consecutive snapshots of socket inodes.
+//
+// Inodes live in one open-addressing table (linear probing) whose slots
+// carry the generation of the last snapshot that contained them. A slot
+// stamped with the previous generation is a socket that has not been seen
+// yet in the current snapshot. Older stamps are dead and get reused by
+// later inserts. Nothing is sorted or cleared between snapshots. The table is
+// only rebuilt, into a reused spare array, when dead slots pile up or the
+// live set outgrows it.
+class SocketChurnTracker {
+public:
+    SocketChurnTracker();
+
+    // Start a snapshot
+    void begin();
+
+    // Add one socket of the snapshot. Inode 0 (TIME_WAIT and other sockets
+    // without a file) is ignored.
+    void add(uint64_t inode);
+
+    // Finish the snapshot: sockets that appeared and disappeared since the
+    // previous one. Returns false for the first snapshot, which has nothing
+    // to compare against.
+    bool end(uint64_t& opened, uint64_t& closed);
+
+    // Sockets in the last finished snapshot
+    uint64_t size() const { return live_; }
+
+private:
+    struct Slot {
+        uint64_t inode;         // 0 = never used
+        uint64_t generation;
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<Slot> spare_;
+    size_t mask_;
+    size_t occupied_;           // Slots with an inode, live or dead
+    uint64_t generation_;
+    uint64_t live_;             // Sockets in the previous snapshot
+    uint64_t survived_;         // Of those, seen again in this snapshot
+    uint64_t opened_;           // New in this snapshot
+
+    void rebuild(size_t capacity);
+};
+
+#endif // SOCKET_CHURN_H
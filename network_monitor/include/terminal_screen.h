@@ -0,0 +1,64 @@
+#ifndef TERMINAL_SCREEN_H
+#define TERMINAL_SCREEN_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Full-screen text frames for a terminal, redrawn by difference.
+//
+// A frame is composed into a back buffer of rows x columns cells (one byte
+// each, so frames should be ASCII). present() compares it with what is on
+// screen and, for each row, emits a cursor move and the changed span only.
+// Spans separated by a few unchanged cells are merged, because rewriting
+// them is cheaper than another escape sequence. The whole update goes out
+// with a single write(), and an unchanged frame writes nothing. A terminal
+// resize triggers one full redraw.
+//
+// start() switches to the alternate screen and hides the cursor; stop()
+// (also run by the destructor) restores both.
+class TerminalScreen {
+public:
+    explicit TerminalScreen(int fd);
+    ~TerminalScreen();
+
+    // Whether fd is a terminal (otherwise callers print plain lines)
+    static bool isTerminal(int fd);
+
+    bool start();
+    void stop();
+    bool active() const { return active_; }
+
+    // Compose a frame: beginFrame(), then one line() per row from the top.
+    // Lines are cut at the screen width; rows past the height are dropped.
+    void beginFrame();
+    void line(const std::string& text);
+
+    // Draw the frame. Returns the number of bytes written.
+    size_t present();
+
+    int rows() const { return rows_; }
+    int columns() const { return columns_; }
+
+private:
+    TerminalScreen(const TerminalScreen&);
+    TerminalScreen& operator=(const TerminalScreen&);
+
+    static const int kMergeGap = 6;     // Unchanged cells worth rewriting instead of a cursor move
+
+    void resize(int rows, int columns);
+    void appendMove(int row, int column);
+    bool writeAll(const std::string& data);
+
+    int fd_;
+    bool active_;
+    int rows_;
+    int columns_;
+    int next_row_;
+    bool full_redraw_;
+    std::vector<char> front_;       // What the terminal shows
+    std::vector<char> back_;        // Frame being composed
+    std::string out_;               // Escape sequences and text for one write()
+};
+
+#endif // TERMINAL_SCREEN_H
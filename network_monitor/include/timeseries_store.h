@@ -0,0 +1,148 @@
+#ifndef TIMESERIES_STORE_H
+#define TIMESERIES_STORE_H
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Kinds of measurement series and their fixed column layouts
+//   BANDWIDTH:   u64 rx_bytes, tx_bytes            f64 download_bps, upload_bps
+//   LATENCY:     u64 success                       f64 rtt_ms
+//   PACKET_LOSS: u64 sent, received                f64 loss_pct, min, max, avg, jitter, p99
+//   CONNECTIONS: u64 tcp_total, tcp_established, udp_total
+enum class SeriesKind : uint8_t {
+    BANDWIDTH = 1,
+    LATENCY = 2,
+    PACKET_LOSS = 3,
+    CONNECTIONS = 4
+};
+
+const char* seriesKindName(SeriesKind kind);
+bool parseSeriesKind(const std::string& name, SeriesKind& kind);
+
+// Maximum columns of each type in a row (rollup series keep four
+// aggregates per source column)
+const int kMaxSeriesColumns = 32;
+
+// One decoded row
+struct SeriesRow {
+    int64_t timestamp_ns;       // Wall clock, nanoseconds since the epoch
+    uint64_t u[kMaxSeriesColumns];
+    double f[kMaxSeriesColumns];
+};
+
+// A series known to the store
+struct SeriesInfo {
+    uint32_t id;
+    SeriesKind kind;
+    std::string name;           // Interface or host ("" for connections)
+    int u64_columns;
+    int f64_columns;
+};
+
+// Columnar binary time-series store.
+//
+// Data lives in a directory of fixed-size segment files that are mmapped
+// and only ever appended to. Rows are buffered per series and written as
+// blocks of up to kBlockRows rows. Inside a block each metric is its own
+// column: timestamps are delta-of-delta varints, counters are zigzag delta
+// varints, and gauges are XOR-ed against the previous value with
+// zero bytes elided. Segment and block headers carry min/max timestamps,
+// so range queries skip non-matching segments and blocks without decoding
+// them. The series catalog is a small text file next to the segments.
+// Only one process may write a directory at a time (an flock on a lock
+// file); readers need no lock.
+class TimeSeriesStore {
+public:
+    // Rows per encoded block
+    static const uint32_t kBlockRows = 256;
+
+    TimeSeriesStore();
+    ~TimeSeriesStore();
+
+    // Open (creating if needed) a store directory. Segments are created with
+    // segment_bytes capacity. read_only stores cannot append. Fails if
+    // another process has the directory open for writing.
+    bool open(const std::string& directory, bool read_only = false,
+              size_t segment_bytes = 8 * 1024 * 1024);
+    void close();
+    bool isOpen() const { return !directory_.empty(); }
+
+    // Series id for (kind, name), registering it if new. Without explicit
+    // column counts the kind's default layout is used.
+    uint32_t seriesId(SeriesKind kind, const std::string& name);
+    uint32_t seriesId(SeriesKind kind, const std::string& name, int u64_columns, int f64_columns);
+
+    // Look up an existing series without registering it
+    bool findSeries(SeriesKind kind, const std::string& name, uint32_t& id) const;
+
+    // Start a new segment once the current one spans more than span_ns, so
+    // retention can drop data at that granularity (0 = only when full)
+    void setSegmentSpan(int64_t span_ns) { segment_span_ns_ = span_ns; }
+
+    // Buffer a row; u/f must hold the kind's column counts
+    bool append(uint32_t series_id, int64_t timestamp_ns, const uint64_t* u, const double* f);
+
+    // Encode every partially filled block into the segments
+    void flush();
+
+    // Series in the catalog
+    const std::vector<SeriesInfo>& series() const { return catalog_; }
+
+    // Visit rows of one series with from_ns <= timestamp <= to_ns in time order
+    // (rows still buffered for writing are included)
+    bool query(uint32_t series_id, int64_t from_ns, int64_t to_ns,
+               const std::function<void(const SeriesRow&)>& visit) const;
+
+    // Delete whole segments whose newest row is older than cutoff_ns. The
+    // segment being appended to is kept. Returns the number removed.
+    int dropSegmentsBefore(int64_t cutoff_ns);
+
+    // Oldest and newest timestamp in the store; false if it holds no rows
+    bool timeRange(int64_t& first_ns, int64_t& last_ns) const;
+
+    // Bytes used by segment data
+    uint64_t bytesUsed() const;
+
+    const std::string& directory() const { return directory_; }
+
+    // Encode and decode synthetic blocks and compare every value; a failure
+    // is described on report
+    static bool checkCodec(std::ostream& report);
+
+private:
+    TimeSeriesStore(const TimeSeriesStore&);
+    TimeSeriesStore& operator=(const TimeSeriesStore&);
+
+    struct Segment;
+
+    struct PendingBlock {
+        std::vector<SeriesRow> rows;
+    };
+
+    bool loadCatalog();
+    bool openSegments();
+    Segment* createSegment();
+    bool writeBlock(uint32_t series_id, const std::vector<SeriesRow>& rows);
+
+    std::string directory_;
+    bool read_only_;
+    int lock_fd_;                   // Holds the writer flock, -1 if read-only
+    size_t segment_bytes_;
+    int64_t segment_span_ns_;
+    std::vector<SeriesInfo> catalog_;
+    std::map<std::pair<int, std::string>, uint32_t> catalog_index_;
+    std::vector<std::unique_ptr<Segment> > segments_;
+    std::map<uint32_t, PendingBlock> pending_;
+    std::vector<uint8_t> encode_buffer_;
+    uint32_t next_segment_number_;
+};
+
+// Column counts for a series kind
+void seriesColumns(SeriesKind kind, int& u64_columns, int& f64_columns);
+
+#endif // TIMESERIES_STORE_H
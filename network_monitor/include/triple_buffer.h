@@ -0,0 +1,51 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Wait-free handoff of the latest value from one writer thread to one
+// reader thread.
+//
+// The writer fills writeBuffer() and calls publish(), which swaps it with
+// the shared middle slot. read() takes the middle slot only if something
+// new was published. Neither side ever waits for the other: a slow reader
+// just sees the newest value when it next looks, and intermediate values
+// are dropped. The writer must rewrite the whole value before every
+// publish(), because the buffer it gets back can hold older contents.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : middle_(1), write_(0), read_(2) {}
+
+    // Buffer owned by the writer until the next publish()
+    T& writeBuffer() { return buffers_[write_]; }
+
+    // Make the write buffer the latest value
+    void publish() {
+        unsigned previous = middle_.exchange(write_ | kFresh, std::memory_order_acq_rel);
+        write_ = previous & kIndexMask;
+    }
+
+    // Latest published value (reader thread only); valid until the next read()
+    const T& read() {
+        if (middle_.load(std::memory_order_relaxed) & kFresh) {
+            unsigned previous = middle_.exchange(read_, std::memory_order_acq_rel);
+            read_ = previous & kIndexMask;
+        }
+        return buffers_[read_];
+    }
+
+private:
+    TripleBuffer(const TripleBuffer&);
+    TripleBuffer& operator=(const TripleBuffer&);
+
+    static const unsigned kIndexMask = 3;
+    static const unsigned kFresh = 4;
+
+    T buffers_[3];
+    std::atomic<unsigned> middle_;      // Index of the shared slot | kFresh
+    unsigned write_;
+    unsigned read_;
+};
+
+#endif // TRIPLE_BUFFER_H
@@ -0,0 +1,141 @@
+#include "adaptive_sampler.h"
+#include <algorithm>
+#include <cmath>
+
+const double AdaptiveSampler::kBurstVariation = 0.3;
+const double AdaptiveSampler::kQuietVariation = 0.1;
+const double AdaptiveSampler::kRateFloorBps = 1000000.0;     // Below 1 Mbps counts as idle
+const double AdaptiveSampler::kSmoothing = 0.3;
+
+AdaptiveSampler::AdaptiveSampler(int64_t min_interval_ns, int64_t base_interval_ns, double budget_per_second)
+    : min_interval_ns_(min_interval_ns),
+      base_interval_ns_(std::max(min_interval_ns, base_interval_ns)),
+      tolerance_ns_(min_interval_ns / 2),
+      budget_(budget_per_second),
+      demand_(0.0),
+      changed_(false) {
+}
+
+void AdaptiveSampler::resize(size_t count) {
+    if (count <= tracked_.size()) {
+        return;
+    }
+    tracked_.resize(count, 0);
+    wanted_ns_.resize(count, base_interval_ns_);
+    effective_ns_.resize(count, base_interval_ns_);
+    last_ns_.resize(count, 0);
+    mean_.resize(count, 0.0);
+    variance_.resize(count, 0.0);
+    samples_.resize(count, 0);
+}
+
+void AdaptiveSampler::track(size_t index) {
+    resize(index + 1);
+    tracked_[index] = 1;
+    wanted_ns_[index] = base_interval_ns_;
+    effective_ns_[index] = base_interval_ns_;
+    last_ns_[index] = 0;
+    mean_[index] = 0.0;
+    variance_[index] = 0.0;
+    samples_[index] = 0;
+    changed_ = true;
+}
+
+void AdaptiveSampler::untrack(size_t index) {
+    if (index < tracked_.size() && tracked_[index]) {
+        tracked_[index] = 0;
+        changed_ = true;
+    }
+}
+
+bool AdaptiveSampler::due(size_t index, int64_t now_ns) const {
+    return tracked_[index] &&
+           (last_ns_[index] == 0 || now_ns - last_ns_[index] + tolerance_ns_ >= effective_ns_[index]);
+}
+
+bool AdaptiveSampler::anyDue(int64_t now_ns) const {
+    for (size_t i = 0; i < tracked_.size(); i++) {
+        if (due(i, now_ns)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Update the variability estimate and step the wanted interval
+void AdaptiveSampler::sampled(size_t index, int64_t now_ns, double rate_bps) {
+    bool first = last_ns_[index] == 0;
+    last_ns_[index] = now_ns;
+    if (first) {
+        return;     // The first reading has no rate yet
+    }
+
+    if (samples_[index]++ == 0) {
+        mean_[index] = rate_bps;
+        return;
+    }
+    double deviation = rate_bps - mean_[index];
+    mean_[index] += kSmoothing * deviation;
+    variance_[index] = (1.0 - kSmoothing) * (variance_[index] + kSmoothing * deviation * deviation);
+    double variation = std::sqrt(variance_[index]) / std::max(mean_[index], kRateFloorBps);
+
+    int64_t wanted = wanted_ns_[index];
+    if (variation > kBurstVariation) {
+        wanted = std::max(min_interval_ns_, wanted / 2);
+    } else if (variation < kQuietVariation) {
+        wanted = std::min(base_interval_ns_, wanted * 2);
+    }
+    if (wanted != wanted_ns_[index]) {
+        wanted_ns_[index] = wanted;
+        changed_ = true;
+    }
+}
+
+// Samples per second if no interval may be shorter than floor_ns
+double AdaptiveSampler::scheduledDemand(int64_t floor_ns) const {
+    double demand = 0.0;
+    for (size_t i = 0; i < tracked_.size(); i++) {
+        if (tracked_[i]) {
+            demand += 1e9 / std::max(wanted_ns_[i], floor_ns);
+        }
+    }
+    return demand;
+}
+
+void AdaptiveSampler::schedule(int64_t floor_ns, double scale) {
+    demand_ = 0.0;
+    for (size_t i = 0; i < tracked_.size(); i++) {
+        effective_ns_[i] = static_cast<int64_t>(std::max(wanted_ns_[i], floor_ns) * scale);
+        if (tracked_[i]) {
+            demand_ += 1e9 / effective_ns_[i];
+        }
+    }
+}
+
+// Fit the wanted intervals into the budget (see the class comment)
+void AdaptiveSampler::rebalance() {
+    if (!changed_) {
+        return;
+    }
+    changed_ = false;
+
+    double wanted_demand = scheduledDemand(min_interval_ns_);
+    if (budget_ <= 0.0 || wanted_demand <= budget_) {
+        schedule(min_interval_ns_, 1.0);
+    } else if (scheduledDemand(base_interval_ns_) > budget_) {
+        schedule(min_interval_ns_, wanted_demand / budget_);
+    } else {
+        // Binary search the smallest common floor that fits
+        int64_t low = min_interval_ns_;
+        int64_t high = base_interval_ns_;
+        while (high - low > min_interval_ns_ / 16 + 1) {
+            int64_t middle = low + (high - low) / 2;
+            if (scheduledDemand(middle) > budget_) {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+        schedule(high, 1.0);
+    }
+}
@@ -0,0 +1,185 @@
+#include "anomaly_detector.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+const char* anomalyMetricName(int metric) {
+    static const char* const kNames[kAnomalyMetrics] = { "download", "upload", "rtt", "loss" };
+    return metric >= 0 && metric < kAnomalyMetrics ? kNames[metric] : "unknown";
+}
+
+bool parseAnomalyMethod(const std::string& text, AnomalyMethod& method) {
+    if (text == "ewma") {
+        method = AnomalyMethod::EWMA;
+    } else if (text == "holt-winters" || text == "hw") {
+        method = AnomalyMethod::HOLT_WINTERS;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+AnomalyDetector::AnomalyDetector(const AnomalyConfig& config)
+    : config_(config), slot_ns_(1) {
+    if (config_.season_slots == 0) {
+        config_.season_slots = 1;
+    }
+    slot_ns_ = std::max<int64_t>(1, config_.season_ns / static_cast<int64_t>(config_.season_slots));
+}
+
+void AnomalyDetector::resize(size_t count) {
+    size_t old_size = series_.size();
+    if (count <= old_size) {
+        return;
+    }
+    series_.resize(count);
+    for (size_t i = old_size; i < count; i++) {
+        reset(i);
+    }
+}
+
+void AnomalyDetector::reset(size_t series) {
+    Series& s = series_[series];
+    s.mean = 0.0;
+    s.trend = 0.0;
+    s.variance = 0.0;
+    s.samples = 0;
+    s.slot = -1;
+    s.slot_sum = 0.0;
+    s.slot_samples = 0;
+    s.slots_closed = 0;
+    s.learned = false;
+    s.active = false;
+
+    if (config_.method == AnomalyMethod::HOLT_WINTERS) {
+        size_t slots = config_.season_slots;
+        if (seasonal_.size() < (series + 1) * slots) {
+            seasonal_.resize(series_.size() * slots, std::numeric_limits<double>::quiet_NaN());
+        }
+        std::fill(seasonal_.begin() + series * slots, seasonal_.begin() + (series + 1) * slots,
+                  std::numeric_limits<double>::quiet_NaN());
+    }
+}
+
+double& AnomalyDetector::seasonal(size_t series, int64_t slot) {
+    int64_t slots = static_cast<int64_t>(config_.season_slots);
+    return seasonal_[series * config_.season_slots + static_cast<size_t>(slot % slots)];
+}
+
+// Seasonal offset at a point in time, interpolated between the centres of
+// the neighbouring slots so the prediction does not step at slot edges
+double AnomalyDetector::seasonalAt(size_t series, int64_t time_ns) {
+    int64_t slot = time_ns / slot_ns_;
+    double position = static_cast<double>(time_ns - slot * slot_ns_) / slot_ns_ - 0.5;
+    double here = seasonal(series, slot);
+    int64_t neighbour_slot = position < 0.0 ? slot - 1 : slot + 1;
+    double neighbour = neighbour_slot < 0 ? here : seasonal(series, neighbour_slot);
+    if (std::isnan(here)) {
+        return std::isnan(neighbour) ? 0.0 : neighbour;
+    }
+    if (std::isnan(neighbour)) {
+        return here;
+    }
+    double weight = std::fabs(position);
+    return here + (neighbour - here) * weight;
+}
+
+// One Holt-Winters step with the mean of the slot that just ended
+void AnomalyDetector::closeSlot(Series& s, size_t series) {
+    double mean = s.slot_sum / s.slot_samples;
+    double& coefficient = seasonal(series, s.slot);
+
+    // First season: store the raw slot means and average them into the
+    // level, then turn the means into offsets from that level
+    if (!s.learned) {
+        coefficient = mean;
+        s.slots_closed++;
+        s.mean += (mean - s.mean) / s.slots_closed;
+        if (s.slots_closed >= config_.season_slots) {
+            size_t first = series * config_.season_slots;
+            for (size_t i = first; i < first + config_.season_slots; i++) {
+                seasonal_[i] -= s.mean;
+            }
+            s.trend = 0.0;
+            s.learned = true;
+        }
+        return;
+    }
+
+    double season = std::isnan(coefficient) ? 0.0 : coefficient;
+    double previous_level = s.mean;
+    s.mean = config_.level_alpha * (mean - season) + (1.0 - config_.level_alpha) * (s.mean + s.trend);
+    s.trend = config_.trend_beta * (s.mean - previous_level) + (1.0 - config_.trend_beta) * s.trend;
+    if (std::isnan(coefficient)) {
+        coefficient = mean - s.mean;
+    } else {
+        coefficient = config_.seasonal_gamma * (mean - s.mean) + (1.0 - config_.seasonal_gamma) * coefficient;
+    }
+}
+
+// Score the sample against the prediction, then update the model
+bool AnomalyDetector::observe(size_t series, int64_t time_ns, double value, AnomalyEvent& event) {
+    if (std::isnan(value) || std::isinf(value)) {
+        return false;
+    }
+    Series& s = series_[series];
+
+    double expected;
+    if (config_.method == AnomalyMethod::HOLT_WINTERS) {
+        int64_t slot = time_ns / slot_ns_;
+        if (slot != s.slot) {
+            if (s.slot_samples > 0) {
+                closeSlot(s, series);
+            }
+            s.slot = slot;
+            s.slot_sum = 0.0;
+            s.slot_samples = 0;
+        }
+        s.slot_sum += value;
+        s.slot_samples++;
+        if (!s.learned) {
+            s.samples++;
+            return false;
+        }
+        expected = s.mean + s.trend + seasonalAt(series, time_ns);
+    } else {
+        if (!s.learned) {
+            s.mean = value;
+            s.learned = true;
+            s.samples++;
+            return false;
+        }
+        expected = s.mean;
+    }
+
+    double residual = value - expected;
+    double deviation = std::max(std::sqrt(s.variance), config_.min_deviation);
+    double score = residual / deviation;
+
+    // Clip outliers before they update the baseline
+    double limit = config_.threshold * deviation;
+    double clipped = std::min(std::max(residual, -limit), limit);
+    if (config_.method == AnomalyMethod::EWMA) {
+        s.mean += config_.alpha * clipped;
+    }
+    s.variance = (1.0 - config_.alpha) * (s.variance + config_.alpha * clipped * clipped);
+    s.samples++;
+
+    // Raise above the threshold, clear below half of it
+    bool active = s.active;
+    if (!active && s.samples > config_.warmup && std::fabs(score) > config_.threshold) {
+        active = true;
+    } else if (active && std::fabs(score) < config_.threshold * 0.5) {
+        active = false;
+    }
+    if (active == s.active) {
+        return false;
+    }
+
+    s.active = active;
+    event.active = active;
+    event.value = value;
+    event.expected = expected;
+    event.score = score;
+    return true;
+}
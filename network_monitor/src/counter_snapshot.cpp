@@ -0,0 +1,158 @@
+#include "counter_snapshot.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <net/if.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char* const kSnapshotMagic = "netmonitor-state 1";
+
+// Random UUID the kernel picks at boot
+std::string readBootId() {
+    std::ifstream file("/proc/sys/kernel/random/boot_id");
+    std::string id;
+    std::getline(file, id);
+    return id;
+}
+
+// Create the directory if needed and make sure nobody else controls it:
+// a real directory owned by us that only we can access
+bool privateDirectory(const std::string& directory) {
+    if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+        return false;
+    }
+    struct stat info;
+    return lstat(directory.c_str(), &info) == 0 && S_ISDIR(info.st_mode) &&
+           info.st_uid == geteuid() && (info.st_mode & 077) == 0;
+}
+
+} // namespace
+
+std::string defaultCounterSnapshotPath() {
+    const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir != nullptr && runtime_dir[0] != '\0') {
+        return std::string(runtime_dir) + "/netmonitor.state";
+    }
+
+    // No runtime directory (e.g. cron): a private directory under /tmp, so
+    // other users cannot plant or replace the file
+    std::string directory = "/tmp/netmonitor-" + std::to_string(geteuid());
+    if (!privateDirectory(directory)) {
+        std::cerr << "Warning: " << directory
+                  << " is not a private directory; not using a counter snapshot" << std::endl;
+        return "";
+    }
+    return directory + "/state";
+}
+
+// Read the state file, keeping entries whose boot and ifindex still match.
+// The file must be ours and not writable by anyone else, or the counters
+// (and so the reported rates) could be forged.
+bool loadCounterSnapshot(const std::string& path, std::map<std::string, InterfaceStats>& stats) {
+    stats.clear();
+    int fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_uid != geteuid() ||
+        (info.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+        std::cerr << "Warning: Ignoring counter snapshot " << path
+                  << " (not a private file owned by this user)" << std::endl;
+        close(fd);
+        return false;
+    }
+
+    std::string content;
+    char buffer[4096];
+    ssize_t received;
+    while ((received = read(fd, buffer, sizeof(buffer))) > 0) {
+        content.append(buffer, static_cast<size_t>(received));
+    }
+    close(fd);
+    if (received < 0) {
+        return false;
+    }
+    std::istringstream file(content);
+
+    std::string line;
+    if (!std::getline(file, line) || line != kSnapshotMagic) {
+        return false;
+    }
+    std::string boot_id = readBootId();
+    if (!std::getline(file, line) || boot_id.empty() || line != "boot_id " + boot_id) {
+        return false;
+    }
+
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        InterfaceStats entry;
+        unsigned int ifindex = 0;
+        long long monotonic_ns = 0;
+        if (!(iss >> entry.interface_name >> ifindex >> monotonic_ns >> entry.bytes_received
+                  >> entry.bytes_sent >> entry.packets_received >> entry.packets_sent)) {
+            continue;
+        }
+        if (ifindex == 0 || if_nametoindex(entry.interface_name.c_str()) != ifindex) {
+            continue;
+        }
+        entry.timestamp = std::chrono::steady_clock::time_point(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::nanoseconds(monotonic_ns)));
+        stats[entry.interface_name] = entry;
+    }
+    return true;
+}
+
+// Write every entry with the current boot ID and ifindex
+bool saveCounterSnapshot(const std::string& path, const std::map<std::string, InterfaceStats>& stats) {
+    std::string boot_id = readBootId();
+    if (boot_id.empty()) {
+        return false;
+    }
+
+    std::ostringstream out;
+    out << kSnapshotMagic << "\n" << "boot_id " << boot_id << "\n";
+    for (std::map<std::string, InterfaceStats>::const_iterator it = stats.begin(); it != stats.end(); ++it) {
+        const InterfaceStats& entry = it->second;
+        unsigned int ifindex = if_nametoindex(entry.interface_name.c_str());
+        if (ifindex == 0) {
+            continue;
+        }
+        long long monotonic_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            entry.timestamp.time_since_epoch()).count();
+        out << entry.interface_name << "\t" << ifindex << "\t" << monotonic_ns << "\t"
+            << entry.bytes_received << "\t" << entry.bytes_sent << "\t"
+            << entry.packets_received << "\t" << entry.packets_sent << "\n";
+    }
+    std::string content = out.str();
+
+    // Concurrent runs each write their own temporary file; the last rename
+    // wins. mkstemp() creates it with O_EXCL and mode 0600 under a random
+    // name, so a file planted in advance is never written through.
+    std::vector<char> temp_name(path.begin(), path.end());
+    const char kSuffix[] = ".XXXXXX";
+    temp_name.insert(temp_name.end(), kSuffix, kSuffix + sizeof(kSuffix));
+    int fd = mkstemp(&temp_name[0]);
+    if (fd < 0) {
+        return false;
+    }
+    std::string temp_path(&temp_name[0]);
+    bool ok = write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size());
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,276 @@
+#include "csv_logger.h"
+#include "anomaly_detector.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace {
+
+// Whether a non-empty file starts with exactly this header line
+bool headerMatches(int fd, const char* header) {
+    size_t length = strlen(header);
+    std::string first(length, '\0');
+    return pread(fd, &first[0], length, 0) == static_cast<ssize_t>(length) && first == header;
+}
+
+// Move a file aside to the first free <filename>.<n>
+bool rotateAside(const std::string& filename, std::string& rotated) {
+    for (int n = 1; n < 1000; n++) {
+        rotated = filename + "." + std::to_string(n);
+        struct stat info;
+        if (lstat(rotated.c_str(), &info) != 0 && errno == ENOENT) {
+            return rename(filename.c_str(), rotated.c_str()) == 0;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+CsvLogger::CsvLogger(const std::string& filename, const char* header, int flush_interval_ms)
+    : fd_(-1), wake_fd_(-1), flush_interval_ms_(flush_interval_ms), ring_(new Slot[kRingSize]),
+      head_(0), tail_(0), wake_pending_(false), stopping_(false),
+      cached_second_(0), cached_prefix_len_(0) {
+    for (size_t i = 0; i < kRingSize; i++) {
+        ring_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        return;
+    }
+
+    fd_ = open(filename.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        return;
+    }
+
+    // Rows are only appended under the same header. A file with another
+    // layout (e.g. from an older version) is moved aside, not mixed.
+    struct stat existing;
+    if (fstat(fd_, &existing) == 0 && existing.st_size > 0 && !headerMatches(fd_, header)) {
+        ::close(fd_);
+        fd_ = -1;
+        std::string rotated;
+        if (!rotateAside(filename, rotated)) {
+            std::cerr << "Error: " << filename << " has a different CSV header and could not be moved aside; "
+                      << "not appending to it" << std::endl;
+            return;
+        }
+        std::cerr << "Warning: " << filename << " has a different CSV header; moved it to " << rotated
+                  << " and starting a new file" << std::endl;
+        fd_ = open(filename.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            return;
+        }
+    }
+
+    buffer_.reserve(kFlushBytes + 1024);
+
+    // Write header if new file
+    struct stat info;
+    if (fstat(fd_, &info) == 0 && info.st_size == 0) {
+        buffer_.append(header);
+        flushBuffer();
+    }
+
+    writer_ = std::thread(&CsvLogger::writerLoop, this);
+}
+
+CsvLogger::~CsvLogger() {
+    close();
+}
+
+// Drain the queue, write what is buffered and close the file
+void CsvLogger::close() {
+    if (writer_.joinable()) {
+        stopping_.store(true, std::memory_order_release);
+        wakeWriter();
+        writer_.join();
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    if (wake_fd_ >= 0) {
+        ::close(wake_fd_);
+        wake_fd_ = -1;
+    }
+}
+
+// Interrupt the writer's wait
+void CsvLogger::wakeWriter() {
+    uint64_t one = 1;
+    ssize_t written = write(wake_fd_, &one, sizeof(one));
+    (void)written;
+}
+
+// Header line for each kind of record
+const char* CsvLogger::headerFor(LogRecord::Kind kind) {
+    switch (kind) {
+        case LogRecord::BANDWIDTH:
+            return "Timestamp,Interface,Download_bps,Upload_bps,Download_Mbps,Upload_Mbps,Interval_s\n";
+        case LogRecord::LATENCY:
+            return "Timestamp,Host,RTT_ms,Success\n";
+        case LogRecord::PACKET_LOSS:
+            return "Timestamp,Host,Packets_Sent,Packets_Received,Loss_Percentage,"
+                   "Min_RTT_ms,Max_RTT_ms,Avg_RTT_ms,Jitter_ms\n";
+        case LogRecord::ALERT:
+            return "Timestamp,Series,Metric,State,Value,Expected,Z_Score\n";
+        default:
+            return "Timestamp,TCP_Total,TCP_Established,UDP_Total,Total_Connections\n";
+    }
+}
+
+// Copy a record into the ring (producer side). Producers claim positions
+// with a compare-and-swap on head_ and publish through the slot's sequence,
+// so no producer ever waits for another one.
+void CsvLogger::push(const LogRecord& record) {
+    size_t position = head_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &ring_[position & (kRingSize - 1)];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence == position) {
+            if (head_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (sequence < position) {
+            // Full: the writer has not consumed this slot's previous record yet
+            std::this_thread::yield();
+            position = head_.load(std::memory_order_relaxed);
+        } else {
+            position = head_.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->record = record;
+    slot->sequence.store(position + 1, std::memory_order_release);
+
+    // Wake the writer early once a quarter of the ring is queued
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (position + 1 > tail && position + 1 - tail >= kWakeRecords &&
+        !wake_pending_.exchange(true, std::memory_order_acq_rel)) {
+        wakeWriter();
+    }
+}
+
+// Append one formatted row to the write buffer
+void CsvLogger::formatRecord(const LogRecord& record) {
+    // Timestamp formatting only happens once per second of data
+    if (record.wall_time != cached_second_ || cached_prefix_len_ == 0) {
+        struct tm local;
+        localtime_r(&record.wall_time, &local);
+        cached_prefix_len_ = strftime(cached_prefix_, sizeof(cached_prefix_), "%Y-%m-%d %H:%M:%S,", &local);
+        cached_second_ = record.wall_time;
+    }
+    buffer_.append(cached_prefix_, cached_prefix_len_);
+
+    char line[512];
+    int length = 0;
+    const double* v = record.values;
+    const long long* c = record.counts;
+
+    switch (record.kind) {
+        case LogRecord::BANDWIDTH:
+            length = snprintf(line, sizeof(line), "%s,%.2f,%.2f,%.2f,%.2f,%.3f\n",
+                              record.name, v[0], v[1], v[0] / 1000000.0, v[1] / 1000000.0, v[2]);
+            break;
+        case LogRecord::LATENCY:
+            length = snprintf(line, sizeof(line), "%s,%.2f,%s\n",
+                              record.name, v[0], c[0] ? "Yes" : "No");
+            break;
+        case LogRecord::PACKET_LOSS:
+            length = snprintf(line, sizeof(line), "%s,%lld,%lld,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+                              record.name, c[0], c[1], v[0], v[1], v[2], v[3], v[4]);
+            break;
+        case LogRecord::CONNECTIONS:
+            length = snprintf(line, sizeof(line), "%lld,%lld,%lld,%lld\n",
+                              c[0], c[1], c[2], c[0] + c[2]);
+            break;
+        case LogRecord::ALERT:
+            length = snprintf(line, sizeof(line), "%s,%s,%s,%.2f,%.2f,%.2f\n",
+                              record.name, anomalyMetricName(static_cast<int>(c[0])),
+                              c[1] ? "alert" : "cleared", v[0], v[1], v[2]);
+            break;
+    }
+
+    if (length > 0) {
+        buffer_.append(line, static_cast<size_t>(length) < sizeof(line) ? length : sizeof(line) - 1);
+    }
+}
+
+// Write the whole buffer with as few write() calls as possible
+void CsvLogger::flushBuffer() {
+    size_t written = 0;
+    while (written < buffer_.size()) {
+        ssize_t n = write(fd_, buffer_.data() + written, buffer_.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error: Could not write CSV file: " << strerror(errno) << std::endl;
+            break;
+        }
+        written += static_cast<size_t>(n);
+    }
+    buffer_.clear();
+}
+
+// Background thread: drain the ring, format, write in batches. Sleeps until
+// the next flush is due unless a producer or close() wakes it first.
+void CsvLogger::writerLoop() {
+    auto last_flush = std::chrono::steady_clock::now();
+    const std::chrono::milliseconds flush_interval(flush_interval_ms_);
+
+    while (true) {
+        bool stopping = stopping_.load(std::memory_order_acquire);
+        wake_pending_.store(false, std::memory_order_release);
+
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = ring_[tail & (kRingSize - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != tail + 1) {
+                break;
+            }
+            formatRecord(slot.record);
+            slot.sequence.store(tail + kRingSize, std::memory_order_release);
+            tail++;
+            tail_.store(tail, std::memory_order_relaxed);
+            if (buffer_.size() >= kFlushBytes) {
+                flushBuffer();
+                last_flush = std::chrono::steady_clock::now();
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (!buffer_.empty() && (stopping || now - last_flush >= flush_interval)) {
+            flushBuffer();
+        }
+        if (now - last_flush >= flush_interval) {
+            last_flush = now;
+        }
+
+        if (stopping) {
+            return;
+        }
+
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(last_flush + flush_interval - now);
+        struct pollfd wake;
+        wake.fd = wake_fd_;
+        wake.events = POLLIN;
+        if (poll(&wake, 1, static_cast<int>(std::max<long long>(1, wait.count()))) > 0) {
+            uint64_t count;
+            ssize_t drained = read(wake_fd_, &count, sizeof(count));
+            (void)drained;
+        }
+    }
+}
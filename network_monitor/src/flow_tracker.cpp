@@ -0,0 +1,169 @@
+#include "flow_tracker.h"
+#include "sock_diag.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/inet_diag.h>
+#include <linux/rtnetlink.h>
+#include <linux/tcp.h>
+
+namespace {
+
+// Kernel TCP states (include/net/tcp_states.h); <linux/tcp.h> does not
+// export them and <netinet/tcp.h> clashes with its struct tcp_info
+enum {
+    kTcpEstablished = 1,
+    kTcpSynSent = 2,
+    kTcpFinWait1 = 4,
+    kTcpFinWait2 = 5,
+    kTcpCloseWait = 8,
+    kTcpLastAck = 9,
+    kTcpClosing = 11
+};
+
+// Sockets that can carry data; listeners, TIME_WAIT and request sockets
+// have no tcp_info
+const uint32_t kFlowStates = tcpStateMask(kTcpEstablished) | tcpStateMask(kTcpSynSent) |
+                             tcpStateMask(kTcpFinWait1) | tcpStateMask(kTcpFinWait2) |
+                             tcpStateMask(kTcpCloseWait) | tcpStateMask(kTcpLastAck) |
+                             tcpStateMask(kTcpClosing);
+
+// Bytes of tcp_info needed to read a field (older kernels send less)
+#define TCP_INFO_HAS(len, field) \
+    ((len) >= offsetof(struct tcp_info, field) + sizeof(((struct tcp_info*)0)->field))
+
+// Order for the top-K heap: the front is the least busy flow kept so far
+struct BusierFlow {
+    bool operator()(const FlowRate* a, const FlowRate* b) const {
+        return a->tx_bps + a->rx_bps > b->tx_bps + b->rx_bps;
+    }
+};
+
+} // namespace
+
+TcpFlowTracker::TcpFlowTracker(SockDiagClient& client)
+    : client_(client), generation_(0), active_(0) {
+}
+
+// Dump connected TCP sockets and update per-cookie rates
+bool TcpFlowTracker::sample() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - last_sample_).count();
+    bool have_previous = generation_ > 0 && elapsed > 0.0;
+    uint64_t generation = ++generation_;
+    size_t active = 0;
+
+    SockDiagClient::Visitor visit = [&](const struct inet_diag_msg& msg,
+                                        const struct rtattr* attrs, int attrs_len) {
+        const struct tcp_info* info = nullptr;
+        size_t info_len = 0;
+        for (const struct rtattr* attr = attrs; RTA_OK(attr, attrs_len);
+             attr = RTA_NEXT(attr, attrs_len)) {
+            if (attr->rta_type == INET_DIAG_INFO) {
+                info = (const struct tcp_info*)RTA_DATA(attr);
+                info_len = RTA_PAYLOAD(attr);
+                break;
+            }
+        }
+        if (info == nullptr || !TCP_INFO_HAS(info_len, tcpi_bytes_received)) {
+            return;
+        }
+
+        uint64_t cookie = static_cast<uint64_t>(msg.id.idiag_cookie[0]) |
+                          (static_cast<uint64_t>(msg.id.idiag_cookie[1]) << 32);
+        std::pair<std::unordered_map<uint64_t, FlowEntry>::iterator, bool> inserted =
+            flows_.insert(std::make_pair(cookie, FlowEntry()));
+        FlowEntry& entry = inserted.first->second;
+        FlowRate& rate = entry.rate;
+
+        if (inserted.second) {
+            rate.cookie = cookie;
+            rate.family = msg.idiag_family;
+            memset(rate.local_address, 0, sizeof(rate.local_address));
+            memset(rate.remote_address, 0, sizeof(rate.remote_address));
+            size_t address_len = msg.idiag_family == AF_INET6 ? 16 : 4;
+            memcpy(rate.local_address, msg.id.idiag_src, address_len);
+            memcpy(rate.remote_address, msg.id.idiag_dst, address_len);
+            rate.local_port = ntohs(msg.id.idiag_sport);
+            rate.remote_port = ntohs(msg.id.idiag_dport);
+            rate.tx_bps = 0.0;
+            rate.rx_bps = 0.0;
+            entry.has_rate = false;
+        } else if (have_previous && entry.generation == generation - 1) {
+            // Cookies are unique per boot, so counters only move forward
+            uint64_t acked = info->tcpi_bytes_acked >= entry.bytes_acked ?
+                             info->tcpi_bytes_acked - entry.bytes_acked : 0;
+            uint64_t received = info->tcpi_bytes_received >= entry.bytes_received ?
+                                info->tcpi_bytes_received - entry.bytes_received : 0;
+            rate.tx_bps = acked * 8.0 / elapsed;
+            rate.rx_bps = received * 8.0 / elapsed;
+            entry.has_rate = true;
+            if (acked > 0 || received > 0) {
+                active++;
+            }
+        }
+
+        rate.state = msg.idiag_state;
+        rate.delivery_bps = TCP_INFO_HAS(info_len, tcpi_delivery_rate) ?
+                            info->tcpi_delivery_rate * 8.0 : 0.0;
+        rate.rtt_ms = info->tcpi_rtt / 1000.0;
+        entry.bytes_acked = info->tcpi_bytes_acked;
+        entry.bytes_received = info->tcpi_bytes_received;
+        entry.generation = generation;
+    };
+
+    uint8_t extensions = 1 << (INET_DIAG_INFO - 1);
+    if (!client_.dump(AF_INET, IPPROTO_TCP, kFlowStates, extensions, visit)) {
+        return false;
+    }
+    // IPv6 may be disabled; IPv4 results are still valid
+    client_.dump(AF_INET6, IPPROTO_TCP, kFlowStates, extensions, visit);
+
+    // Forget sockets that were closed since the previous snapshot
+    for (std::unordered_map<uint64_t, FlowEntry>::iterator it = flows_.begin(); it != flows_.end();) {
+        if (it->second.generation != generation) {
+            it = flows_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    active_ = active;
+    last_sample_ = now;
+    return true;
+}
+
+// Select the busiest flows with a bounded min-heap
+void TcpFlowTracker::topK(size_t k, std::vector<FlowRate>& out) const {
+    out.clear();
+    if (k == 0) {
+        return;
+    }
+
+    std::vector<const FlowRate*> heap;
+    heap.reserve(std::min(k, flows_.size()));
+    BusierFlow busier;
+    for (std::unordered_map<uint64_t, FlowEntry>::const_iterator it = flows_.begin();
+         it != flows_.end(); ++it) {
+        const FlowEntry& entry = it->second;
+        if (!entry.has_rate || entry.rate.tx_bps + entry.rate.rx_bps <= 0.0) {
+            continue;
+        }
+        if (heap.size() < k) {
+            heap.push_back(&entry.rate);
+            std::push_heap(heap.begin(), heap.end(), busier);
+        } else if (busier(&entry.rate, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), busier);
+            heap.back() = &entry.rate;
+            std::push_heap(heap.begin(), heap.end(), busier);
+        }
+    }
+
+    std::sort_heap(heap.begin(), heap.end(), busier);
+    out.reserve(heap.size());
+    for (size_t i = 0; i < heap.size(); i++) {
+        out.push_back(*heap[i]);
+    }
+}
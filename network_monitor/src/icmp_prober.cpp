@@ -0,0 +1,219 @@
+#include "icmp_prober.h"
+#include "shutdown.h"
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+WindowedProber::WindowedProber() : epoll_fd_(-1), timer_fd_(-1) {
+}
+
+WindowedProber::~WindowedProber() {
+    if (timer_fd_ >= 0) {
+        close(timer_fd_);
+    }
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+    }
+}
+
+// Create the epoll instance and the deadline timer
+bool WindowedProber::setup(int socket_fd) {
+    if (epoll_fd_ < 0) {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (epoll_fd_ < 0 || timer_fd_ < 0) {
+            return false;
+        }
+
+        struct epoll_event timer_event;
+        timer_event.events = EPOLLIN;
+        timer_event.data.fd = timer_fd_;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_fd_, &timer_event) < 0) {
+            return false;
+        }
+    }
+
+    struct epoll_event socket_event;
+    socket_event.events = EPOLLIN;
+    socket_event.data.fd = socket_fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket_fd, &socket_event) < 0 && errno != EEXIST) {
+        return false;
+    }
+    return true;
+}
+
+// Arm the timerfd for an absolute steady_clock deadline (CLOCK_MONOTONIC)
+void WindowedProber::armTimer(std::chrono::steady_clock::time_point deadline) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+    if (ns <= 0) {
+        ns = 1;
+    }
+
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = 0;
+    spec.it_interval.tv_nsec = 0;
+    spec.it_value.tv_sec = ns / 1000000000LL;
+    spec.it_value.tv_nsec = ns % 1000000000LL;
+    timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+// Run a windowed echo test
+bool WindowedProber::run(IcmpSocket& socket, const struct sockaddr_in& dest, uint16_t id,
+                         const ProbeWindowOptions& options, const ReplyHandler& on_reply,
+                         ProbeWindowResult& result) {
+    result.sent = 0;
+    result.received = 0;
+    result.late = 0;
+    result.duplicates = 0;
+    result.clock_source = TimestampSource::HARDWARE;
+
+    if (!setup(socket.fd())) {
+        return false;
+    }
+
+    const int count = options.count;
+    const int window = options.window > 0 ? options.window : 1;
+    const std::chrono::milliseconds interval(options.interval_ms);
+    const std::chrono::milliseconds timeout(options.timeout_ms);
+
+    slots_.assign(count + 1, Slot());
+    tx_key_probe_.assign(count, 0);
+
+    int in_flight = 0;
+    int oldest = 1;  // Lowest probe number that may still be in flight
+    auto next_send = std::chrono::steady_clock::now();
+
+    // SIGINT/SIGTERM may be delivered to another thread (e.g. the CSV
+    // writer), so the flag is checked every iteration, not only on EINTR
+    while ((result.sent < count || in_flight > 0) && !shutdownRequested()) {
+        auto now = std::chrono::steady_clock::now();
+
+        // Expire probes whose timeout has passed (they expire in send order)
+        while (oldest <= result.sent) {
+            Slot& slot = slots_[oldest];
+            if (slot.state == IN_FLIGHT) {
+                if (slot.sent.user + timeout > now) {
+                    break;
+                }
+                slot.state = TIMED_OUT;
+                in_flight--;
+            }
+            oldest++;
+        }
+
+        // Send as many probes as the schedule and window allow
+        while (result.sent < count && in_flight < window && next_send <= now) {
+            int probe = result.sent + 1;
+            Slot& slot = slots_[probe];
+            slot.state = IN_FLIGHT;
+            result.sent++;
+
+            uint32_t tx_key = 0;
+            if (socket.sendEcho(dest, id, static_cast<uint16_t>(probe & 0xFFFF), &slot.sent, &tx_key)) {
+                in_flight++;
+                if (tx_key < tx_key_probe_.size()) {
+                    tx_key_probe_[tx_key] = probe;
+                }
+            } else {
+                slot.state = TIMED_OUT;
+            }
+
+            // Keep an absolute schedule, but do not burst to catch up after a stall
+            next_send += interval;
+            if (next_send < now) {
+                next_send = now;
+            }
+        }
+
+        if (result.sent >= count && in_flight == 0) {
+            break;
+        }
+
+        // Sleep until the next send or timeout deadline, or until a reply arrives
+        bool have_deadline = false;
+        std::chrono::steady_clock::time_point deadline;
+        if (result.sent < count && in_flight < window) {
+            deadline = next_send;
+            have_deadline = true;
+        }
+        for (int probe = oldest; probe <= result.sent; probe++) {
+            if (slots_[probe].state == IN_FLIGHT) {
+                auto expiry = slots_[probe].sent.user + timeout;
+                if (!have_deadline || expiry < deadline) {
+                    deadline = expiry;
+                    have_deadline = true;
+                }
+                break;
+            }
+        }
+        if (have_deadline) {
+            armTimer(deadline);
+        }
+
+        struct epoll_event events[2];
+        int ready = epoll_wait(epoll_fd_, events, 2, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        for (int i = 0; i < ready; i++) {
+            if (events[i].data.fd == timer_fd_) {
+                unsigned long long expirations;
+                ssize_t n = read(timer_fd_, &expirations, sizeof(expirations));
+                (void)n;
+                continue;
+            }
+
+            // Collect kernel send timestamps before matching replies
+            uint32_t tx_key;
+            PacketTimestamps tx_stamps;
+            while (socket.receiveTxTimestamp(tx_key, tx_stamps) > 0) {
+                if (tx_key < tx_key_probe_.size() && tx_key_probe_[tx_key] > 0) {
+                    mergeTxTimestamps(slots_[tx_key_probe_[tx_key]].sent, tx_stamps);
+                }
+            }
+
+            // Drain every pending reply
+            IcmpEchoReply reply;
+            while (socket.receiveEcho(reply) > 0) {
+                if (reply.id != id || reply.from.sin_addr.s_addr != dest.sin_addr.s_addr) {
+                    continue;
+                }
+
+                // Map the 16-bit wire sequence to the most recent matching probe
+                int probe = result.sent - ((result.sent - reply.sequence) & 0xFFFF);
+                if (probe < 1) {
+                    continue;
+                }
+
+                Slot& slot = slots_[probe];
+                if (slot.state == IN_FLIGHT) {
+                    slot.state = REPLIED;
+                    in_flight--;
+                    result.received++;
+                    TimestampSource source;
+                    double rtt_ms = computeRtt(slot.sent, reply.timestamps, source);
+                    if (source < result.clock_source) {
+                        result.clock_source = source;
+                    }
+                    on_reply(probe, rtt_ms);
+                } else if (slot.state == REPLIED) {
+                    result.duplicates++;
+                } else if (slot.state == TIMED_OUT) {
+                    result.late++;
+                }
+            }
+        }
+    }
+
+    if (result.received == 0) {
+        result.clock_source = TimestampSource::USERSPACE;
+    }
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket.fd(), nullptr);
+    return true;
+}
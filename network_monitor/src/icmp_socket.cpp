@@ -0,0 +1,314 @@
+#include "icmp_socket.h"
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
+#include <arpa/inet.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+namespace {
+
+long long timespecToNs(const struct timespec& ts) {
+    return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+// Fill the userspace fields of a timestamp record
+void stampUser(PacketTimestamps& stamps) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    stamps.user = std::chrono::steady_clock::now();
+    stamps.user_realtime_ns = timespecToNs(now);
+    stamps.software_ns = 0;
+    stamps.hardware_ns = 0;
+}
+
+// Copy kernel timestamps out of SCM_TIMESTAMPING / SCM_TIMESTAMPNS
+void readTimestampCmsg(struct msghdr& msg, PacketTimestamps& stamps) {
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET) {
+            continue;
+        }
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            struct scm_timestamping ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            stamps.software_ns = timespecToNs(ts.ts[0]);
+            stamps.hardware_ns = timespecToNs(ts.ts[2]);
+        } else if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            stamps.software_ns = timespecToNs(ts);
+        }
+    }
+}
+
+} // namespace
+
+// Calculate ICMP checksum
+unsigned short icmpChecksum(const void* data, int length) {
+    unsigned long sum = 0;
+    const unsigned short* ptr = static_cast<const unsigned short*>(data);
+
+    // Sum all 16-bit words
+    while (length > 1) {
+        sum += *ptr++;
+        length -= 2;
+    }
+
+    // Add any remaining byte
+    if (length > 0) {
+        sum += *(const unsigned char*)ptr;
+    }
+
+    // Fold 32-bit sum to 16 bits
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+
+    return (unsigned short)(~sum);
+}
+
+// Human readable clock source
+const char* timestampSourceName(TimestampSource source) {
+    switch (source) {
+        case TimestampSource::HARDWARE:  return "hardware";
+        case TimestampSource::KERNEL:    return "kernel";
+        case TimestampSource::KERNEL_RX: return "kernel-rx";
+        default:                         return "userspace";
+    }
+}
+
+// RTT from the best clock both timestamps have in common
+double computeRtt(const PacketTimestamps& sent, const PacketTimestamps& received,
+                  TimestampSource& source) {
+    if (sent.hardware_ns != 0 && received.hardware_ns != 0) {
+        source = TimestampSource::HARDWARE;
+        return (received.hardware_ns - sent.hardware_ns) / 1000000.0;
+    }
+    if (sent.software_ns != 0 && received.software_ns != 0) {
+        source = TimestampSource::KERNEL;
+        return (received.software_ns - sent.software_ns) / 1000000.0;
+    }
+    if (received.software_ns != 0 && received.software_ns >= sent.user_realtime_ns) {
+        source = TimestampSource::KERNEL_RX;
+        return (received.software_ns - sent.user_realtime_ns) / 1000000.0;
+    }
+
+    source = TimestampSource::USERSPACE;
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(received.user - sent.user);
+    return duration.count() / 1000.0;
+}
+
+IcmpSocket::IcmpSocket()
+    : sock_(-1), rx_timestamps_(false), tx_timestamps_(false), next_tx_key_(0) {
+}
+
+IcmpSocket::~IcmpSocket() {
+    close();
+}
+
+// Create the raw socket
+bool IcmpSocket::open(bool nonblocking) {
+    close();
+
+    int type = SOCK_RAW | SOCK_CLOEXEC;
+    if (nonblocking) {
+        type |= SOCK_NONBLOCK;
+    }
+    sock_ = socket(AF_INET, type, IPPROTO_ICMP);
+    return sock_ >= 0;
+}
+
+void IcmpSocket::close() {
+    if (sock_ >= 0) {
+        ::close(sock_);
+        sock_ = -1;
+    }
+    rx_timestamps_ = false;
+    tx_timestamps_ = false;
+    next_tx_key_ = 0;
+}
+
+// Set SO_RCVTIMEO for blocking receives
+bool IcmpSocket::setReceiveTimeout(int timeout_ms) {
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    return setsockopt(sock_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == 0;
+}
+
+// Enable kernel send and receive timestamps
+bool IcmpSocket::enableTimestamps() {
+    int flags = SOF_TIMESTAMPING_SOFTWARE |
+                SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_TX_SOFTWARE |
+                SOF_TIMESTAMPING_RAW_HARDWARE |
+                SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_TX_HARDWARE |
+                SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    if (setsockopt(sock_, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0) {
+        rx_timestamps_ = true;
+        tx_timestamps_ = true;
+        next_tx_key_ = 0;
+        return true;
+    }
+
+    int enable = 1;
+    if (setsockopt(sock_, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) == 0) {
+        rx_timestamps_ = true;
+        return true;
+    }
+    return false;
+}
+
+// Send one ICMP echo request
+bool IcmpSocket::sendEcho(const struct sockaddr_in& dest, uint16_t id, uint16_t sequence,
+                          PacketTimestamps* sent, uint32_t* tx_key) {
+    struct icmphdr icmp_hdr;
+    memset(&icmp_hdr, 0, sizeof(icmp_hdr));
+    icmp_hdr.type = ICMP_ECHO;
+    icmp_hdr.code = 0;
+    icmp_hdr.un.echo.id = htons(id);
+    icmp_hdr.un.echo.sequence = htons(sequence);
+    icmp_hdr.checksum = 0;
+    icmp_hdr.checksum = icmpChecksum(&icmp_hdr, sizeof(icmp_hdr));
+
+    if (sent != nullptr) {
+        stampUser(*sent);
+    }
+
+    ssize_t result = sendto(sock_, &icmp_hdr, sizeof(icmp_hdr), 0,
+                            (const struct sockaddr*)&dest, sizeof(dest));
+    if (result != static_cast<ssize_t>(sizeof(icmp_hdr))) {
+        return false;
+    }
+
+    // The kernel numbers timestamped sends in order (SOF_TIMESTAMPING_OPT_ID)
+    if (tx_key != nullptr) {
+        *tx_key = next_tx_key_;
+    }
+    if (tx_timestamps_) {
+        next_tx_key_++;
+    }
+    return true;
+}
+
+// Receive the next echo reply
+int IcmpSocket::receiveEcho(IcmpEchoReply& reply) {
+    char recv_buffer[1024];
+    char control[256];
+
+    while (true) {
+        struct iovec iov;
+        iov.iov_base = recv_buffer;
+        iov.iov_len = sizeof(recv_buffer);
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &reply.from;
+        msg.msg_namelen = sizeof(reply.from);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        if (rx_timestamps_) {
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+        }
+
+        ssize_t received = recvmsg(sock_, &msg, 0);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            return -1;
+        }
+        stampUser(reply.timestamps);
+        if (rx_timestamps_) {
+            readTimestampCmsg(msg, reply.timestamps);
+        }
+
+        // Parse IP header to get to ICMP header
+        const struct iphdr* ip_hdr = (const struct iphdr*)recv_buffer;
+        int ip_header_len = ip_hdr->ihl * 4;
+        if (received < static_cast<ssize_t>(ip_header_len + sizeof(struct icmphdr))) {
+            continue;
+        }
+
+        const struct icmphdr* recv_icmp = (const struct icmphdr*)(recv_buffer + ip_header_len);
+        if (recv_icmp->type != ICMP_ECHOREPLY) {
+            continue;
+        }
+
+        reply.id = ntohs(recv_icmp->un.echo.id);
+        reply.sequence = ntohs(recv_icmp->un.echo.sequence);
+        return 1;
+    }
+}
+
+void mergeTxTimestamps(PacketTimestamps& sent, const PacketTimestamps& entry) {
+    if (entry.software_ns != 0) {
+        sent.software_ns = entry.software_ns;
+    }
+    if (entry.hardware_ns != 0) {
+        sent.hardware_ns = entry.hardware_ns;
+    }
+}
+
+// Read a send timestamp from the socket error queue
+int IcmpSocket::receiveTxTimestamp(uint32_t& tx_key, PacketTimestamps& sent) {
+    if (!tx_timestamps_) {
+        return 0;
+    }
+
+    char data[64];
+    char control[256];
+
+    while (true) {
+        struct iovec iov;
+        iov.iov_base = data;
+        iov.iov_len = sizeof(data);
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t received = recvmsg(sock_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+
+        bool have_key = false;
+        PacketTimestamps stamps;
+        stamps.software_ns = 0;
+        stamps.hardware_ns = 0;
+        readTimestampCmsg(msg, stamps);
+
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) {
+                struct sock_extended_err err;
+                memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+                if (err.ee_origin == SO_EE_ORIGIN_TIMESTAMPING && err.ee_info == SCM_TSTAMP_SND) {
+                    tx_key = err.ee_data;
+                    have_key = true;
+                }
+            }
+        }
+
+        // Other error queue entries (e.g. ICMP errors) are skipped
+        if (have_key) {
+            sent.software_ns = stamps.software_ns;
+            sent.hardware_ns = stamps.hardware_ns;
+            return 1;
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#include "interface_history.h"
+#include <chrono>
+
+InterfaceHistory::InterfaceHistory(size_t capacity)
+    : timestamps_(capacity < 2 ? 2 : capacity), head_(0), count_(0) {
+    for (int i = 0; i < kHistoryCounters; i++) {
+        counters_[i].resize(timestamps_.size());
+    }
+}
+
+void InterfaceHistory::append(const InterfaceStats& stats) {
+    const unsigned long long values[kHistoryCounters] = {
+        stats.bytes_received, stats.bytes_sent, stats.packets_received, stats.packets_sent,
+        stats.receive_errors, stats.receive_dropped, stats.receive_fifo_errors,
+        stats.receive_frame_errors, stats.receive_compressed, stats.receive_multicast,
+        stats.transmit_errors, stats.transmit_dropped, stats.transmit_fifo_errors,
+        stats.transmit_collisions, stats.transmit_carrier_errors, stats.transmit_compressed
+    };
+
+    timestamps_[head_] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        stats.timestamp.time_since_epoch()).count();
+    for (int i = 0; i < kHistoryCounters; i++) {
+        counters_[i][head_] = values[i];
+    }
+
+    head_ = head_ + 1 == timestamps_.size() ? 0 : head_ + 1;
+    if (count_ < timestamps_.size()) {
+        count_++;
+    }
+}
+
+// Scan the readings inside the window once, oldest first
+bool InterfaceHistory::rates(HistoryCounter counter, int64_t window_ns, RateSummary& summary) const {
+    summary.samples = 0;
+    summary.seconds = 0.0;
+    summary.min = 0.0;
+    summary.max = 0.0;
+    summary.avg = 0.0;
+    summary.last = 0.0;
+    if (count_ < 2) {
+        return false;
+    }
+
+    // Readings are in time order: binary search the oldest one in the window
+    size_t first = 0;
+    if (window_ns > 0) {
+        int64_t cutoff = timestamps_[slot(count_ - 1)] - window_ns;
+        size_t low = 0;
+        size_t high = count_ - 1;
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            if (timestamps_[slot(middle)] < cutoff) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        first = low;
+    }
+    if (count_ - first < 2) {
+        return false;
+    }
+
+    const std::vector<uint64_t>& values = counters_[counter];
+    size_t capacity = timestamps_.size();
+    size_t index = slot(first);
+    int64_t previous_time = timestamps_[index];
+    uint64_t previous_value = values[index];
+    int64_t first_time = previous_time;
+    uint64_t total = 0;
+    bool have_rate = false;
+
+    for (size_t i = first + 1; i < count_; i++) {
+        if (++index == capacity) {
+            index = 0;
+        }
+        int64_t time = timestamps_[index];
+        uint64_t value = values[index];
+        if (value >= previous_value && time > previous_time) {
+            uint64_t delta = value - previous_value;
+            double rate = delta * 1e9 / static_cast<double>(time - previous_time);
+            if (!have_rate || rate < summary.min) {
+                summary.min = rate;
+            }
+            if (!have_rate || rate > summary.max) {
+                summary.max = rate;
+            }
+            summary.last = rate;
+            total += delta;
+            have_rate = true;
+        }
+        previous_time = time;
+        previous_value = value;
+    }
+
+    summary.samples = count_ - first;
+    summary.seconds = (previous_time - first_time) / 1e9;
+    summary.avg = summary.seconds > 0.0 ? total / summary.seconds : 0.0;
+    return have_rate;
+}
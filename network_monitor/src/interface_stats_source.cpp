@@ -0,0 +1,145 @@
+#include "interface_stats_source.h"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+const size_t kNotFound = static_cast<size_t>(-1);
+
+bool nameEquals(const std::string& candidate, const char* name, size_t name_len) {
+    return candidate.size() == name_len && memcmp(candidate.data(), name, name_len) == 0;
+}
+
+} // namespace
+
+InterfaceStatsSource::InterfaceStatsSource()
+    : sample_seq_(0), committed_seq_(0), generation_(0), next_row_id_(0) {
+}
+
+InterfaceStatsSource::~InterfaceStatsSource() {
+}
+
+// Rows are only retired after a completed sample: if the previous one
+// failed partway, interfaces it had not reached yet are still unmarked.
+void InterfaceStatsSource::beginSample() {
+    if (committed_seq_ == sample_seq_) {
+        for (size_t i = 0; i < table_.size(); i++) {
+            if (row_ids_[i] != 0 && seen_[i] != sample_seq_) {
+                releaseRow(i);
+            }
+        }
+    }
+    sample_seq_++;
+}
+
+// FNV-1a of the name, reduced to the (power of two) hash size
+size_t InterfaceStatsSource::hashSlot(const char* name, size_t name_len) const {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < name_len; i++) {
+        hash = (hash ^ static_cast<unsigned char>(name[i])) * 16777619u;
+    }
+    return hash & (slots_.size() - 1);
+}
+
+size_t InterfaceStatsSource::lookup(const char* name, size_t name_len) const {
+    if (slots_.empty()) {
+        return kNotFound;
+    }
+    for (size_t slot = hashSlot(name, name_len); slots_[slot] != 0; slot = (slot + 1) & (slots_.size() - 1)) {
+        size_t index = slots_[slot] - 1;
+        if (nameEquals(table_[index].interface_name, name, name_len)) {
+            return index;
+        }
+    }
+    return kNotFound;
+}
+
+// Add a row to the hash, doubling it (and rehashing) above half full
+void InterfaceStatsSource::hashInsert(size_t index) {
+    if ((table_.size() - free_rows_.size()) * 2 > slots_.size()) {
+        slots_.assign(slots_.empty() ? 64 : slots_.size() * 2, 0);
+        for (size_t i = 0; i < table_.size(); i++) {
+            if (row_ids_[i] != 0 && i != index) {
+                hashInsert(i);
+            }
+        }
+    }
+    const std::string& name = table_[index].interface_name;
+    size_t slot = hashSlot(name.data(), name.size());
+    while (slots_[slot] != 0) {
+        slot = (slot + 1) & (slots_.size() - 1);
+    }
+    slots_[slot] = index + 1;
+}
+
+// Remove a row from the hash, shifting later entries of its probe run back
+void InterfaceStatsSource::hashErase(size_t index) {
+    size_t mask = slots_.size() - 1;
+    const std::string& name = table_[index].interface_name;
+    size_t slot = hashSlot(name.data(), name.size());
+    while (slots_[slot] != index + 1) {
+        slot = (slot + 1) & mask;
+    }
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; slots_[next] != 0; next = (next + 1) & mask) {
+        const std::string& moved = table_[slots_[next] - 1].interface_name;
+        size_t home = hashSlot(moved.data(), moved.size());
+        // Move the entry back unless its home lies cyclically in (hole, next]
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            slots_[hole] = slots_[next];
+            hole = next;
+        }
+    }
+    slots_[hole] = 0;
+}
+
+void InterfaceStatsSource::releaseRow(size_t index) {
+    hashErase(index);
+    row_ids_[index] = 0;
+    free_rows_.push_back(index);
+}
+
+// Locate an interface row in the table, adding it if it is new. Kernels list
+// interfaces in a stable order, so the row seen at this listing position in
+// earlier samples is tried first.
+size_t InterfaceStatsSource::findOrInsert(const char* name, size_t name_len, size_t hint) {
+    if (hint < position_rows_.size()) {
+        size_t index = position_rows_[hint];
+        if (index < table_.size() && row_ids_[index] != 0 &&
+            nameEquals(table_[index].interface_name, name, name_len)) {
+            return index;
+        }
+    } else {
+        position_rows_.resize(hint + 1, kNotFound);
+    }
+
+    size_t index = lookup(name, name_len);
+    if (index == kNotFound) {
+        // New interface: take a free row, keeping its name buffer
+        if (free_rows_.empty()) {
+            index = table_.size();
+            table_.push_back(InterfaceStats());
+            seen_.push_back(0);
+            row_ids_.push_back(0);
+        } else {
+            index = free_rows_.back();
+            free_rows_.pop_back();
+            std::string row_name;
+            row_name.swap(table_[index].interface_name);
+            table_[index] = InterfaceStats();
+            table_[index].interface_name.swap(row_name);
+        }
+        table_[index].interface_name.assign(name, name_len);
+        row_ids_[index] = ++next_row_id_;
+        hashInsert(index);
+        generation_++;
+    }
+    position_rows_[hint] = index;
+    return index;
+}
+
+// Look up the table index of an interface
+int InterfaceStatsSource::findIndex(const std::string& name) const {
+    size_t index = lookup(name.data(), name.size());
+    return index == kNotFound ? -1 : static_cast<int>(index);
+}
@@ -0,0 +1,68 @@
+#include "interval_timer.h"
+#include "shutdown.h"
+#include <iostream>
+#include <cstring>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+
+IntervalTimer::IntervalTimer()
+    : fd_(-1), missed_total_(0), ticks_(0) {
+}
+
+IntervalTimer::~IntervalTimer() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+// Arm a periodic timer whose deadlines are absolute monotonic times
+bool IntervalTimer::start(std::chrono::nanoseconds period) {
+    if (fd_ < 0) {
+        fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        if (fd_ < 0) {
+            std::cerr << "Error: Could not create timer: " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long period_ns = period.count();
+    long long first_ns = now.tv_nsec + period_ns;
+
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = period_ns / 1000000000LL;
+    spec.it_interval.tv_nsec = period_ns % 1000000000LL;
+    spec.it_value.tv_sec = now.tv_sec + first_ns / 1000000000LL;
+    spec.it_value.tv_nsec = first_ns % 1000000000LL;
+
+    if (timerfd_settime(fd_, TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+        std::cerr << "Error: Could not arm timer: " << strerror(errno) << std::endl;
+        return false;
+    }
+    missed_total_ = 0;
+    ticks_ = 0;
+    return true;
+}
+
+// Read the expiration count; more than one means deadlines were missed
+bool IntervalTimer::wait(uint64_t& missed) {
+    missed = 0;
+    while (!shutdownRequested()) {
+        uint64_t expirations = 0;
+        ssize_t n = read(fd_, &expirations, sizeof(expirations));
+        if (n == static_cast<ssize_t>(sizeof(expirations))) {
+            missed = expirations - 1;
+            missed_total_ += missed;
+            ticks_ += expirations;
+            return true;
+        }
+        if (n < 0 && errno != EINTR) {
+            std::cerr << "Error: Timer read failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,133 @@
+#include "job_scheduler.h"
+#include "shutdown.h"
+#include <algorithm>
+
+JobScheduler::JobScheduler(size_t workers)
+    : worker_count_(std::max<size_t>(workers, 1)), stopping_(false) {
+}
+
+JobScheduler::~JobScheduler() {
+    stop();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void JobScheduler::addPeriodic(const std::string& name, std::chrono::nanoseconds period, const Job& job) {
+    JobEntry entry = {name, job, Job(), std::chrono::duration_cast<Clock::duration>(period), 0, 0};
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(entry);
+    Pending pending = {Clock::now(), jobs_.size() - 1};
+    queue_.push_back(pending);
+    std::push_heap(queue_.begin(), queue_.end());
+}
+
+void JobScheduler::addTask(const std::string& name, const Job& task, const Job& on_stop) {
+    JobEntry entry = {name, task, on_stop, Clock::duration::zero(), 0, 0};
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(entry);
+    Pending pending = {Clock::now(), jobs_.size() - 1};
+    queue_.push_back(pending);
+    std::push_heap(queue_.begin(), queue_.end());
+}
+
+uint64_t JobScheduler::runs(size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_[index].runs;
+}
+
+uint64_t JobScheduler::skipped(size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_[index].skipped;
+}
+
+// Start the pool and wait for a shutdown request. Signal handlers cannot
+// touch the condition variable, so the flag is polled here.
+void JobScheduler::run() {
+    for (size_t i = 0; i < worker_count_; i++) {
+        workers_.push_back(std::thread(&JobScheduler::workerLoop, this));
+    }
+
+    while (sleepUnlessShutdown(std::chrono::milliseconds(100))) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            break;
+        }
+    }
+    stop();
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+// Wake every worker and tell the long-lived tasks to return
+void JobScheduler::stop() {
+    std::vector<Job> stop_hooks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+        for (const auto& entry : jobs_) {
+            if (entry.on_stop) {
+                stop_hooks.push_back(entry.on_stop);
+            }
+        }
+    }
+    wakeup_.notify_all();
+    for (const auto& hook : stop_hooks) {
+        hook();
+    }
+}
+
+// Take the earliest due job, run it without the lock, then queue its next
+// deadline (skipping any periods it overran)
+void JobScheduler::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (queue_.empty()) {
+            wakeup_.wait(lock);
+            continue;
+        }
+
+        Clock::time_point deadline = queue_.front().deadline;
+        if (Clock::now() < deadline) {
+            wakeup_.wait_until(lock, deadline);
+            continue;
+        }
+
+        std::pop_heap(queue_.begin(), queue_.end());
+        size_t index = queue_.back().job;
+        queue_.pop_back();
+        Job job = jobs_[index].job;
+        Clock::duration period = jobs_[index].period;
+
+        // Another worker may now own the next deadline
+        wakeup_.notify_one();
+        lock.unlock();
+        job();
+        lock.lock();
+
+        jobs_[index].runs++;
+        if (period == Clock::duration::zero() || stopping_) {
+            continue;
+        }
+
+        Clock::time_point next = deadline + period;
+        Clock::time_point now = Clock::now();
+        if (next <= now) {
+            uint64_t behind = static_cast<uint64_t>((now - deadline) / period);
+            jobs_[index].skipped += behind;
+            next = deadline + period * static_cast<Clock::rep>(behind + 1);
+        }
+        Pending pending = {next, index};
+        queue_.push_back(pending);
+        std::push_heap(queue_.begin(), queue_.end());
+        wakeup_.notify_one();
+    }
+}
@@ -1,8 +1,51 @@
 #include "network_monitor.h"
+#include "result_renderer.h"
+#include "counter_snapshot.h"
+#include "shutdown.h"
 #include <iostream>
 #include <string>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <iomanip>
+#include <sstream>
+#include <vector>
+
+// Split a comma separated option value into its non-empty parts
+static std::vector<std::string> splitList(const std::string& value) {
+    std::vector<std::string> parts;
+    std::istringstream iss(value);
+    std::string part;
+    while (std::getline(iss, part, ',')) {
+        if (!part.empty()) {
+            parts.push_back(part);
+        }
+    }
+    return parts;
+}
+
+// Parse a --from/--to time: seconds since the epoch, or "-<duration>"
+// relative to now. Returns nanoseconds since the epoch.
+static bool parseTimeArg(const std::string& value, int64_t& ns) {
+    if (!value.empty() && value[0] == '-') {
+        int64_t ago;
+        if (!parseDuration(value.substr(1), ago)) {
+            return false;
+        }
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        ns = now - ago;
+        return true;
+    }
+    
+    char* end = nullptr;
+    long long seconds = std::strtoll(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || seconds < 0) {
+        return false;
+    }
+    ns = static_cast<int64_t>(seconds) * 1000000000LL;
+    return true;
+}
 
 void printUsage(const char* program_name) {
     std::cout << "Network Performance Monitor - All Phases Complete" << std::endl;
@@ -12,25 +55,84 @@ void printUsage(const char* program_name) {
     std::cout << "Options:" << std::endl;
     std::cout << "  -l, --list              List available network interfaces" << std::endl;
     std::cout << "  -i, --interface <name>  Monitor specific interface (single reading)" << std::endl;
-    std::cout << "  -m, --monitor <name>    Continuously monitor interface" << std::endl;
-    std::cout << "  -t, --interval <sec>    Set monitoring interval (default: 1 second)" << std::endl;
+    std::cout << "  --state-file <path>     Counter snapshot for --interface, so a repeat run reports the" << std::endl;
+    std::cout << "                          rate since the previous one at once (default: $XDG_RUNTIME_DIR/" << std::endl;
+    std::cout << "                          netmonitor.state or /tmp/netmonitor-<uid>/state)" << std::endl;
+    std::cout << "  --no-state              Always sample --interface for 1 s, ignoring the snapshot" << std::endl;
+    std::cout << "  -m, --monitor <names>   Continuously monitor interfaces (list, glob or \"all\")" << std::endl;
+    std::cout << "  -t, --interval <time>   Set monitoring interval: seconds or e.g. 100ms, 0.5 (default: 1)" << std::endl;
+    std::cout << "  --adaptive <time>       Sample bursty interfaces as often as this and quiet ones at" << std::endl;
+    std::cout << "                          --interval (with --monitor or --daemon)" << std::endl;
+    std::cout << "  --sample-budget <n>     Interface samples per second across all interfaces for" << std::endl;
+    std::cout << "                          --adaptive (default: 100, 0 = unlimited)" << std::endl;
+    std::cout << "  --history <dur>         Counter history kept by --monitor/--daemon; windowed" << std::endl;
+    std::cout << "                          min/avg/max rates are printed on exit (default: 5m, 0 = off)" << std::endl;
+    std::cout << "  --anomaly <method>      Alert when rates, RTT or loss leave their baseline: ewma or" << std::endl;
+    std::cout << "                          holt-winters (with --monitor, --targets or --daemon)" << std::endl;
+    std::cout << "  --anomaly-threshold <z> Z-score that raises an alert (default: 4)" << std::endl;
+    std::cout << "  --season <dur>          Holt-Winters season length (default: 1d)" << std::endl;
+    std::cout << "  --backend <proc|netlink> Counter and connection source (default: proc)" << std::endl;
     std::cout << "  -p, --ping <host>       Measure latency to host (ICMP ping)" << std::endl;
-    std::cout << "  --timeout <ms>          Set timeout for ping in milliseconds (default: 1000)" << std::endl;
+    std::cout << "  --timeout <ms>          Set timeout for ping/probes in milliseconds (default: 1000)" << std::endl;
     std::cout << "  --packetloss <host>     Detect packet loss and jitter (default: 10 packets)" << std::endl;
     std::cout << "  --count <num>           Number of packets for packet loss test (default: 10)" << std::endl;
+    std::cout << "  --send-interval <ms>    Time between packet loss probes (default: 100)" << std::endl;
+    std::cout << "  --window <num>          Maximum probes in flight for packet loss test (default: 16)" << std::endl;
+    std::cout << "  --targets <file>        Continuously probe every host in a target list" << std::endl;
+    std::cout << "  --duration <sec>        Stop --targets, --top or --watch after this many seconds (default: run forever)" << std::endl;
     std::cout << "  -c, --connections       Display active network connections" << std::endl;
+    std::cout << "  --watch                 With --connections: report every TCP state and opened/closed" << std::endl;
+    std::cout << "                          sockets per second every --interval until Ctrl+C (or --duration)" << std::endl;
+    std::cout << "  --top <num>             With --connections: show the busiest TCP flows every" << std::endl;
+    std::cout << "                          --interval until Ctrl+C (or --duration)" << std::endl;
+    std::cout << "  --bench-connections [n] Measure connection table parsing on n synthetic" << std::endl;
+    std::cout << "                          sockets (default: 1000000)" << std::endl;
+    std::cout << "  --daemon                Run bandwidth (--monitor, default all), probes (--targets)" << std::endl;
+    std::cout << "                          and connection collectors together until Ctrl+C" << std::endl;
+    std::cout << "  --dashboard             Live top-like view of interfaces, probe targets (--targets)" << std::endl;
+    std::cout << "                          and connection states; runs the --daemon collectors and prints" << std::endl;
+    std::cout << "                          plain lines instead when stdout is not a terminal" << std::endl;
+    std::cout << "  --report-interval <time> Probe report interval in daemon mode (default: 10s, 1s for --dashboard)" << std::endl;
+    std::cout << "  --connections-interval <time> Connection stats interval in daemon mode (default: 10s, 1s for --dashboard, 0 = off)" << std::endl;
     std::cout << "  --log <filename>        Log data to CSV file (use with other commands)" << std::endl;
+    std::cout << "  --format <fmt>          Output of one-shot modes: console, csv or json (default: console)" << std::endl;
+    std::cout << "  --metrics-port <port>   Serve OpenMetrics on http://<address>:<port>/metrics" << std::endl;
+    std::cout << "                          (with --monitor, --targets or --daemon)" << std::endl;
+    std::cout << "  --metrics-address <ip>  Listen address for --metrics-port (default: 0.0.0.0)" << std::endl;
+    std::cout << "  --shm <name>            Publish latest rates and probe results to POSIX shared" << std::endl;
+    std::cout << "                          memory (e.g. /netmonitor; see include/shm_metrics.h)" << std::endl;
+    std::cout << "  --store <dir>           Append measurements to a binary time-series store" << std::endl;
+    std::cout << "  --export-csv <filename> Export rows from the --store directory as CSV" << std::endl;
+    std::cout << "  --kind <kind>           Series kind to export: bandwidth, latency, packetloss," << std::endl;
+    std::cout << "                          connections (default: bandwidth)" << std::endl;
+    std::cout << "  --series <names>        Interfaces or hosts to export (default: all)" << std::endl;
+    std::cout << "  --from <time>, --to <time>  Export range: epoch seconds or -<n>[s|m|h|d]" << std::endl;
+    std::cout << "  --resolution <dur>      Export from the 1m or 1h rollup tier (e.g. 5m; default: raw)" << std::endl;
+    std::cout << "  --retention <spec>      Per-tier retention for --store (default: raw=7d,1m=90d,1h=2y)" << std::endl;
+    std::cout << "  --check-store-codec     Round-trip synthetic rows through the --store encoding" << std::endl;
     std::cout << "  -h, --help              Show this help message" << std::endl;
     std::cout << std::endl;
     std::cout << "Examples:" << std::endl;
     std::cout << "  " << program_name << " --list" << std::endl;
     std::cout << "  " << program_name << " --interface eth0" << std::endl;
     std::cout << "  " << program_name << " --monitor wlan0 --interval 2" << std::endl;
+    std::cout << "  " << program_name << " --monitor eth0 --interval 10ms" << std::endl;
+    std::cout << "  " << program_name << " --monitor eth0,wlan0" << std::endl;
+    std::cout << "  " << program_name << " --monitor 'veth*'" << std::endl;
     std::cout << "  " << program_name << " --ping 8.8.8.8" << std::endl;
     std::cout << "  " << program_name << " --packetloss 8.8.8.8 --count 20" << std::endl;
+    std::cout << "  " << program_name << " --targets hosts.txt --interval 10" << std::endl;
     std::cout << "  " << program_name << " --connections" << std::endl;
+    std::cout << "  " << program_name << " --connections --top 10" << std::endl;
+    std::cout << "  " << program_name << " --connections --watch --interval 1" << std::endl;
+    std::cout << "  " << program_name << " --daemon --monitor eth0 --targets hosts.txt --store data" << std::endl;
+    std::cout << "  " << program_name << " --daemon --metrics-port 9105" << std::endl;
     std::cout << "  " << program_name << " --interface eth0 --log bandwidth.csv" << std::endl;
     std::cout << "  " << program_name << " --ping 8.8.8.8 --log latency.csv" << std::endl;
+    std::cout << "  " << program_name << " --packetloss 8.8.8.8 --format json" << std::endl;
+    std::cout << "  " << program_name << " --monitor all --store data" << std::endl;
+    std::cout << "  " << program_name << " --store data --export-csv week.csv --from -7d" << std::endl;
+    std::cout << "  " << program_name << " --store data --export-csv year.csv --from -1y --resolution 1h" << std::endl;
     std::cout << std::endl;
     std::cout << "Note: Bandwidth monitoring and connection stats do not require root privileges." << std::endl;
     std::cout << "      Latency and packet loss measurement require root privileges." << std::endl;
@@ -51,9 +153,43 @@ int main(int argc, char* argv[]) {
     std::string ping_host = "";
     std::string packetloss_host = "";
     std::string log_file = "";
-    int interval = 1;
+    int interval_ms = 1000;
     int timeout_ms = 1000;
     int packet_count = 10;
+    int send_interval_ms = 100;
+    bool send_interval_set = false;
+    std::string targets_file = "";
+    int duration = 0;
+    int probe_window = 16;
+    StatsBackend backend = StatsBackend::PROC_NET_DEV;
+    std::string store_dir = "";
+    std::string export_file = "";
+    SeriesKind export_kind = SeriesKind::BANDWIDTH;
+    std::vector<std::string> export_series;
+    int64_t export_from = INT64_MIN;
+    int64_t export_to = INT64_MAX;
+    int64_t export_resolution = 0;
+    bool daemon = false;
+    int metrics_port = -1;
+    std::string metrics_address = "0.0.0.0";
+    std::string shm_name = "";
+    int report_interval_ms = -1;            // -1 = mode default
+    int connections_interval_ms = -1;
+    bool dashboard = false;
+    int top_talkers = 0;
+    bool watch_connections = false;
+    std::string state_file = "";
+    bool use_state = true;
+    int history_seconds = 300;
+    int adaptive_ms = 0;
+    double sample_budget = 100.0;
+    bool anomaly = false;
+    AnomalyConfig anomaly_config;
+    int bench_sockets = 1000000;
+    OutputFormat format = OutputFormat::CONSOLE;
+    bool format_set = false;
+    int64_t retention[kRollupTiers];
+    RollupStore::defaultRetention(retention);
     
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
@@ -85,16 +221,52 @@ int main(int argc, char* argv[]) {
         }
         else if (arg == "-t" || arg == "--interval") {
             if (i + 1 < argc) {
-                interval = std::atoi(argv[++i]);
-                if (interval <= 0) {
-                    std::cerr << "Error: interval must be a positive integer" << std::endl;
+                int64_t interval_ns = 0;
+                if (!parseDuration(argv[++i], interval_ns) || interval_ns < 1000000LL) {
+                    std::cerr << "Error: interval must be at least 1 ms (e.g. 2, 0.5, 100ms)" << std::endl;
                     return 1;
                 }
+                interval_ms = static_cast<int>(interval_ns / 1000000LL);
             } else {
                 std::cerr << "Error: --interval requires a number" << std::endl;
                 return 1;
             }
         }
+        else if (arg == "--adaptive") {
+            int64_t adaptive_ns = 0;
+            if (i + 1 < argc && parseDuration(argv[++i], adaptive_ns) && adaptive_ns >= 1000000LL) {
+                adaptive_ms = static_cast<int>(adaptive_ns / 1000000LL);
+            } else {
+                std::cerr << "Error: --adaptive requires a minimum interval of at least 1 ms (e.g. 50ms)" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--sample-budget") {
+            char* end = nullptr;
+            if (i + 1 < argc) {
+                sample_budget = std::strtod(argv[++i], &end);
+            }
+            if (end == nullptr || *end != '\0' || !(sample_budget >= 0.0)) {
+                std::cerr << "Error: --sample-budget requires a number of samples per second" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--backend") {
+            if (i + 1 < argc) {
+                std::string name = argv[++i];
+                if (name == "proc") {
+                    backend = StatsBackend::PROC_NET_DEV;
+                } else if (name == "netlink") {
+                    backend = StatsBackend::NETLINK;
+                } else {
+                    std::cerr << "Error: backend must be 'proc' or 'netlink'" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: --backend requires a name" << std::endl;
+                return 1;
+            }
+        }
         else if (arg == "-p" || arg == "--ping") {
             if (i + 1 < argc) {
                 mode = "ping";
@@ -137,9 +309,140 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
         }
+        else if (arg == "--send-interval") {
+            if (i + 1 < argc) {
+                send_interval_ms = std::atoi(argv[++i]);
+                send_interval_set = true;
+                if (send_interval_ms <= 0) {
+                    std::cerr << "Error: send interval must be a positive integer" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: --send-interval requires a number" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--window") {
+            if (i + 1 < argc) {
+                probe_window = std::atoi(argv[++i]);
+                if (probe_window <= 0) {
+                    std::cerr << "Error: window must be a positive integer" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: --window requires a number" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--targets") {
+            if (i + 1 < argc) {
+                mode = "targets";
+                targets_file = argv[++i];
+            } else {
+                std::cerr << "Error: --targets requires a filename" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--duration") {
+            if (i + 1 < argc) {
+                duration = std::atoi(argv[++i]);
+                if (duration < 0) {
+                    std::cerr << "Error: duration must be a non-negative integer" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: --duration requires a number" << std::endl;
+                return 1;
+            }
+        }
         else if (arg == "-c" || arg == "--connections") {
             mode = "connections";
         }
+        else if (arg == "--bench-connections") {
+            mode = "bench-connections";
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                bench_sockets = std::atoi(argv[++i]);
+                if (bench_sockets <= 0) {
+                    std::cerr << "Error: --bench-connections needs a positive socket count" << std::endl;
+                    return 1;
+                }
+            }
+        }
+        else if (arg == "--check-store-codec") {
+            mode = "check-store-codec";
+        }
+        else if (arg == "--format") {
+            if (i + 1 < argc) {
+                if (!parseOutputFormat(argv[++i], format)) {
+                    std::cerr << "Error: format must be console, csv or json" << std::endl;
+                    return 1;
+                }
+                format_set = true;
+            } else {
+                std::cerr << "Error: --format requires console, csv or json" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--state-file") {
+            if (i + 1 < argc) {
+                state_file = argv[++i];
+            } else {
+                std::cerr << "Error: --state-file requires a path" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--history") {
+            int64_t history_ns = 0;
+            if (i + 1 < argc && parseDuration(argv[++i], history_ns) && history_ns >= 0) {
+                history_seconds = static_cast<int>(history_ns / 1000000000LL);
+            } else {
+                std::cerr << "Error: --history requires a duration such as 5m (0 = off)" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--anomaly") {
+            if (i + 1 < argc && parseAnomalyMethod(argv[++i], anomaly_config.method)) {
+                anomaly = true;
+            } else {
+                std::cerr << "Error: --anomaly requires ewma or holt-winters" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--anomaly-threshold") {
+            char* end = nullptr;
+            if (i + 1 < argc) {
+                anomaly_config.threshold = std::strtod(argv[++i], &end);
+            }
+            if (end == nullptr || *end != '\0' || !(anomaly_config.threshold > 0.0)) {
+                std::cerr << "Error: --anomaly-threshold requires a positive z-score" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--season") {
+            if (i + 1 >= argc || !parseDuration(argv[++i], anomaly_config.season_ns) ||
+                anomaly_config.season_ns < 60LL * 1000000000LL) {
+                std::cerr << "Error: --season requires a duration of at least 1m (e.g. 1d)" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--no-state") {
+            use_state = false;
+        }
+        else if (arg == "--watch") {
+            watch_connections = true;
+        }
+        else if (arg == "--top") {
+            if (i + 1 < argc) {
+                top_talkers = std::atoi(argv[++i]);
+                if (top_talkers <= 0) {
+                    std::cerr << "Error: --top must be a positive integer" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: --top requires a number of flows" << std::endl;
+                return 1;
+            }
+        }
         else if (arg == "--log") {
             if (i + 1 < argc) {
                 log_file = argv[++i];
@@ -148,6 +451,129 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
         }
+        else if (arg == "--store") {
+            if (i + 1 < argc) {
+                store_dir = argv[++i];
+            } else {
+                std::cerr << "Error: --store requires a directory" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--export-csv") {
+            if (i + 1 < argc) {
+                mode = "export";
+                export_file = argv[++i];
+            } else {
+                std::cerr << "Error: --export-csv requires a filename" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--kind") {
+            if (i + 1 < argc) {
+                if (!parseSeriesKind(argv[++i], export_kind)) {
+                    std::cerr << "Error: kind must be bandwidth, latency, packetloss or connections" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: --kind requires a name" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--series") {
+            if (i + 1 < argc) {
+                export_series = splitList(argv[++i]);
+            } else {
+                std::cerr << "Error: --series requires a name" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--from" || arg == "--to") {
+            if (i + 1 < argc) {
+                if (!parseTimeArg(argv[++i], arg == "--from" ? export_from : export_to)) {
+                    std::cerr << "Error: " << arg << " must be epoch seconds or -<n>[s|m|h|d]" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: " << arg << " requires a time" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--metrics-port") {
+            if (i + 1 < argc) {
+                metrics_port = std::atoi(argv[++i]);
+                if (metrics_port < 0 || metrics_port > 65535) {
+                    std::cerr << "Error: metrics port must be between 0 and 65535" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: --metrics-port requires a port number" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--metrics-address") {
+            if (i + 1 < argc) {
+                metrics_address = argv[++i];
+            } else {
+                std::cerr << "Error: --metrics-address requires an IPv4 address" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--shm") {
+            if (i + 1 < argc) {
+                shm_name = argv[++i];
+                if (shm_name.empty() || shm_name[0] != '/') {
+                    shm_name = "/" + shm_name;
+                }
+            } else {
+                std::cerr << "Error: --shm requires a segment name" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--daemon") {
+            daemon = true;
+        }
+        else if (arg == "--dashboard") {
+            daemon = true;
+            dashboard = true;
+        }
+        else if (arg == "--report-interval" || arg == "--connections-interval") {
+            if (i + 1 < argc) {
+                int64_t value_ns = 0;
+                bool allow_zero = arg == "--connections-interval";
+                if (!parseDuration(argv[++i], value_ns) || (value_ns < 1000000LL && !(allow_zero && value_ns == 0))) {
+                    std::cerr << "Error: " << arg << " must be a duration of at least 1 ms" << std::endl;
+                    return 1;
+                }
+                (arg == "--report-interval" ? report_interval_ms : connections_interval_ms) =
+                    static_cast<int>(value_ns / 1000000LL);
+            } else {
+                std::cerr << "Error: " << arg << " requires a duration" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--resolution") {
+            if (i + 1 < argc) {
+                std::string value = argv[++i];
+                if (value != "raw" && !parseDuration(value, export_resolution)) {
+                    std::cerr << "Error: resolution must be a duration such as 1m or 1h" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: --resolution requires a duration" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--retention") {
+            if (i + 1 < argc) {
+                if (!RollupStore::parseRetention(argv[++i], retention)) {
+                    std::cerr << "Error: retention must look like raw=7d,1m=90d,1h=2y" << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: --retention requires a value" << std::endl;
+                return 1;
+            }
+        }
         else {
             std::cerr << "Error: Unknown option: " << arg << std::endl;
             printUsage(argv[0]);
@@ -155,6 +581,108 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    // --daemon combines the collectors selected by the other mode options
+    if (daemon) {
+        mode = "daemon";
+    }
+    
+    if (backend != StatsBackend::PROC_NET_DEV) {
+        monitor.setStatsBackend(backend);
+        monitor.setConnectionBackend(ConnectionBackend::SOCK_DIAG);
+    }
+    
+    // Ctrl+C / SIGTERM stop continuous modes cleanly so CSV output is flushed
+    installShutdownHandlers();
+    
+    if (mode == "export") {
+        if (store_dir.empty()) {
+            std::cerr << "Error: --export-csv requires --store <dir>" << std::endl;
+            return 1;
+        }
+        return monitor.exportStoreToCSV(store_dir, export_file, export_kind, export_series,
+                                        export_from, export_to, export_resolution) ? 0 : 1;
+    }
+    
+    if (!store_dir.empty() && mode != "list" && !monitor.openStore(store_dir, retention)) {
+        return 1;
+    }
+    
+    if (metrics_port >= 0) {
+        if (mode != "continuous" && mode != "targets" && mode != "daemon") {
+            std::cerr << "Error: --metrics-port needs --monitor, --targets or --daemon" << std::endl;
+            return 1;
+        }
+        if (!monitor.startMetricsExporter(metrics_address, metrics_port)) {
+            return 1;
+        }
+    }
+    
+    if ((top_talkers > 0 || watch_connections) && mode != "connections") {
+        std::cerr << "Error: --top and --watch need --connections" << std::endl;
+        return 1;
+    }
+    if (top_talkers > 0 && watch_connections) {
+        std::cerr << "Error: use either --top or --watch" << std::endl;
+        return 1;
+    }
+    
+    if (!shm_name.empty()) {
+        if (mode != "continuous" && mode != "targets" && mode != "daemon") {
+            std::cerr << "Error: --shm needs --monitor, --targets or --daemon" << std::endl;
+            return 1;
+        }
+        if (!monitor.startShmPublisher(shm_name)) {
+            return 1;
+        }
+    }
+    
+    if (format_set && mode != "single" && mode != "ping" && mode != "packetloss" &&
+        !(mode == "connections" && top_talkers == 0 && !watch_connections)) {
+        std::cerr << "Error: --format needs --interface, --ping, --packetloss or --connections" << std::endl;
+        return 1;
+    }
+    
+    // One-shot modes measure once and hand the result to every renderer;
+    // progress lines go to stderr unless the output is for people
+    std::ostream& progress = format == OutputFormat::CONSOLE ? std::cout : std::cerr;
+    monitor.setProgressStream(progress);
+    MultiRenderer output;
+    output.add(createRenderer(format, monitor));
+    if (!log_file.empty()) {
+        output.add(new CsvRenderer(monitor, log_file));
+    }
+    if (!store_dir.empty()) {
+        output.add(new StoreRenderer(monitor));
+    }
+    
+    monitor.setHistoryWindow(history_seconds);
+    
+    if (adaptive_ms > 0) {
+        if (mode != "continuous" && mode != "daemon") {
+            std::cerr << "Error: --adaptive needs --monitor or --daemon" << std::endl;
+            return 1;
+        }
+        if (adaptive_ms >= interval_ms) {
+            std::cerr << "Error: --adaptive must be shorter than --interval" << std::endl;
+            return 1;
+        }
+        monitor.setAdaptiveSampling(adaptive_ms, sample_budget);
+    }
+    
+    if (anomaly) {
+        if (mode != "continuous" && mode != "targets" && mode != "daemon") {
+            std::cerr << "Error: --anomaly needs --monitor, --targets or --daemon" << std::endl;
+            return 1;
+        }
+        // Deviation floors keep idle links and steady RTTs from alerting on noise
+        AnomalyConfig bandwidth_config = anomaly_config;
+        bandwidth_config.min_deviation = 8000.0;    // 1 KB/s
+        AnomalyConfig probe_config = anomaly_config;
+        probe_config.min_deviation = 0.5;           // ms of RTT, percent of loss
+        probe_config.warmup = 10;
+        monitor.enableAnomalyDetection(bandwidth_config, probe_config, log_file);
+    }
+    
     // Execute based on mode
     if (mode == "list") {
         std::cout << "Available network interfaces:" << std::endl;
@@ -168,78 +696,99 @@ int main(int argc, char* argv[]) {
         }
     }
     else if (mode == "single") {
-        std::cout << "Measuring bandwidth for interface: " << interface << std::endl;
-        std::cout << "Please wait..." << std::endl << std::endl;
-        monitor.displayBandwidth(interface);
-        
-        // Log to CSV if requested
+        if (use_state) {
+            monitor.useCounterSnapshot(state_file.empty() ? defaultCounterSnapshotPath() : state_file);
+        }
+        progress << "Measuring bandwidth for interface: " << interface << std::endl;
+        progress << "Please wait..." << std::endl << std::endl;
+        BandwidthResult result = monitor.measureBandwidth(interface);
+        output.renderBandwidth(result);
+        if (!result.success) {
+            return 1;
+        }
         if (!log_file.empty()) {
-            double download_bps, upload_bps;
-            if (monitor.getBandwidth(interface, download_bps, upload_bps)) {
-                monitor.logBandwidthToCSV(log_file, interface, download_bps, upload_bps);
-                std::cout << "Data logged to: " << log_file << std::endl;
-            }
+            progress << "Data logged to: " << log_file << std::endl;
         }
     }
     else if (mode == "continuous") {
-        monitor.monitorBandwidthContinuous(interface, interval, log_file);
+        std::vector<std::string> selectors = splitList(interface);
+        if (selectors.empty()) {
+            std::cerr << "Error: --monitor requires an interface name" << std::endl;
+            return 1;
+        }
+        monitor.monitorBandwidthContinuous(selectors, interval_ms, log_file);
     }
     else if (mode == "ping") {
-        std::cout << "Pinging " << ping_host << "..." << std::endl;
+        progress << "Pinging " << ping_host << "..." << std::endl;
         LatencyResult result = monitor.measureLatency(ping_host, timeout_ms);
-        
-        if (result.success) {
-            std::cout << "Reply from " << result.host << ": time=" 
-                      << std::fixed << std::setprecision(2) << result.rtt_ms 
-                      << " ms" << std::endl;
-            
-            // Log to CSV if requested
-            if (!log_file.empty()) {
-                monitor.logLatencyToCSV(log_file, result);
-                std::cout << "Data logged to: " << log_file << std::endl;
-            }
-        } else {
-            std::cout << "Request timed out or failed." << std::endl;
-            // Log failed attempt if requested
-            if (!log_file.empty()) {
-                monitor.logLatencyToCSV(log_file, result);
-            }
+        output.renderLatency(result);
+        if (!result.success) {
             return 1;
         }
+        if (!log_file.empty()) {
+            progress << "Data logged to: " << log_file << std::endl;
+        }
     }
     else if (mode == "packetloss") {
-        PacketLossStats stats = monitor.detectPacketLoss(packetloss_host, packet_count);
-        
-        std::cout << std::endl << "Packet Loss Statistics:" << std::endl;
-        std::cout << "=========================" << std::endl;
-        std::cout << std::fixed << std::setprecision(2);
-        std::cout << "Packets sent:     " << stats.packets_sent << std::endl;
-        std::cout << "Packets received: " << stats.packets_received << std::endl;
-        std::cout << "Packet loss:      " << stats.loss_percentage << "%" << std::endl;
-        
-        if (stats.packets_received > 0) {
-            std::cout << "Min RTT:          " << stats.min_rtt << " ms" << std::endl;
-            std::cout << "Max RTT:          " << stats.max_rtt << " ms" << std::endl;
-            std::cout << "Avg RTT:          " << stats.avg_rtt << " ms" << std::endl;
-            std::cout << "Jitter:           " << stats.jitter << " ms" << std::endl;
-        }
-        
-        // Log to CSV if requested
+        PacketLossStats stats = monitor.detectPacketLoss(packetloss_host, packet_count, timeout_ms,
+                                                         send_interval_ms, probe_window);
+        output.renderPacketLoss(packetloss_host, stats);
         if (!log_file.empty()) {
-            monitor.logPacketLossToCSV(log_file, packetloss_host, stats);
-            std::cout << "Data logged to: " << log_file << std::endl;
+            progress << "Data logged to: " << log_file << std::endl;
+        }
+    }
+    else if (mode == "targets") {
+        // Per-target intervals come from the list; --send-interval sets the default
+        int default_interval_ms = send_interval_set ? send_interval_ms : 1000;
+        if (!monitor.monitorProbeTargets(targets_file, interval_ms, duration, timeout_ms,
+                                         default_interval_ms, log_file)) {
+            return 1;
+        }
+    }
+    else if (mode == "daemon") {
+        DaemonOptions options;
+        options.interfaces = splitList(interface.empty() ? "all" : interface);
+        options.bandwidth_interval_ms = interval_ms;
+        options.targets_file = targets_file;
+        // The dashboard refreshes every second, so its collectors default to that
+        int default_report_ms = dashboard ? 1000 : 10000;
+        options.probe_report_interval_ms = report_interval_ms >= 0 ? report_interval_ms : default_report_ms;
+        options.probe_timeout_ms = timeout_ms;
+        options.probe_default_interval_ms = send_interval_set ? send_interval_ms : 1000;
+        options.connections_interval_ms = connections_interval_ms >= 0 ? connections_interval_ms : default_report_ms;
+        options.log_file = log_file;
+        options.dashboard = dashboard;
+        if (!monitor.runDaemon(options)) {
+            return 1;
+        }
+    }
+    else if (mode == "check-store-codec") {
+        if (!TimeSeriesStore::checkCodec(std::cout)) {
+            return 1;
+        }
+    }
+    else if (mode == "bench-connections") {
+        monitor.benchmarkConnectionParsing(static_cast<size_t>(bench_sockets));
+    }
+    else if (mode == "connections" && watch_connections) {
+        if (!monitor.monitorConnectionsContinuous(interval_ms, duration, log_file)) {
+            return 1;
+        }
+    }
+    else if (mode == "connections" && top_talkers > 0) {
+        if (!monitor.monitorTopTalkers(static_cast<size_t>(top_talkers), interval_ms, duration)) {
+            return 1;
         }
     }
     else if (mode == "connections") {
-        monitor.displayActiveConnections();
-        
-        // Log to CSV if requested
+        ConnectionStats stats;
+        if (!monitor.getConnectionStats(stats)) {
+            std::cerr << "Error: Unable to read connection statistics" << std::endl;
+            return 1;
+        }
+        output.renderConnections(stats);
         if (!log_file.empty()) {
-            int tcp_total, tcp_established, udp_total;
-            if (monitor.getConnectionStats(tcp_total, tcp_established, udp_total)) {
-                monitor.logConnectionsToCSV(log_file, tcp_total, tcp_established, udp_total);
-                std::cout << "Data logged to: " << log_file << std::endl;
-            }
+            progress << "Data logged to: " << log_file << std::endl;
         }
     }
     else {
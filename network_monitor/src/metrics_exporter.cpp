@@ -0,0 +1,314 @@
+#include "metrics_exporter.h"
+#include <iostream>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace {
+
+// How often the serving thread checks for stop()
+const int kPollIntervalMs = 200;
+
+// Socket timeouts for one scrape
+const int kClientTimeoutMs = 2000;
+
+const char* kContentType = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+void appendf(std::string& out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+void appendf(std::string& out, const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length > 0) {
+        out.append(buffer, static_cast<size_t>(length) < sizeof(buffer) ? length : sizeof(buffer) - 1);
+    }
+}
+
+// Label value with backslash, quote and newline escaped
+void appendLabel(std::string& out, const std::string& value) {
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+}
+
+void appendFamily(std::string& out, const char* name, const char* type, const char* help) {
+    appendf(out, "# TYPE %s %s\n# HELP %s %s\n", name, type, name, help);
+}
+
+void setTimeouts(int fd) {
+    struct timeval timeout;
+    timeout.tv_sec = kClientTimeoutMs / 1000;
+    timeout.tv_usec = (kClientTimeoutMs % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+} // namespace
+
+int64_t metricsNowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+MetricsExporter::MetricsExporter()
+    : listen_fd_(-1), port_(0), stopping_(false) {
+}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+// Bind the listening socket and start serving
+bool MetricsExporter::start(const std::string& address, int port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+        std::cerr << "Error: Invalid metrics listen address: " << address << std::endl;
+        return false;
+    }
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        std::cerr << "Error: Could not create metrics socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(listen_fd_, 16) != 0) {
+        std::cerr << "Error: Could not listen on " << address << ":" << port
+                  << ": " << strerror(errno) << std::endl;
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+
+    socklen_t length = sizeof(addr);
+    getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), &length);
+    port_ = ntohs(addr.sin_port);
+
+    stopping_ = false;
+    thread_ = std::thread(&MetricsExporter::serveLoop, this);
+    return true;
+}
+
+void MetricsExporter::stop() {
+    stopping_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+    }
+}
+
+// Accept and answer scrapes one at a time until stop()
+void MetricsExporter::serveLoop() {
+    struct pollfd pfd;
+    pfd.fd = listen_fd_;
+    pfd.events = POLLIN;
+
+    while (!stopping_) {
+        int ready = poll(&pfd, 1, kPollIntervalMs);
+        if (ready <= 0) {
+            continue;
+        }
+        int client = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            continue;
+        }
+        setTimeouts(client);
+        handleClient(client);
+        close(client);
+    }
+}
+
+// Read the request line and answer GET /metrics; anything else is a 404
+void MetricsExporter::handleClient(int fd) {
+    char request[2048];
+    size_t length = 0;
+    while (length < sizeof(request) - 1) {
+        ssize_t n = recv(fd, request + length, sizeof(request) - 1 - length, 0);
+        if (n <= 0) {
+            break;
+        }
+        length += static_cast<size_t>(n);
+        request[length] = '\0';
+        if (strstr(request, "\r\n\r\n") != nullptr || strstr(request, "\n\n") != nullptr) {
+            break;
+        }
+    }
+    request[length] = '\0';
+
+    bool is_metrics = strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET /metrics?", 13) == 0;
+    response_.clear();
+    if (is_metrics) {
+        render(body_);
+        appendf(response_, "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                "Connection: close\r\n\r\n", kContentType, body_.size());
+        response_ += body_;
+    } else {
+        response_ = "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 10\r\n"
+                    "Connection: close\r\n\r\nnot found\n";
+    }
+
+    size_t sent = 0;
+    while (sent < response_.size()) {
+        ssize_t n = send(fd, response_.data() + sent, response_.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+// Render the latest published sections in OpenMetrics text format
+void MetricsExporter::render(std::string& out) {
+    out.clear();
+    const MetricsSection<std::vector<InterfaceMetric> >& interfaces = interfaces_.read();
+    const MetricsSection<std::vector<ProbeMetric> >& probes = probes_.read();
+    const MetricsSection<ConnectionMetric>& connections = connections_.read();
+
+    struct CounterFamily {
+        const char* name;
+        const char* help;
+        unsigned long long InterfaceMetric::*field;
+    };
+    const CounterFamily counters[] = {
+        {"netmonitor_interface_receive_bytes", "Bytes received.", &InterfaceMetric::bytes_received},
+        {"netmonitor_interface_transmit_bytes", "Bytes sent.", &InterfaceMetric::bytes_sent},
+        {"netmonitor_interface_receive_packets", "Packets received.", &InterfaceMetric::packets_received},
+        {"netmonitor_interface_transmit_packets", "Packets sent.", &InterfaceMetric::packets_sent},
+    };
+    if (!interfaces.data.empty()) {
+        for (const auto& family : counters) {
+            appendFamily(out, family.name, "counter", family.help);
+            for (const auto& metric : interfaces.data) {
+                appendf(out, "%s_total{interface=\"", family.name);
+                appendLabel(out, metric.name);
+                appendf(out, "\"} %llu\n", metric.*(family.field));
+            }
+        }
+        appendFamily(out, "netmonitor_interface_receive_bits_per_second", "gauge",
+                     "Download rate over the last sampling interval.");
+        for (const auto& metric : interfaces.data) {
+            out += "netmonitor_interface_receive_bits_per_second{interface=\"";
+            appendLabel(out, metric.name);
+            appendf(out, "\"} %.3f\n", metric.download_bps);
+        }
+        appendFamily(out, "netmonitor_interface_transmit_bits_per_second", "gauge",
+                     "Upload rate over the last sampling interval.");
+        for (const auto& metric : interfaces.data) {
+            out += "netmonitor_interface_transmit_bits_per_second{interface=\"";
+            appendLabel(out, metric.name);
+            appendf(out, "\"} %.3f\n", metric.upload_bps);
+        }
+    }
+
+    if (!probes.data.empty()) {
+        struct ProbeCounter {
+            const char* name;
+            const char* help;
+            unsigned long long ProbeMetric::*field;
+        };
+        const ProbeCounter probe_counters[] = {
+            {"netmonitor_probe_sent", "Probes answered or timed out.", &ProbeMetric::sent_total},
+            {"netmonitor_probe_received", "Probe replies received in time.", &ProbeMetric::received_total},
+            {"netmonitor_probe_lost", "Probes that timed out.", &ProbeMetric::lost_total},
+        };
+        for (const auto& family : probe_counters) {
+            appendFamily(out, family.name, "counter", family.help);
+            for (const auto& metric : probes.data) {
+                appendf(out, "%s_total{host=\"", family.name);
+                appendLabel(out, metric.host);
+                appendf(out, "\"} %llu\n", metric.*(family.field));
+            }
+        }
+
+        appendFamily(out, "netmonitor_probe_loss_ratio", "gauge", "Loss over the last report window.");
+        for (const auto& metric : probes.data) {
+            out += "netmonitor_probe_loss_ratio{host=\"";
+            appendLabel(out, metric.host);
+            appendf(out, "\"} %.6f\n", metric.loss_ratio);
+        }
+
+        struct RttStat {
+            const char* stat;
+            double ProbeMetric::*field;
+        };
+        const RttStat rtt_stats[] = {
+            {"min", &ProbeMetric::rtt_min_ms}, {"avg", &ProbeMetric::rtt_avg_ms},
+            {"max", &ProbeMetric::rtt_max_ms}, {"p50", &ProbeMetric::rtt_p50_ms},
+            {"p90", &ProbeMetric::rtt_p90_ms}, {"p99", &ProbeMetric::rtt_p99_ms},
+        };
+        appendFamily(out, "netmonitor_probe_rtt_seconds", "gauge", "Round-trip time over the last report window.");
+        for (const auto& metric : probes.data) {
+            if (!metric.has_rtt) {
+                continue;
+            }
+            for (const auto& rtt : rtt_stats) {
+                out += "netmonitor_probe_rtt_seconds{host=\"";
+                appendLabel(out, metric.host);
+                appendf(out, "\",stat=\"%s\"} %.9f\n", rtt.stat, metric.*(rtt.field) / 1000.0);
+            }
+        }
+        appendFamily(out, "netmonitor_probe_jitter_seconds", "gauge", "RTT standard deviation over the last report window.");
+        for (const auto& metric : probes.data) {
+            if (metric.has_rtt) {
+                out += "netmonitor_probe_jitter_seconds{host=\"";
+                appendLabel(out, metric.host);
+                appendf(out, "\"} %.9f\n", metric.jitter_ms / 1000.0);
+            }
+        }
+    }
+
+    if (connections.data.valid) {
+        appendFamily(out, "netmonitor_connections", "gauge", "Open sockets.");
+        appendf(out, "netmonitor_connections{protocol=\"tcp\",state=\"all\"} %d\n", connections.data.tcp_total);
+        appendf(out, "netmonitor_connections{protocol=\"tcp\",state=\"established\"} %d\n",
+                connections.data.tcp_established);
+        appendf(out, "netmonitor_connections{protocol=\"udp\",state=\"all\"} %d\n", connections.data.udp_total);
+    }
+
+    appendFamily(out, "netmonitor_collector_last_update_timestamp_seconds", "gauge",
+                 "When each collector last published.");
+    const struct {
+        const char* name;
+        int64_t updated_ms;
+    } updates[] = {
+        {"bandwidth", interfaces.updated_ms},
+        {"probes", probes.updated_ms},
+        {"connections", connections.updated_ms},
+    };
+    for (const auto& update : updates) {
+        if (update.updated_ms > 0) {
+            appendf(out, "netmonitor_collector_last_update_timestamp_seconds{collector=\"%s\"} %.3f\n",
+                    update.name, update.updated_ms / 1000.0);
+        }
+    }
+    out += "# EOF\n";
+}
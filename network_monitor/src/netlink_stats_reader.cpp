@@ -0,0 +1,188 @@
+#include "netlink_stats_reader.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace {
+
+// Receive buffer size; large enough for a full dump message from the kernel
+const size_t kInitialBufferSize = 64 * 1024;
+
+// Prefix of rtnl_link_stats64 that is read below (through tx_compressed,
+// present since the attribute was introduced)
+const size_t kStatsBytesRead = offsetof(struct rtnl_link_stats64, tx_compressed) + sizeof(__u64);
+
+} // namespace
+
+NetlinkStatsReader::NetlinkStatsReader()
+    : sock_(-1), seq_(0), buffer_(kInitialBufferSize) {
+}
+
+NetlinkStatsReader::~NetlinkStatsReader() {
+    if (sock_ >= 0) {
+        close(sock_);
+    }
+}
+
+// Open the rtnetlink socket on first use
+bool NetlinkStatsReader::openSocket() {
+    if (sock_ >= 0) {
+        return true;
+    }
+
+    sock_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (sock_ < 0) {
+        return false;
+    }
+
+    struct sockaddr_nl local;
+    memset(&local, 0, sizeof(local));
+    local.nl_family = AF_NETLINK;
+    if (bind(sock_, (struct sockaddr*)&local, sizeof(local)) < 0) {
+        close(sock_);
+        sock_ = -1;
+        return false;
+    }
+    return true;
+}
+
+// Ask the kernel for a dump of every link
+bool NetlinkStatsReader::sendDumpRequest() {
+    struct {
+        struct nlmsghdr header;
+        struct ifinfomsg info;
+    } request;
+
+    memset(&request, 0, sizeof(request));
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+    request.header.nlmsg_type = RTM_GETLINK;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = ++seq_;
+    request.info.ifi_family = AF_UNSPEC;
+
+    struct sockaddr_nl kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+
+    ssize_t sent = sendto(sock_, &request, request.header.nlmsg_len, 0,
+                          (struct sockaddr*)&kernel, sizeof(kernel));
+    return sent == static_cast<ssize_t>(request.header.nlmsg_len);
+}
+
+// Take a snapshot of every link's 64-bit counters
+bool NetlinkStatsReader::sample() {
+    if (!openSocket() || !sendDumpRequest()) {
+        return false;
+    }
+
+    auto current_time = std::chrono::steady_clock::now();
+    beginSample();
+
+    size_t position = 0;
+    while (true) {
+        struct iovec iov;
+        iov.iov_base = buffer_.data();
+        iov.iov_len = buffer_.size();
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        ssize_t received = recvmsg(sock_, &msg, 0);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        // A truncated datagram cannot be recovered; grow for the next sample
+        if (msg.msg_flags & MSG_TRUNC) {
+            buffer_.resize(buffer_.size() * 2);
+            close(sock_);
+            sock_ = -1;
+            return false;
+        }
+
+        int remaining = static_cast<int>(received);
+        for (struct nlmsghdr* header = (struct nlmsghdr*)buffer_.data();
+             NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining)) {
+            if (header->nlmsg_seq != seq_) {
+                continue;
+            }
+            if (header->nlmsg_type == NLMSG_DONE) {
+                // Only a complete dump may retire links that were not listed
+                commitSample();
+                return true;
+            }
+            if (header->nlmsg_type == NLMSG_ERROR) {
+                return false;
+            }
+            if (header->nlmsg_type != RTM_NEWLINK) {
+                continue;
+            }
+
+            struct ifinfomsg* info = (struct ifinfomsg*)NLMSG_DATA(header);
+            int attr_len = static_cast<int>(IFLA_PAYLOAD(header));
+            const char* name = nullptr;
+            size_t name_len = 0;
+            const struct rtattr* stats_attr = nullptr;
+
+            for (struct rtattr* attr = IFLA_RTA(info); RTA_OK(attr, attr_len);
+                 attr = RTA_NEXT(attr, attr_len)) {
+                if (attr->rta_type == IFLA_IFNAME) {
+                    name = (const char*)RTA_DATA(attr);
+                    name_len = strnlen(name, RTA_PAYLOAD(attr));
+                } else if (attr->rta_type == IFLA_STATS64) {
+                    stats_attr = attr;
+                }
+            }
+
+            if (name == nullptr || name_len == 0 || stats_attr == nullptr ||
+                RTA_PAYLOAD(stats_attr) < kStatsBytesRead) {
+                continue;
+            }
+
+            // Attribute payloads are only 4-byte aligned, copy before reading.
+            // The struct grows across kernel versions (older kernels send a
+            // shorter one), so copy what was sent and leave the rest zero.
+            struct rtnl_link_stats64 link_stats;
+            memset(&link_stats, 0, sizeof(link_stats));
+            memcpy(&link_stats, RTA_DATA(stats_attr),
+                   std::min<size_t>(RTA_PAYLOAD(stats_attr), sizeof(link_stats)));
+
+            size_t index = findOrInsert(name, name_len, position);
+            InterfaceStats& stat = row(index);
+            stat.bytes_received = link_stats.rx_bytes;
+            stat.packets_received = link_stats.rx_packets;
+            stat.bytes_sent = link_stats.tx_bytes;
+            stat.packets_sent = link_stats.tx_packets;
+            
+            // Folded into the /proc/net/dev columns the way the kernel prints them
+            stat.receive_errors = link_stats.rx_errors;
+            stat.receive_dropped = link_stats.rx_dropped + link_stats.rx_missed_errors;
+            stat.receive_fifo_errors = link_stats.rx_fifo_errors;
+            stat.receive_frame_errors = link_stats.rx_length_errors + link_stats.rx_over_errors +
+                                        link_stats.rx_crc_errors + link_stats.rx_frame_errors;
+            stat.receive_compressed = link_stats.rx_compressed;
+            stat.receive_multicast = link_stats.multicast;
+            stat.transmit_errors = link_stats.tx_errors;
+            stat.transmit_dropped = link_stats.tx_dropped;
+            stat.transmit_fifo_errors = link_stats.tx_fifo_errors;
+            stat.transmit_collisions = link_stats.collisions;
+            stat.transmit_carrier_errors = link_stats.tx_carrier_errors + link_stats.tx_aborted_errors +
+                                           link_stats.tx_window_errors + link_stats.tx_heartbeat_errors;
+            stat.transmit_compressed = link_stats.tx_compressed;
+            stat.timestamp = current_time;
+            markPresent(index);
+            position++;
+        }
+    }
+}
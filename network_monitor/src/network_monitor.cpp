@@ -1,4 +1,25 @@
 #include "network_monitor.h"
+#include "proc_net_dev_reader.h"
+#include "netlink_stats_reader.h"
+#include "sock_diag.h"
+#include "icmp_socket.h"
+#include "icmp_prober.h"
+#include "probe_scheduler.h"
+#include "probe_session.h"
+#include "resolver_cache.h"
+#include "csv_logger.h"
+#include "rollup_store.h"
+#include "shutdown.h"
+#include "interval_timer.h"
+#include "job_scheduler.h"
+#include "metrics_exporter.h"
+#include "shm_publisher.h"
+#include "flow_tracker.h"
+#include "proc_net_parser.h"
+#include "result_renderer.h"
+#include "socket_churn.h"
+#include "counter_snapshot.h"
+#include "terminal_screen.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -11,54 +32,115 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <netinet/tcp.h>
+#include <linux/inet_diag.h>
 #include <unistd.h>
 #include <errno.h>
 #include <sys/time.h>
 #include <algorithm>
 #include <cmath>
 #include <ctime>
+#include <fnmatch.h>
 #include <sstream>
 
-NetworkMonitor::NetworkMonitor() {
+// Current local time in ctime() format without the newline. Formatted once
+// per second per thread; ticks within the same second reuse the text.
+static const std::string& currentTimeString() {
+    thread_local time_t cached_second = -1;
+    thread_local std::string cached_text;
+    time_t now = std::time(nullptr);
+    if (now != cached_second) {
+        struct tm local;
+        localtime_r(&now, &local);
+        char text[32];
+        size_t length = strftime(text, sizeof(text), "%a %b %e %H:%M:%S %Y", &local);
+        cached_text.assign(text, length);
+        cached_second = now;
+    }
+    return cached_text;
+}
+
+// Write one tick's output to stdout with a single write()
+static void writeOutput(const std::string& text) {
+    std::cout.flush();      // Keep earlier std::cout lines in order
+    size_t written = 0;
+    while (written < text.size()) {
+        ssize_t n = write(STDOUT_FILENO, text.data() + written, text.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        written += static_cast<size_t>(n);
+    }
+}
+
+// CSV writers a thread has already looked up, so logging a row does not take
+// csv_mutex_. Closing writers bumps the generation, which empties the caches.
+struct CachedCsvLogger {
+    const NetworkMonitor* owner;
+    unsigned long long generation;
+    std::string filename;
+    CsvLogger* logger;
+};
+static std::atomic<unsigned long long> csv_logger_generation(0);
+static thread_local std::vector<CachedCsvLogger> cached_csv_loggers;
+
+NetworkMonitor::NetworkMonitor()
+    : history_seconds_(300),
+      adaptive_min_interval_ms_(0),
+      sample_budget_(0.0),
+      stats_source_(new ProcNetDevReader()),
+      connection_backend_(ConnectionBackend::PROC_NET),
+      proc_net_parser_(new ProcNetTableParser()),
+      churn_(new SocketChurnTracker()),
+      resolver_(new ResolverCache()),
+      progress_(&std::cout) {
     detectInterfaces();
 }
 
 NetworkMonitor::~NetworkMonitor() {
-    // Cleanup if needed
+    if (exporter_) {
+        exporter_->stop();
+    }
+    // Flush queued CSV rows before the files are closed
+    csv_logger_generation.fetch_add(1, std::memory_order_acq_rel);
+    csv_loggers_.clear();
+}
+
+// Select the collector used for interface counters
+bool NetworkMonitor::setStatsBackend(StatsBackend backend) {
+    if (backend == StatsBackend::NETLINK) {
+        stats_source_.reset(new NetlinkStatsReader());
+    } else {
+        stats_source_.reset(new ProcNetDevReader());
+    }
+    return detectInterfaces();
 }
 
 // Detect available network interfaces
 bool NetworkMonitor::detectInterfaces() {
     available_interfaces_.clear();
     
-    std::ifstream proc_file("/proc/net/dev");
-    if (!proc_file.is_open()) {
-        std::cerr << "Error: Unable to open /proc/net/dev" << std::endl;
+    if (!sampleInterfaces()) {
+        std::cerr << "Error: Unable to read interface statistics ("
+                  << stats_source_->name() << ")" << std::endl;
         return false;
     }
     
-    std::string line;
-    // Skip first two header lines
-    std::getline(proc_file, line);
-    std::getline(proc_file, line);
-    
-    while (std::getline(proc_file, line)) {
-        std::istringstream iss(line);
-        std::string interface;
-        iss >> interface;
-        
-        // Remove the colon from interface name
-        if (!interface.empty() && interface.back() == ':') {
-            interface.pop_back();
+    for (size_t i = 0; i < stats_source_->size(); i++) {
+        if (!stats_source_->present(i)) {
+            continue;
         }
         
         // Skip loopback interface
+        const std::string& interface = stats_source_->at(i).interface_name;
         if (interface != "lo") {
             available_interfaces_.push_back(interface);
         }
     }
     
-    proc_file.close();
     return !available_interfaces_.empty();
 }
 
@@ -67,73 +149,30 @@ std::vector<std::string> NetworkMonitor::getAvailableInterfaces() const {
     return available_interfaces_;
 }
 
-// Parse /proc/net/dev and read all interface statistics
-bool NetworkMonitor::parseProcNetDev(std::map<std::string, InterfaceStats>& stats) {
-    std::ifstream proc_file("/proc/net/dev");
-    if (!proc_file.is_open()) {
-        return false;
-    }
-    
-    std::string line;
-    // Skip first two header lines
-    std::getline(proc_file, line);
-    std::getline(proc_file, line);
-    
-    auto current_time = std::chrono::steady_clock::now();
-    
-    while (std::getline(proc_file, line)) {
-        std::istringstream iss(line);
-        InterfaceStats stat;
-        
-        iss >> stat.interface_name;
-        
-        // Remove colon from interface name
-        if (!stat.interface_name.empty() && stat.interface_name.back() == ':') {
-            stat.interface_name.pop_back();
-        }
-        
-        // Read statistics
-        // Format: bytes packets errs drop fifo frame compressed multicast
-        iss >> stat.bytes_received >> stat.packets_received;
-        
-        // Skip errs, drop, fifo, frame, compressed, multicast for RX
-        unsigned long long temp;
-        for (int i = 0; i < 6; i++) {
-            iss >> temp;
-        }
-        
-        // Read TX stats
-        iss >> stat.bytes_sent >> stat.packets_sent;
-        
-        stat.timestamp = current_time;
-        stats[stat.interface_name] = stat;
-    }
-    
-    proc_file.close();
-    return true;
+// Refresh the interface snapshot held by the active backend
+bool NetworkMonitor::sampleInterfaces() {
+    return stats_source_->sample();
 }
 
 // Read statistics for a specific interface
 bool NetworkMonitor::readInterfaceStats(const std::string& interface, InterfaceStats& stats) {
-    std::map<std::string, InterfaceStats> all_stats;
-    if (!parseProcNetDev(all_stats)) {
+    if (!sampleInterfaces()) {
         return false;
     }
     
-    auto it = all_stats.find(interface);
-    if (it == all_stats.end()) {
+    int index = stats_source_->findIndex(interface);
+    if (index < 0 || !stats_source_->present(index)) {
         return false;
     }
     
-    stats = it->second;
+    stats = stats_source_->at(index);
     return true;
 }
 
 // Calculate time difference in seconds
 double NetworkMonitor::calculateTimeDiff(const std::chrono::steady_clock::time_point& start,
                                         const std::chrono::steady_clock::time_point& end) {
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    return duration.count() / 1000.0;
+    return std::chrono::duration<double>(end - start).count();
 }
 
 // Calculate bandwidth based on two consecutive measurements
@@ -157,316 +196,576 @@ void NetworkMonitor::calculateBandwidth(const InterfaceStats& prev, const Interf
     upload_bps = (bytes_sent_diff * 8.0) / time_diff;
 }
 
-// Display bandwidth for a specific interface (single measurement)
-void NetworkMonitor::displayBandwidth(const std::string& interface) {
-    InterfaceStats stats1, stats2;
+// Snapshots this young give noisy rates; older ones average over too long
+static const double kMinSnapshotAgeSeconds = 0.1;
+static const double kMaxSnapshotAgeSeconds = 3600.0;
+
+// Take one bandwidth measurement, from the counter snapshot if possible
+BandwidthResult NetworkMonitor::measureBandwidth(const std::string& interface, int sample_ms) {
+    BandwidthResult result;
+    result.interface = interface;
+    result.success = false;
+    result.download_bps = 0.0;
+    result.upload_bps = 0.0;
+    result.interval_seconds = 0.0;
+    result.from_snapshot = false;
     
-    // First reading
-    if (!readInterfaceStats(interface, stats1)) {
-        std::cerr << "Error reading interface: " << interface << std::endl;
-        return;
+    InterfaceStats first;
+    if (!readInterfaceStats(interface, first)) {
+        return result;
     }
     
-    // Wait 1 second
-    std::this_thread::sleep_for(std::chrono::seconds(1));
-    
-    // Second reading
-    if (!readInterfaceStats(interface, stats2)) {
-        std::cerr << "Error reading interface: " << interface << std::endl;
-        return;
+    // Counters of the previous run are usable if they are neither too fresh
+    // nor too old and have not gone backwards
+    InterfaceStats previous;
+    std::map<std::string, InterfaceStats>::const_iterator last = last_stats_.find(interface);
+    if (!snapshot_path_.empty() && last != last_stats_.end()) {
+        double age = calculateTimeDiff(last->second.timestamp, first.timestamp);
+        result.from_snapshot = age >= kMinSnapshotAgeSeconds && age <= kMaxSnapshotAgeSeconds &&
+                               first.bytes_received >= last->second.bytes_received &&
+                               first.bytes_sent >= last->second.bytes_sent;
     }
     
-    // Calculate bandwidth
-    double download_bps, upload_bps;
-    calculateBandwidth(stats1, stats2, download_bps, upload_bps);
-    
-    // Display results
-    std::cout << "Interface: " << interface << std::endl;
-    std::cout << std::fixed << std::setprecision(2);
-    
-    // Convert to appropriate units (Kbps, Mbps)
-    if (download_bps > 1000000) {
-        std::cout << "  Download: " << (download_bps / 1000000.0) << " Mbps" << std::endl;
-    } else if (download_bps > 1000) {
-        std::cout << "  Download: " << (download_bps / 1000.0) << " Kbps" << std::endl;
+    if (result.from_snapshot) {
+        previous = last->second;
+        result.current = first;
     } else {
-        std::cout << "  Download: " << download_bps << " bps" << std::endl;
+        previous = first;
+        std::this_thread::sleep_for(std::chrono::milliseconds(sample_ms));
+        if (!readInterfaceStats(interface, result.current)) {
+            return result;
+        }
     }
     
-    if (upload_bps > 1000000) {
-        std::cout << "  Upload:   " << (upload_bps / 1000000.0) << " Mbps" << std::endl;
-    } else if (upload_bps > 1000) {
-        std::cout << "  Upload:   " << (upload_bps / 1000.0) << " Kbps" << std::endl;
-    } else {
-        std::cout << "  Upload:   " << upload_bps << " bps" << std::endl;
+    calculateBandwidth(previous, result.current, result.download_bps, result.upload_bps);
+    result.interval_seconds = calculateTimeDiff(previous.timestamp, result.current.timestamp);
+    result.success = true;
+    
+    if (!snapshot_path_.empty()) {
+        last_stats_[interface] = result.current;
+        if (!saveCounterSnapshot(snapshot_path_, last_stats_)) {
+            std::cerr << "Warning: Could not write counter snapshot " << snapshot_path_ << std::endl;
+        }
     }
+    return result;
 }
 
-// Get bandwidth values for a specific interface (helper for logging)
+// Load the previous run's counters and save new ones after each measurement
+void NetworkMonitor::useCounterSnapshot(const std::string& path) {
+    snapshot_path_ = path;
+    loadCounterSnapshot(path, last_stats_);
+}
+
+// Display bandwidth for a specific interface (single measurement)
+void NetworkMonitor::displayBandwidth(const std::string& interface) {
+    ConsoleRenderer(std::cout).renderBandwidth(measureBandwidth(interface));
+}
+
+// Get bandwidth values for a specific interface
 bool NetworkMonitor::getBandwidth(const std::string& interface, double& download_bps, double& upload_bps) {
-    InterfaceStats stats1, stats2;
-    
-    // First reading
-    if (!readInterfaceStats(interface, stats1)) {
-        return false;
+    BandwidthResult result = measureBandwidth(interface);
+    download_bps = result.download_bps;
+    upload_bps = result.upload_bps;
+    return result.success;
+}
+
+// Append a bandwidth value with a human readable unit
+static void appendRate(std::ostream& out, double bps) {
+    if (bps > 1000000) {
+        out << (bps / 1000000.0) << " Mbps";
+    } else if (bps > 1000) {
+        out << (bps / 1000.0) << " Kbps";
+    } else {
+        out << bps << " bps";
     }
-    
-    // Wait 1 second
-    std::this_thread::sleep_for(std::chrono::seconds(1));
-    
-    // Second reading
-    if (!readInterfaceStats(interface, stats2)) {
-        return false;
+}
+
+// Per-second increase of a counter (0 if it went backwards)
+static double counterRate(unsigned long long before, unsigned long long after, double seconds) {
+    return after >= before && seconds > 0.0 ? (after - before) / seconds : 0.0;
+}
+
+// Append drop and error rates when there are any
+static void appendErrorRates(std::ostream& out, double drops_per_second, double errors_per_second) {
+    if (drops_per_second > 0.0) {
+        out << " | drops " << drops_per_second << "/s";
+    }
+    if (errors_per_second > 0.0) {
+        out << " | errors " << errors_per_second << "/s";
     }
-    
-    // Calculate bandwidth
-    calculateBandwidth(stats1, stats2, download_bps, upload_bps);
-    return true;
 }
 
-// Monitor bandwidth continuously
-void NetworkMonitor::monitorBandwidthContinuous(const std::string& interface, int interval_seconds,
-                                                const std::string& log_file) {
-    InterfaceStats prev_stats, current_stats;
-    bool log_enabled = !log_file.empty();
-    bool log_notice_shown = false;
-    
-    std::cout << "Starting continuous bandwidth monitoring for interface: " << interface << std::endl;
-    std::cout << "Press Ctrl+C to stop..." << std::endl << std::endl;
+// Alert line for the console, plus a CSV row when logging
+void NetworkMonitor::reportAnomaly(const std::string& time_str, const std::string& series, int metric,
+                                   const AnomalyEvent& event, std::ostream& output) {
+    output << "[" << time_str << "] " << (event.active ? "ALERT " : "CLEARED ")
+           << series << " " << anomalyMetricName(metric) << " ";
+    if (metric == ANOMALY_DOWNLOAD || metric == ANOMALY_UPLOAD) {
+        appendRate(output, event.value);
+        output << " (expected ";
+        appendRate(output, event.expected);
+    } else {
+        const char* unit = metric == ANOMALY_RTT ? " ms" : "%";
+        output << event.value << unit << " (expected " << event.expected << unit;
+    }
+    output << ", z=" << event.score << ")\n";
     
-    // Get initial reading
-    if (!readInterfaceStats(interface, prev_stats)) {
-        std::cerr << "Error: Unable to read interface " << interface << std::endl;
+    if (!alert_log_.empty()) {
+        logAlertToCSV(alert_log_, series, metric, event);
+    }
+}
+
+// Switch the bandwidth collector to per-interface intervals. Returns the
+// period to wake up at (the minimum interval, or interval_ms when off).
+int NetworkMonitor::startAdaptiveSampling(BandwidthState& state, int interval_ms) {
+    if (adaptive_min_interval_ms_ <= 0 || adaptive_min_interval_ms_ >= interval_ms) {
+        return interval_ms;
+    }
+    state.adaptive.reset(new AdaptiveSampler(adaptive_min_interval_ms_ * 1000000LL,
+                                             interval_ms * 1000000LL, sample_budget_));
+    std::cout << "Adaptive sampling every " << adaptive_min_interval_ms_ << "-" << interval_ms << " ms";
+    if (sample_budget_ > 0.0) {
+        std::cout << " within " << sample_budget_ << " samples/s";
+    }
+    std::cout << std::endl;
+    return adaptive_min_interval_ms_;
+}
+
+// Size the per-interface history for the configured window
+void NetworkMonitor::startBandwidthHistory(BandwidthState& state, int interval_ms) {
+    if (history_seconds_ <= 0) {
+        state.history_capacity = 0;
         return;
     }
-    
-    while (true) {
-        // Wait for specified interval
-        std::this_thread::sleep_for(std::chrono::seconds(interval_seconds));
-        
-        // Read current stats
-        if (!readInterfaceStats(interface, current_stats)) {
-            std::cerr << "Error reading interface stats" << std::endl;
-            break;
+    // Capped at about a million readings (~130 MB across all counters)
+    const size_t kMaxHistoryReadings = 1 << 20;
+    size_t readings = static_cast<size_t>(history_seconds_) * 1000 / static_cast<size_t>(interval_ms) + 1;
+    state.history_capacity = std::min(readings, kMaxHistoryReadings);
+}
+
+// Windowed rates from the history of every selected interface
+void NetworkMonitor::reportBandwidthHistory(const BandwidthState& state, std::ostream& output) {
+    struct Line {
+        const char* label;
+        HistoryCounter rx;
+        HistoryCounter tx;
+        double scale;       // 8 for bytes to bits
+    };
+    static const Line kLines[] = {
+        { "Bandwidth", HISTORY_RX_BYTES, HISTORY_TX_BYTES, 8.0 },
+        { "Packets/s", HISTORY_RX_PACKETS, HISTORY_TX_PACKETS, 1.0 },
+        { "Drops/s", HISTORY_RX_DROPPED, HISTORY_TX_DROPPED, 1.0 },
+        { "Errors/s", HISTORY_RX_ERRORS, HISTORY_TX_ERRORS, 1.0 }
+    };
+    
+    bool header_shown = false;
+    for (size_t i = 0; i < state.history.size(); i++) {
+        const InterfaceHistory* history = state.history[i].get();
+        RateSummary summary;
+        if (history == nullptr || !history->rates(HISTORY_RX_BYTES, 0, summary)) {
+            continue;
         }
-        
-        // Calculate bandwidth
-        double download_bps, upload_bps;
-        calculateBandwidth(prev_stats, current_stats, download_bps, upload_bps);
-        
-        // Get current time for display
-        auto now = std::chrono::system_clock::now();
-        auto time_t_now = std::chrono::system_clock::to_time_t(now);
-        std::string time_str = std::ctime(&time_t_now);
-        time_str.pop_back(); // Remove newline
-        
-        // Display results
-        std::cout << "[" << time_str << "] " << interface << " - ";
-        std::cout << std::fixed << std::setprecision(2);
-        
-        // Download
-        if (download_bps > 1000000) {
-            std::cout << "↓ " << (download_bps / 1000000.0) << " Mbps";
-        } else if (download_bps > 1000) {
-            std::cout << "↓ " << (download_bps / 1000.0) << " Kbps";
-        } else {
-            std::cout << "↓ " << download_bps << " bps";
+        if (!header_shown) {
+            output << "\nWindowed rates (min / avg / max):\n";
+            header_shown = true;
         }
+        output << stats_source_->at(i).interface_name << " - last " << summary.seconds << " s, "
+               << summary.samples << " readings\n";
         
-        std::cout << " | ";
-        
-        // Upload
-        if (upload_bps > 1000000) {
-            std::cout << "↑ " << (upload_bps / 1000000.0) << " Mbps";
-        } else if (upload_bps > 1000) {
-            std::cout << "↑ " << (upload_bps / 1000.0) << " Kbps";
-        } else {
-            std::cout << "↑ " << upload_bps << " bps";
+        for (size_t line = 0; line < sizeof(kLines) / sizeof(kLines[0]); line++) {
+            RateSummary rx, tx;
+            history->rates(kLines[line].rx, 0, rx);
+            history->rates(kLines[line].tx, 0, tx);
+            if (line >= 2 && rx.max == 0.0 && tx.max == 0.0) {
+                continue;       // No drops or errors
+            }
+            output << "  " << std::left << std::setw(10) << kLines[line].label << std::right;
+            const RateSummary* sides[2] = { &rx, &tx };
+            for (int side = 0; side < 2; side++) {
+                const RateSummary& rates = *sides[side];
+                double scale = kLines[line].scale;
+                output << (side == 0 ? " ↓ " : " | ↑ ");
+                if (scale > 1.0) {
+                    appendRate(output, rates.min * scale);
+                    output << " / ";
+                    appendRate(output, rates.avg * scale);
+                    output << " / ";
+                    appendRate(output, rates.max * scale);
+                } else {
+                    output << rates.min << " / " << rates.avg << " / " << rates.max;
+                }
+            }
+            output << "\n";
         }
-        
-        std::cout << std::endl;
-        
-        // Log results to CSV if enabled
-        if (log_enabled) {
-            if (logBandwidthToCSV(log_file, interface, download_bps, upload_bps) && !log_notice_shown) {
-                std::cout << "Logging continuous measurements to: " << log_file << std::endl;
-                log_notice_shown = true;
+    }
+}
+
+// Check whether an interface is matched by any selector
+bool NetworkMonitor::matchesInterfaceSelector(const std::string& interface,
+                                              const std::vector<std::string>& selectors) {
+    for (const auto& selector : selectors) {
+        if (selector == "all") {
+            if (interface != "lo") {
+                return true;
             }
+        } else if (fnmatch(selector.c_str(), interface.c_str(), 0) == 0) {
+            return true;
         }
-        
-        // Update previous stats
-        prev_stats = current_stats;
     }
+    return false;
 }
 
-// ICMP Helper Functions for Phase 2
+// Monitor bandwidth continuously for a single interface
+void NetworkMonitor::monitorBandwidthContinuous(const std::string& interface, int interval_ms,
+                                                const std::string& log_file) {
+    monitorBandwidthContinuous(std::vector<std::string>(1, interface), interval_ms, log_file);
+}
 
-// Calculate ICMP checksum
-unsigned short NetworkMonitor::calculateChecksum(unsigned short* buffer, int length) {
-    unsigned long sum = 0;
-    unsigned short* ptr = buffer;
-    
-    // Sum all 16-bit words
-    while (length > 1) {
-        sum += *ptr++;
-        length -= 2;
+// Resolve the selectors against any interfaces that appeared since the last
+// call. A stats row reused by a new interface starts over with no previous
+// sample, history or baseline. Returns false if nothing matches on the first
+// resolution.
+bool NetworkMonitor::resolveBandwidthSelection(BandwidthState& state) {
+    if (state.resolved_generation == stats_source_->generation()) {
+        return true;
     }
     
-    // Add any remaining byte
-    if (length > 0) {
-        sum += *(unsigned char*)ptr;
+    size_t rows = stats_source_->size();
+    state.selected.resize(rows, 0);
+    state.row_ids.resize(rows, 0);
+    state.has_prev.resize(rows, 0);
+    state.prev_stats.resize(rows);
+    state.history.resize(rows);
+    state.rates.resize(rows);
+    if (state.anomalies) {
+        state.anomalies->resize(rows * 2);
     }
-    
-    // Fold 32-bit sum to 16 bits
-    while (sum >> 16) {
-        sum = (sum & 0xFFFF) + (sum >> 16);
+    for (size_t i = 0; i < rows; i++) {
+        unsigned long long row_id = stats_source_->rowId(i);
+        if (row_id == state.row_ids[i]) {
+            continue;
+        }
+        state.row_ids[i] = row_id;
+        state.selected[i] = row_id != 0 &&
+                            matchesInterfaceSelector(stats_source_->at(i).interface_name, state.selectors);
+        state.has_prev[i] = 0;
+        state.history[i].reset();
+        state.rates[i] = InterfaceRates();
+        if (state.anomalies) {
+            state.anomalies->reset(2 * i);
+            state.anomalies->reset(2 * i + 1);
+        }
+        if (state.adaptive) {
+            state.adaptive->untrack(i);
+        }
     }
     
-    return (unsigned short)(~sum);
+    bool first = state.resolved_generation == ~0ULL;
+    state.resolved_generation = stats_source_->generation();
+    return !first || std::find(state.selected.begin(), state.selected.end(), 1) != state.selected.end();
 }
 
-// Resolve hostname to IP address
-bool NetworkMonitor::resolveHostname(const std::string& hostname, struct sockaddr_in* addr) {
-    struct hostent* host_entry;
-    
-    // Try to convert as IP address first
-    if (inet_addr(hostname.c_str()) != INADDR_NONE) {
-        addr->sin_addr.s_addr = inet_addr(hostname.c_str());
-        addr->sin_family = AF_INET;
-        return true;
-    }
-    
-    // Try DNS resolution
-    host_entry = gethostbyname(hostname.c_str());
-    if (host_entry == nullptr) {
-        return false;
-    }
-    
-    addr->sin_family = AF_INET;
-    addr->sin_addr = *(struct in_addr*)host_entry->h_addr_list[0];
-    return true;
+// CLOCK_MONOTONIC now, comparable with InterfaceStats::timestamp
+static int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-// Create raw socket for ICMP
-int NetworkMonitor::createRawSocket() {
-    int sock = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
-    if (sock < 0) {
-        return -1;
+// Fill the next exporter entry, reusing the vector's strings
+static void addInterfaceMetric(std::vector<InterfaceMetric>& metrics, size_t& count,
+                               const InterfaceStats& stats, double download_bps, double upload_bps) {
+    if (count == metrics.size()) {
+        metrics.push_back(InterfaceMetric());
     }
-    
-    // Set socket timeout
-    struct timeval tv;
-    tv.tv_sec = 1;
-    tv.tv_usec = 0;
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-    
-    return sock;
+    InterfaceMetric& metric = metrics[count++];
+    metric.name = stats.interface_name;
+    metric.bytes_received = stats.bytes_received;
+    metric.bytes_sent = stats.bytes_sent;
+    metric.packets_received = stats.packets_received;
+    metric.packets_sent = stats.packets_sent;
+    metric.download_bps = download_bps;
+    metric.upload_bps = upload_bps;
 }
 
-// Phase 2: ICMP-based latency measurement
-LatencyResult NetworkMonitor::measureLatency(const std::string& host, int timeout_ms) {
-    LatencyResult result;
-    result.host = host;
-    result.success = false;
-    result.rtt_ms = 0.0;
-    
-    // Resolve hostname to IP address
-    struct sockaddr_in dest_addr;
-    memset(&dest_addr, 0, sizeof(dest_addr));
-    
-    if (!resolveHostname(host, &dest_addr)) {
-        std::cerr << "Error: Could not resolve hostname: " << host << std::endl;
-        return result;
+// One bandwidth tick: compute every selected interface's rates from the
+// latest snapshot, print them to output and send them to the sinks
+void NetworkMonitor::collectBandwidth(BandwidthState& state, const std::string& time_str,
+                                      std::ostream& output, const std::string& log_file) {
+    resolveBandwidthSelection(state);
+    
+    // Latest per-interface values for the exporter and shared memory
+    std::vector<InterfaceMetric>* metrics = (exporter_ || shm_) ? &state.metrics : nullptr;
+    size_t metric_count = 0;
+    
+    AnomalyDetector* anomalies = nullptr;
+    int64_t now_ns = 0;
+    if (bandwidth_anomaly_config_) {
+        if (!state.anomalies) {
+            state.anomalies.reset(new AnomalyDetector(*bandwidth_anomaly_config_));
+        }
+        anomalies = state.anomalies.get();
+        anomalies->resize(state.selected.size() * 2);
+        now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
     }
     
-    // Create raw socket
-    int sock = createRawSocket();
-    if (sock < 0) {
-        std::cerr << "Error: Could not create raw socket. Root privileges required." << std::endl;
-        return result;
+    for (size_t i = 0; i < state.selected.size(); i++) {
+        if (!state.selected[i]) {
+            continue;
+        }
+        if (!stats_source_->present(i)) {
+            if (state.has_prev[i] && anomalies != nullptr) {
+                anomalies->reset(2 * i);
+                anomalies->reset(2 * i + 1);
+            }
+            if (state.has_prev[i] && state.adaptive) {
+                state.adaptive->untrack(i);
+            }
+            state.has_prev[i] = 0;
+            continue;
+        }
+        
+        const InterfaceStats& current_stats = stats_source_->at(i);
+        int64_t reading_ns = 0;
+        double total_bps = 0.0;
+        if (state.adaptive) {
+            // Interfaces (re)appear at the base interval; others wait until due
+            reading_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                current_stats.timestamp.time_since_epoch()).count();
+            if (!state.has_prev[i]) {
+                state.adaptive->track(i);
+            } else if (!state.adaptive->due(i, reading_ns)) {
+                // Not due: the exporter keeps this interface's last reading
+                if (metrics != nullptr) {
+                    addInterfaceMetric(*metrics, metric_count, state.prev_stats[i],
+                                       state.rates[i].download_bps, state.rates[i].upload_bps);
+                }
+                continue;
+            }
+        }
+        if (state.has_prev[i]) {
+            // Calculate bandwidth
+            const InterfaceStats& prev = state.prev_stats[i];
+            InterfaceRates& rates = state.rates[i];
+            calculateBandwidth(prev, current_stats, rates.download_bps, rates.upload_bps);
+            double interval_seconds = calculateTimeDiff(prev.timestamp, current_stats.timestamp);
+            rates.interval_seconds = interval_seconds;
+            rates.rx_packets_per_second = counterRate(prev.packets_received, current_stats.packets_received,
+                                                      interval_seconds);
+            rates.tx_packets_per_second = counterRate(prev.packets_sent, current_stats.packets_sent,
+                                                      interval_seconds);
+            rates.drops_per_second =
+                counterRate(prev.receive_dropped, current_stats.receive_dropped, interval_seconds) +
+                counterRate(prev.transmit_dropped, current_stats.transmit_dropped, interval_seconds);
+            rates.errors_per_second =
+                counterRate(prev.receive_errors, current_stats.receive_errors, interval_seconds) +
+                counterRate(prev.transmit_errors, current_stats.transmit_errors, interval_seconds);
+            double download_bps = rates.download_bps;
+            double upload_bps = rates.upload_bps;
+            
+            // Display results
+            output << "[" << time_str << "] " << current_stats.interface_name << " - ";
+            output << "↓ ";
+            appendRate(output, download_bps);
+            output << " | ";
+            output << "↑ ";
+            appendRate(output, upload_bps);
+            appendErrorRates(output, rates.drops_per_second, rates.errors_per_second);
+            if (state.adaptive) {
+                output << " [" << static_cast<int>(interval_seconds * 1000.0 + 0.5) << " ms]";
+            }
+            output << "\n";
+            total_bps = download_bps + upload_bps;
+            
+            if (anomalies != nullptr) {
+                AnomalyEvent event;
+                if (anomalies->observe(2 * i, now_ns, download_bps, event)) {
+                    reportAnomaly(time_str, current_stats.interface_name, ANOMALY_DOWNLOAD, event, output);
+                }
+                if (anomalies->observe(2 * i + 1, now_ns, upload_bps, event)) {
+                    reportAnomaly(time_str, current_stats.interface_name, ANOMALY_UPLOAD, event, output);
+                }
+            }
+            
+            // Log results to CSV if enabled
+            if (!log_file.empty()) {
+                if (logBandwidthToCSV(log_file, current_stats.interface_name, download_bps, upload_bps,
+                                      interval_seconds) && !state.log_notice_shown) {
+                    output << "Logging continuous measurements to: " << log_file << "\n";
+                    state.log_notice_shown = true;
+                }
+            }
+            if (store_) {
+                storeBandwidth(current_stats, download_bps, upload_bps);
+            }
+            if (metrics != nullptr) {
+                addInterfaceMetric(*metrics, metric_count, current_stats, download_bps, upload_bps);
+            }
+        }
+        
+        // Update previous stats
+        state.prev_stats[i] = current_stats;
+        state.has_prev[i] = 1;
+        if (state.adaptive) {
+            state.adaptive->sampled(i, reading_ns, total_bps);
+        }
+        
+        if (state.history_capacity > 0) {
+            if (!state.history[i]) {
+                state.history[i].reset(new InterfaceHistory(state.history_capacity));
+            }
+            state.history[i]->append(current_stats);
+        }
     }
     
-    // Build ICMP packet
-    struct icmphdr icmp_hdr;
-    memset(&icmp_hdr, 0, sizeof(icmp_hdr));
-    icmp_hdr.type = ICMP_ECHO;
-    icmp_hdr.code = 0;
-    icmp_hdr.un.echo.id = getpid() & 0xFFFF;  // Use process ID as identifier
-    icmp_hdr.un.echo.sequence = 1;
-    icmp_hdr.checksum = 0;
-    
-    // Calculate checksum
-    icmp_hdr.checksum = calculateChecksum((unsigned short*)&icmp_hdr, sizeof(icmp_hdr));
-    
-    // Record send time
-    auto send_time = std::chrono::steady_clock::now();
-    
-    // Send ICMP echo request
-    ssize_t sent = sendto(sock, &icmp_hdr, sizeof(icmp_hdr), 0,
-                          (struct sockaddr*)&dest_addr, sizeof(dest_addr));
-    
-    if (sent < 0) {
-        std::cerr << "Error: Failed to send ICMP packet: " << strerror(errno) << std::endl;
-        close(sock);
-        return result;
+    if (state.adaptive) {
+        state.adaptive->rebalance();
     }
     
-    // Set receive timeout
-    struct timeval tv;
-    tv.tv_sec = timeout_ms / 1000;
-    tv.tv_usec = (timeout_ms % 1000) * 1000;
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (metrics != nullptr && metric_count > 0) {
+        metrics->resize(metric_count);
+        if (exporter_) {
+            MetricsSection<std::vector<InterfaceMetric> >& section = exporter_->interfaces().writeBuffer();
+            section.data = *metrics;
+            section.updated_ms = metricsNowMs();
+            exporter_->interfaces().publish();
+        }
+        if (shm_) {
+            shm_->publishInterfaces(*metrics);
+        }
+    }
+}
+
+// Monitor bandwidth continuously for every interface matched by the selectors.
+// Each tick takes one interface snapshot and computes all rates from it.
+// Samples are taken on absolute deadlines so the period does not drift with
+// the time spent printing and logging.
+void NetworkMonitor::monitorBandwidthContinuous(const std::vector<std::string>& selectors,
+                                                int interval_ms, const std::string& log_file) {
+    std::string selector_list;
+    for (size_t i = 0; i < selectors.size(); i++) {
+        selector_list += (i == 0 ? "" : ",") + selectors[i];
+    }
     
-    // Receive ICMP echo reply
-    char recv_buffer[1024];
-    struct sockaddr_in recv_addr;
-    socklen_t addr_len = sizeof(recv_addr);
+    BandwidthState state;
+    state.selectors = selectors;
+    int period_ms = startAdaptiveSampling(state, interval_ms);
     
-    ssize_t received = recvfrom(sock, recv_buffer, sizeof(recv_buffer), 0,
-                                (struct sockaddr*)&recv_addr, &addr_len);
+    IntervalTimer timer;
+    if (!timer.start(std::chrono::milliseconds(period_ms))) {
+        return;
+    }
     
-    // Record receive time
-    auto recv_time = std::chrono::steady_clock::now();
+    // Get initial reading
+    if (!sampleInterfaces()) {
+        std::cerr << "Error: Unable to read interface statistics" << std::endl;
+        return;
+    }
     
-    close(sock);
+    if (!resolveBandwidthSelection(state)) {
+        std::cerr << "Error: Unable to read interface " << selector_list << std::endl;
+        return;
+    }
+    startBandwidthHistory(state, period_ms);
+    std::cout << "Starting continuous bandwidth monitoring for interface: "
+              << selector_list << std::endl;
+    std::cout << "Press Ctrl+C to stop..." << std::endl << std::endl;
     
-    if (received < 0) {
-        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-            std::cerr << "Error: Timeout waiting for ICMP reply from " << host << std::endl;
-        } else {
-            std::cerr << "Error: Failed to receive ICMP reply: " << strerror(errno) << std::endl;
+    bool sampled = true;
+    while (true) {
+        if (sampled) {
+            std::ostringstream output;
+            output << std::fixed << std::setprecision(2);
+            collectBandwidth(state, currentTimeString(), output, log_file);
+            writeOutput(output.str());
+        }
+        
+        // Wait for the next deadline (Ctrl+C ends the loop so logs get flushed)
+        uint64_t missed = 0;
+        if (!timer.wait(missed)) {
+            break;
+        }
+        if (missed > 0) {
+            std::cerr << "Warning: Missed " << missed << " sampling deadline(s) at "
+                      << period_ms << " ms interval" << std::endl;
+        }
+        
+        // In adaptive mode, counters are only read when an interface is due
+        sampled = !state.adaptive || state.adaptive->anyDue(steadyNowNs());
+        if (!sampled) {
+            continue;
+        }
+        
+        // Read current stats for every interface at once
+        if (!sampleInterfaces()) {
+            std::cerr << "Error reading interface stats" << std::endl;
+            break;
         }
-        return result;
     }
     
-    // Parse IP header to get to ICMP header
-    struct iphdr* ip_hdr = (struct iphdr*)recv_buffer;
-    int ip_header_len = ip_hdr->ihl * 4;
-    
-    if (received < static_cast<ssize_t>(ip_header_len + sizeof(struct icmphdr))) {
-        std::cerr << "Error: Received packet too short" << std::endl;
-        return result;
+    if (timer.missedTotal() > 0) {
+        std::cerr << "Missed " << timer.missedTotal() << " of " << timer.ticks()
+                  << " sampling deadlines" << std::endl;
+    }
+    if (state.adaptive) {
+        std::cout << "Adaptive schedule at exit: " << state.adaptive->demand() << " samples/s" << std::endl;
     }
     
-    struct icmphdr* recv_icmp = (struct icmphdr*)(recv_buffer + ip_header_len);
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(2);
+    reportBandwidthHistory(state, summary);
+    std::cout << summary.str() << std::flush;
+}
+
+// ICMP Helper Functions for Phase 2
+
+// Resolve hostname to IP address (cached, see ResolverCache)
+bool NetworkMonitor::resolveHostname(const std::string& hostname, struct sockaddr_in* addr) {
+    return resolver_->resolve(hostname, addr);
+}
+
+// Phase 2: ICMP-based latency measurement
+LatencyResult NetworkMonitor::measureLatency(const std::string& host, int timeout_ms) {
+    LatencyResult result;
+    result.host = host;
+    result.success = false;
+    result.rtt_ms = 0.0;
+    result.clock_source = TimestampSource::USERSPACE;
     
-    // Verify it's an echo reply and matches our request
-    if (recv_icmp->type == ICMP_ECHOREPLY && 
-        recv_icmp->un.echo.id == (getpid() & 0xFFFF)) {
-        // Calculate RTT
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(recv_time - send_time);
-        result.rtt_ms = duration.count() / 1000.0;
-        result.success = true;
-    } else {
-        std::cerr << "Error: Received unexpected ICMP packet type: " << (int)recv_icmp->type << std::endl;
+    // Reuse the host's session (socket + resolved address) across calls
+    std::unique_ptr<ProbeSession>& session = probe_sessions_[host];
+    if (!session) {
+        session.reset(new ProbeSession(host, *resolver_));
+    }
+    if (!session->isOpen() && !session->open()) {
+        return result;
     }
     
+    ProbeSample sample = session->measure(timeout_ms);
+    result.success = sample.success;
+    result.rtt_ms = sample.rtt_ms;
+    result.clock_source = sample.clock_source;
     return result;
 }
 
+// Fill the RTT summary fields of PacketLossStats from its histogram
+static void summarizeRtt(PacketLossStats& stats) {
+    const RttHistogram& histogram = stats.rtt_histogram;
+    stats.min_rtt = histogram.min();
+    stats.max_rtt = histogram.max();
+    stats.avg_rtt = histogram.mean();
+    stats.jitter = histogram.stddev();
+    stats.p50_rtt = histogram.percentile(50.0);
+    stats.p90_rtt = histogram.percentile(90.0);
+    stats.p99_rtt = histogram.percentile(99.0);
+    stats.p999_rtt = histogram.percentile(99.9);
+}
+
 // Phase 3: Packet loss detection with jitter calculation
-PacketLossStats NetworkMonitor::detectPacketLoss(const std::string& host, int count) {
-    PacketLossStats stats = {0, 0, 0.0, 0.0, 0.0, 0.0, 0.0};
+PacketLossStats NetworkMonitor::detectPacketLoss(const std::string& host, int count, int timeout_ms,
+                                                 int interval_ms, int window) {
+    PacketLossStats stats = {0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0, 0,
+                             TimestampSource::USERSPACE, RttHistogram()};
     
     // Resolve hostname to IP address
     struct sockaddr_in dest_addr;
@@ -477,119 +776,50 @@ PacketLossStats NetworkMonitor::detectPacketLoss(const std::string& host, int co
         return stats;
     }
     
-    // Create raw socket
-    int sock = createRawSocket();
-    if (sock < 0) {
+    // Create non-blocking raw socket for the probe loop
+    IcmpSocket socket;
+    if (!socket.open(true)) {
         std::cerr << "Error: Could not create raw socket. Root privileges required." << std::endl;
         return stats;
     }
-    
-    // Set receive timeout (1 second per packet)
-    struct timeval tv;
-    tv.tv_sec = 1;
-    tv.tv_usec = 0;
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-    
-    std::vector<double> rtt_values;
-    int pid = getpid() & 0xFFFF;
-    stats.packets_sent = count;
-    
-    std::cout << "Pinging " << host << " with " << count << " packets..." << std::endl;
-    
-    // Send multiple ICMP packets and collect RTT values
-    for (int seq = 1; seq <= count; seq++) {
-        // Build ICMP packet
-        struct icmphdr icmp_hdr;
-        memset(&icmp_hdr, 0, sizeof(icmp_hdr));
-        icmp_hdr.type = ICMP_ECHO;
-        icmp_hdr.code = 0;
-        icmp_hdr.un.echo.id = pid;
-        icmp_hdr.un.echo.sequence = seq;
-        icmp_hdr.checksum = 0;
-        
-        // Calculate checksum
-        icmp_hdr.checksum = calculateChecksum((unsigned short*)&icmp_hdr, sizeof(icmp_hdr));
-        
-        // Record send time
-        auto send_time = std::chrono::steady_clock::now();
-        
-        // Send ICMP echo request
-        ssize_t sent = sendto(sock, &icmp_hdr, sizeof(icmp_hdr), 0,
-                              (struct sockaddr*)&dest_addr, sizeof(dest_addr));
-        
-        if (sent < 0) {
-            std::cerr << "Warning: Failed to send packet " << seq << std::endl;
-            continue;
-        }
-        
-        // Try to receive reply
-        char recv_buffer[1024];
-        struct sockaddr_in recv_addr;
-        socklen_t addr_len = sizeof(recv_addr);
-        
-        ssize_t received = recvfrom(sock, recv_buffer, sizeof(recv_buffer), 0,
-                                    (struct sockaddr*)&recv_addr, &addr_len);
-        
-        // Record receive time
-        auto recv_time = std::chrono::steady_clock::now();
-        
-        if (received > 0) {
-            // Parse IP header
-            struct iphdr* ip_hdr = (struct iphdr*)recv_buffer;
-            int ip_header_len = ip_hdr->ihl * 4;
-            
-            if (received >= static_cast<ssize_t>(ip_header_len + sizeof(struct icmphdr))) {
-                struct icmphdr* recv_icmp = (struct icmphdr*)(recv_buffer + ip_header_len);
-                
-                // Verify it's an echo reply and matches our request
-                if (recv_icmp->type == ICMP_ECHOREPLY && 
-                    recv_icmp->un.echo.id == pid &&
-                    recv_icmp->un.echo.sequence == seq) {
-                    // Calculate RTT
-                    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(recv_time - send_time);
-                    double rtt_ms = duration.count() / 1000.0;
-                    rtt_values.push_back(rtt_ms);
-                    stats.packets_received++;
-                    
-                    std::cout << "  Packet " << seq << ": " << std::fixed << std::setprecision(2) 
-                              << rtt_ms << " ms" << std::endl;
-                }
-            }
-        }
-        
-        // Small delay between packets
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    socket.enableTimestamps();
+    
+    *progress_ << "Pinging " << host << " with " << count << " packets..." << std::endl;
+    
+    // Keep several probes in flight and collect RTT values as replies arrive
+    ProbeWindowOptions options;
+    options.count = count;
+    options.interval_ms = interval_ms;
+    options.window = window;
+    options.timeout_ms = timeout_ms;
+    
+    ProbeWindowResult result;
+    WindowedProber prober;
+    bool ok = prober.run(socket, dest_addr, getpid() & 0xFFFF, options,
+                         [this, &stats](int seq, double rtt_ms) {
+                             stats.rtt_histogram.record(rtt_ms);
+                             *progress_ << "  Packet " << seq << ": " << std::fixed << std::setprecision(2)
+                                       << rtt_ms << " ms" << std::endl;
+                         },
+                         result);
+    if (!ok) {
+        std::cerr << "Error: Probe loop failed: " << strerror(errno) << std::endl;
     }
     
-    close(sock);
+    // Fewer than count probes go out if the run was interrupted
+    stats.packets_sent = result.sent;
+    stats.packets_received = result.received;
+    stats.late_replies = result.late;
+    stats.duplicate_replies = result.duplicates;
+    stats.clock_source = result.clock_source;
     
     // Calculate statistics
     if (stats.packets_received > 0) {
         // Calculate packet loss percentage
-        stats.loss_percentage = ((count - stats.packets_received) * 100.0) / count;
+        stats.loss_percentage = ((stats.packets_sent - stats.packets_received) * 100.0) / stats.packets_sent;
         
-        // Calculate min, max, and average RTT
-        stats.min_rtt = *std::min_element(rtt_values.begin(), rtt_values.end());
-        stats.max_rtt = *std::max_element(rtt_values.begin(), rtt_values.end());
-        
-        double sum = 0.0;
-        for (double rtt : rtt_values) {
-            sum += rtt;
-        }
-        stats.avg_rtt = sum / rtt_values.size();
-        
-        // Calculate jitter (standard deviation of RTT)
-        if (rtt_values.size() > 1) {
-            double variance = 0.0;
-            for (double rtt : rtt_values) {
-                double diff = rtt - stats.avg_rtt;
-                variance += diff * diff;
-            }
-            variance /= rtt_values.size();
-            stats.jitter = std::sqrt(variance);
-        } else {
-            stats.jitter = 0.0;
-        }
+        // Calculate min, max, average, jitter and percentiles in one place
+        summarizeRtt(stats);
     } else {
         stats.loss_percentage = 100.0;
     }
@@ -597,270 +827,963 @@ PacketLossStats NetworkMonitor::detectPacketLoss(const std::string& host, int co
     return stats;
 }
 
-// Phase 3: Display active network connections
-void NetworkMonitor::displayActiveConnections() {
-    std::cout << "Active Network Connections" << std::endl;
-    std::cout << "==========================" << std::endl << std::endl;
-    
-    int tcp_count = 0;
-    int udp_count = 0;
-    int tcp_established = 0;
-    int udp_established = 0;
-    
-    // Parse TCP connections
-    std::ifstream tcp_file("/proc/net/tcp");
-    if (tcp_file.is_open()) {
-        std::string line;
-        std::getline(tcp_file, line); // Skip header
-        
-        while (std::getline(tcp_file, line)) {
-            if (line.empty()) continue;
-            
-            std::istringstream iss(line);
-            std::string sl, local_address, rem_address, st, tx_queue, rx_queue, tr, tm_when, retrnsmt, uid, timeout, inode;
-            
-            iss >> sl >> local_address >> rem_address >> st >> tx_queue >> rx_queue 
-                >> tr >> tm_when >> retrnsmt >> uid >> timeout >> inode;
-            
-            if (!st.empty()) {
-                int state = std::stoi(st, nullptr, 16);
-                tcp_count++;
-                
-                // State 01 = ESTABLISHED
-                if (state == 0x01) {
-                    tcp_established++;
-                }
-            }
+// Resolve every host of a target list and add it to a probe scheduler
+bool NetworkMonitor::addProbeTargets(const std::string& targets_file, int default_interval_ms,
+                                     ProbeScheduler& scheduler) {
+    std::vector<ProbeTargetConfig> configs;
+    if (!loadProbeTargets(targets_file, default_interval_ms, configs)) {
+        std::cerr << "Error: Could not read target list: " << targets_file << std::endl;
+        return false;
+    }
+    
+    for (const auto& config : configs) {
+        struct sockaddr_in dest_addr;
+        memset(&dest_addr, 0, sizeof(dest_addr));
+        if (!resolveHostname(config.host, &dest_addr)) {
+            std::cerr << "Warning: Could not resolve hostname: " << config.host << std::endl;
+            continue;
+        }
+        if (!scheduler.addTarget(config.host, dest_addr, config.interval_ms)) {
+            std::cerr << "Warning: Probe timeout is too long for the " << config.interval_ms
+                      << " ms interval of " << config.host << std::endl;
+        }
+    }
+    
+    if (scheduler.targetCount() == 0) {
+        std::cerr << "Error: No probe targets in " << targets_file << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Print and record one report window of every probe target
+void NetworkMonitor::reportProbeWindow(const ProbeScheduler& probes, const std::string& time_str,
+                                       std::ostream& output, const std::string& log_file) {
+    output << "[" << time_str << "] Probe report" << "\n";
+    output << std::fixed << std::setprecision(2);
+    
+    // Only one probe collector runs at a time, so it owns probe_metrics_
+    // (the dashboard gets a copy)
+    std::vector<ProbeMetric>* metrics = &probe_metrics_;
+    metrics->resize(probes.targetCount());
+    
+    // Likewise probe_anomalies_; targets keep their index for the whole run
+    int64_t now_ns = 0;
+    if (probe_anomaly_config_) {
+        if (!probe_anomalies_) {
+            probe_anomalies_.reset(new AnomalyDetector(*probe_anomaly_config_));
         }
-        tcp_file.close();
+        probe_anomalies_->resize(probes.targetCount() * 2);
+        now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
     }
     
-    // Parse UDP connections
-    std::ifstream udp_file("/proc/net/udp");
-    if (udp_file.is_open()) {
-        std::string line;
-        std::getline(udp_file, line); // Skip header
+    for (size_t i = 0; i < probes.targetCount(); i++) {
+        const ProbeTargetStats& window = probes.windowStats(i);
         
-        while (std::getline(udp_file, line)) {
-            if (line.empty()) continue;
-            
-            std::istringstream iss(line);
-            std::string sl, local_address, rem_address, st, tx_queue, rx_queue, tr, tm_when, retrnsmt, uid, timeout, inode;
-            
-            iss >> sl >> local_address >> rem_address >> st >> tx_queue >> rx_queue 
-                >> tr >> tm_when >> retrnsmt >> uid >> timeout >> inode;
-            
-            if (!st.empty()) {
-                udp_count++;
-                udp_established++;
+        // Only probes that were answered or timed out count towards loss
+        PacketLossStats stats = {0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0, 0,
+                                 window.clock_source, window.rtt};
+        stats.packets_received = static_cast<int>(window.received);
+        stats.packets_sent = static_cast<int>(window.received + window.lost);
+        stats.late_replies = static_cast<int>(window.late);
+        stats.duplicate_replies = static_cast<int>(window.duplicates);
+        if (stats.packets_sent > 0) {
+            stats.loss_percentage = (window.lost * 100.0) / stats.packets_sent;
+        }
+        if (window.received == 0) {
+            stats.clock_source = TimestampSource::USERSPACE;
+        } else {
+            summarizeRtt(stats);
+        }
+        
+        output << "  " << std::left << std::setw(24) << probes.targetName(i) << std::right
+               << " sent " << std::setw(5) << stats.packets_sent
+               << " loss " << std::setw(6) << stats.loss_percentage << "%"
+               << " rtt min/avg/max " << stats.min_rtt << "/" << stats.avg_rtt << "/" << stats.max_rtt
+               << " ms p50/p99 " << stats.p50_rtt << "/" << stats.p99_rtt
+               << " ms jitter " << stats.jitter << " ms"
+               << " (" << timestampSourceName(stats.clock_source) << ")" << "\n";
+        
+        if (probe_anomalies_ && stats.packets_sent > 0) {
+            AnomalyEvent event;
+            if (stats.packets_received > 0 &&
+                probe_anomalies_->observe(2 * i, now_ns, stats.avg_rtt, event)) {
+                reportAnomaly(time_str, probes.targetName(i), ANOMALY_RTT, event, output);
             }
+            if (probe_anomalies_->observe(2 * i + 1, now_ns, stats.loss_percentage, event)) {
+                reportAnomaly(time_str, probes.targetName(i), ANOMALY_LOSS, event, output);
+            }
+        }
+        
+        if (!log_file.empty()) {
+            logPacketLossToCSV(log_file, probes.targetName(i), stats);
+        }
+        if (store_) {
+            storePacketLoss(probes.targetName(i), stats);
+        }
+        {
+            const ProbeTargetStats& total = probes.totalStats(i);
+            ProbeMetric& metric = (*metrics)[i];
+            metric.host = probes.targetName(i);
+            metric.sent_total = total.received + total.lost;
+            metric.received_total = total.received;
+            metric.lost_total = total.lost;
+            metric.loss_ratio = stats.loss_percentage / 100.0;
+            metric.rtt_min_ms = stats.min_rtt;
+            metric.rtt_avg_ms = stats.avg_rtt;
+            metric.rtt_max_ms = stats.max_rtt;
+            metric.rtt_p50_ms = stats.p50_rtt;
+            metric.rtt_p90_ms = stats.p90_rtt;
+            metric.rtt_p99_ms = stats.p99_rtt;
+            metric.jitter_ms = stats.jitter;
+            metric.has_rtt = stats.packets_received > 0;
         }
-        udp_file.close();
     }
     
-    // Display statistics
-    std::cout << "TCP Connections:" << std::endl;
-    std::cout << "  Total: " << tcp_count << std::endl;
-    std::cout << "  Established: " << tcp_established << std::endl;
-    std::cout << std::endl;
+    if (exporter_) {
+        MetricsSection<std::vector<ProbeMetric> >& section = exporter_->probes().writeBuffer();
+        section.data = *metrics;
+        section.updated_ms = metricsNowMs();
+        exporter_->probes().publish();
+    }
+    if (shm_) {
+        shm_->publishProbes(*metrics);
+    }
+}
+
+// Probe every target in a list file continuously and report per-target
+// latency and loss for each report interval
+bool NetworkMonitor::monitorProbeTargets(const std::string& targets_file, int report_interval_ms,
+                                         int duration_seconds, int timeout_ms,
+                                         int default_interval_ms, const std::string& log_file) {
+    ProbeScheduler scheduler(timeout_ms);
+    if (!addProbeTargets(targets_file, default_interval_ms, scheduler)) {
+        return false;
+    }
     
-    std::cout << "UDP Connections:" << std::endl;
-    std::cout << "  Total: " << udp_count << std::endl;
-    std::cout << std::endl;
+    std::cout << "Probing " << scheduler.targetCount() << " targets from " << targets_file << std::endl;
+    std::cout << "Press Ctrl+C to stop..." << std::endl << std::endl;
     
-    std::cout << "Total Active Connections: " << (tcp_count + udp_count) << std::endl;
+    auto report = [&](const ProbeScheduler& probes) {
+        std::ostringstream output;
+        reportProbeWindow(probes, currentTimeString(), output, log_file);
+        writeOutput(output.str());
+    };
+    
+    if (!scheduler.run(duration_seconds * 1000, report_interval_ms, report)) {
+        std::cerr << "Error: Could not create raw socket. Root privileges required." << std::endl;
+        return false;
+    }
+    return true;
 }
 
-// Get connection statistics (helper for logging)
-bool NetworkMonitor::getConnectionStats(int& tcp_total, int& tcp_established, int& udp_total) {
-    tcp_total = 0;
-    tcp_established = 0;
-    udp_total = 0;
-    
-    // Parse TCP connections
-    std::ifstream tcp_file("/proc/net/tcp");
-    if (tcp_file.is_open()) {
-        std::string line;
-        std::getline(tcp_file, line); // Skip header
+// Start the HTTP exporter; collectors publish to it from then on
+bool NetworkMonitor::startMetricsExporter(const std::string& address, int port) {
+    std::unique_ptr<MetricsExporter> exporter(new MetricsExporter());
+    if (!exporter->start(address, port)) {
+        return false;
+    }
+    std::cout << "Serving metrics on http://" << address << ":" << exporter->port() << "/metrics" << std::endl;
+    exporter_ = std::move(exporter);
+    return true;
+}
+
+// Publish interface rates and probe results to a POSIX shared-memory segment
+bool NetworkMonitor::startShmPublisher(const std::string& name) {
+    std::unique_ptr<ShmPublisher> publisher(new ShmPublisher());
+    if (!publisher->open(name)) {
+        return false;
+    }
+    std::cout << "Publishing metrics to shared memory " << name << std::endl;
+    shm_ = std::move(publisher);
+    return true;
+}
+
+// CSV file for one record kind next to a log file: "net.csv" -> "net-bandwidth.csv"
+static std::string kindLogFile(const std::string& log_file, const char* kind) {
+    size_t dot = log_file.rfind('.');
+    size_t slash = log_file.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return log_file + "-" + kind + ".csv";
+    }
+    return log_file.substr(0, dot) + "-" + kind + log_file.substr(dot);
+}
+
+// Detectors are created lazily by the collectors, per series
+void NetworkMonitor::enableAnomalyDetection(const AnomalyConfig& bandwidth, const AnomalyConfig& probes,
+                                            const std::string& log_file) {
+    bandwidth_anomaly_config_.reset(new AnomalyConfig(bandwidth));
+    probe_anomaly_config_.reset(new AnomalyConfig(probes));
+    probe_anomalies_.reset();
+    alert_log_ = log_file.empty() ? "" : kindLogFile(log_file, "alerts");
+}
+
+// Rate with a unit in at most 12 characters
+static void formatRate(char* text, size_t size, double bps) {
+    if (bps >= 1e9) {
+        snprintf(text, size, "%.2f Gbps", bps / 1e9);
+    } else if (bps >= 1e6) {
+        snprintf(text, size, "%.2f Mbps", bps / 1e6);
+    } else if (bps >= 1e3) {
+        snprintf(text, size, "%.2f Kbps", bps / 1e3);
+    } else {
+        snprintf(text, size, "%.0f bps", bps);
+    }
+}
+
+// Dashboard rows of every selected interface with rates, in stats table
+// order (reuses the rows' strings)
+void NetworkMonitor::fillDashboardInterfaces(const BandwidthState& state,
+                                             std::vector<DashboardInterface>& rows) const {
+    size_t count = 0;
+    for (size_t i = 0; i < state.selected.size(); i++) {
+        if (!state.selected[i] || !state.has_prev[i]) {
+            continue;
+        }
+        if (count == rows.size()) {
+            rows.push_back(DashboardInterface());
+        }
+        rows[count].name = state.prev_stats[i].interface_name;
+        rows[count].rates = state.rates[i];
+        count++;
+    }
+    rows.resize(count);
+}
+
+// Build one dashboard frame from a copy of the view. Rows keep the stats
+// table and target order, so a steady view changes few cells.
+void NetworkMonitor::composeDashboard(const DashboardView& view, TerminalScreen& screen) const {
+    char line[512];
+    char rx[32];
+    char tx[32];
+    screen.beginFrame();
+    
+    snprintf(line, sizeof(line), "netmonitor - %s - %zu interfaces, %zu targets  (Ctrl+C to quit)",
+             currentTimeString().c_str(), view.interfaces.size(), view.probes.size());
+    screen.line(line);
+    screen.line("");
+    
+    snprintf(line, sizeof(line), "%-16s %12s %12s %10s %10s %9s %9s %8s",
+             "INTERFACE", "RX", "TX", "RX pkt/s", "TX pkt/s", "drops/s", "errors/s", "interval");
+    screen.line(line);
+    for (size_t i = 0; i < view.interfaces.size(); i++) {
+        const InterfaceRates& rates = view.interfaces[i].rates;
+        formatRate(rx, sizeof(rx), rates.download_bps);
+        formatRate(tx, sizeof(tx), rates.upload_bps);
+        snprintf(line, sizeof(line), "%-16.16s %12s %12s %10.0f %10.0f %9.1f %9.1f %7.2fs",
+                 view.interfaces[i].name.c_str(), rx, tx,
+                 rates.rx_packets_per_second, rates.tx_packets_per_second,
+                 rates.drops_per_second, rates.errors_per_second, rates.interval_seconds);
+        screen.line(line);
+    }
+    
+    if (!view.probes.empty()) {
+        screen.line("");
+        snprintf(line, sizeof(line), "%-28s %8s %9s %9s %9s %10s",
+                 "TARGET", "loss %", "avg ms", "p99 ms", "jitter", "sent");
+        screen.line(line);
+        for (size_t i = 0; i < view.probes.size(); i++) {
+            const ProbeMetric& probe = view.probes[i];
+            if (probe.has_rtt) {
+                snprintf(line, sizeof(line), "%-28.28s %8.2f %9.2f %9.2f %9.2f %10llu",
+                         probe.host.c_str(), probe.loss_ratio * 100.0, probe.rtt_avg_ms, probe.rtt_p99_ms,
+                         probe.jitter_ms, static_cast<unsigned long long>(probe.sent_total));
+            } else {
+                snprintf(line, sizeof(line), "%-28.28s %8.2f %9s %9s %9s %10llu",
+                         probe.host.c_str(), probe.loss_ratio * 100.0, "-", "-", "-",
+                         static_cast<unsigned long long>(probe.sent_total));
+            }
+            screen.line(line);
+        }
+    }
+    
+    if (view.has_connections) {
+        const ConnectionStateSample& sample = view.connections;
+        screen.line("");
+        int length = snprintf(line, sizeof(line), "CONNECTIONS  TCP %llu  UDP %llu",
+                              static_cast<unsigned long long>(sample.tcp_total),
+                              static_cast<unsigned long long>(sample.udp_total));
+        if (sample.has_churn && sample.interval_seconds > 0.0) {
+            snprintf(line + length, sizeof(line) - length, "  opened %.1f/s  closed %.1f/s",
+                     sample.opened / sample.interval_seconds, sample.closed / sample.interval_seconds);
+        }
+        screen.line(line);
         
-        while (std::getline(tcp_file, line)) {
-            if (line.empty()) continue;
-            
-            std::istringstream iss(line);
-            std::string sl, local_address, rem_address, st, tx_queue, rx_queue, tr, tm_when, retrnsmt, uid, timeout, inode;
-            
-            iss >> sl >> local_address >> rem_address >> st >> tx_queue >> rx_queue 
-                >> tr >> tm_when >> retrnsmt >> uid >> timeout >> inode;
-            
-            if (!st.empty()) {
-                int state = std::stoi(st, nullptr, 16);
-                tcp_total++;
-                
-                if (state == 0x01) {
-                    tcp_established++;
+        std::string states = " ";
+        for (int state = 1; state < kTcpStateSlots; state++) {
+            const char* name = tcpStateName(state);
+            if (sample.tcp_states[state] == 0 || name == nullptr) {
+                continue;
+            }
+            snprintf(line, sizeof(line), " %s %llu", name,
+                     static_cast<unsigned long long>(sample.tcp_states[state]));
+            states += line;
+        }
+        screen.line(states);
+    }
+    
+    if (!view.events.empty()) {
+        screen.line("");
+        screen.line("EVENTS");
+        for (size_t i = 0; i < view.events.size(); i++) {
+            screen.line(view.events[i]);
+        }
+    }
+}
+
+// Daemon mode: every collector is a job on a small worker pool. The probe
+// scheduler is event driven and keeps a worker of its own, and counter and
+// connection sampling each have their own deadline, so a slow or blocked
+// collector never delays another one. All output goes to the shared sinks.
+bool NetworkMonitor::runDaemon(const DaemonOptions& options) {
+    // The dashboard needs a terminal; otherwise the collectors print lines
+    std::unique_ptr<TerminalScreen> screen;
+    if (options.dashboard) {
+        if (TerminalScreen::isTerminal(STDOUT_FILENO)) {
+            screen.reset(new TerminalScreen(STDOUT_FILENO));
+        } else {
+            std::cerr << "stdout is not a terminal; printing lines instead of the dashboard" << std::endl;
+        }
+    }
+    
+    // With the dashboard, collectors run unlocked and then copy their results
+    // into the view under view_mutex. Their text is not printed; alert and
+    // error lines go to the view's event list.
+    std::mutex view_mutex;
+    std::mutex output_mutex;
+    DashboardView view;
+    const size_t kDashboardEvents = 5;
+    auto emit = [&](const std::string& text) {
+        if (!screen) {
+            std::lock_guard<std::mutex> lock(output_mutex);
+            writeOutput(text);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(view_mutex);
+        std::vector<std::string>& events = view.events;
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t end = text.find('\n', start);
+            if (end == std::string::npos) {
+                end = text.size();
+            }
+            std::string line = text.substr(start, end - start);
+            if (line.find("] ALERT ") != std::string::npos || line.find("] CLEARED ") != std::string::npos ||
+                line.compare(0, 5, "Error") == 0 || line.compare(0, 7, "Warning") == 0) {
+                if (events.size() == kDashboardEvents) {
+                    events.erase(events.begin());
                 }
+                events.push_back(line);
             }
+            start = end + 1;
+        }
+    };
+    
+    // Bandwidth collector
+    BandwidthState bandwidth;
+    bandwidth.selectors = options.interfaces;
+    int bandwidth_period_ms = startAdaptiveSampling(bandwidth, options.bandwidth_interval_ms);
+    if (!sampleInterfaces() || !resolveBandwidthSelection(bandwidth)) {
+        std::cerr << "Error: No interface matches the --monitor selection" << std::endl;
+        return false;
+    }
+    startBandwidthHistory(bandwidth, bandwidth_period_ms);
+    std::string bandwidth_log = options.log_file.empty() ? "" : kindLogFile(options.log_file, "bandwidth");
+    
+    // Probe collector
+    std::unique_ptr<ProbeScheduler> probes;
+    if (!options.targets_file.empty()) {
+        probes.reset(new ProbeScheduler(options.probe_timeout_ms));
+        if (!addProbeTargets(options.targets_file, options.probe_default_interval_ms, *probes)) {
+            return false;
         }
-        tcp_file.close();
     }
+    std::string probe_log = options.log_file.empty() ? "" : kindLogFile(options.log_file, "packetloss");
+    std::string connections_log = options.log_file.empty() ? "" : kindLogFile(options.log_file, "connections");
     
-    // Parse UDP connections
-    std::ifstream udp_file("/proc/net/udp");
-    if (udp_file.is_open()) {
-        std::string line;
-        std::getline(udp_file, line); // Skip header
-        
-        while (std::getline(udp_file, line)) {
-            if (line.empty()) continue;
-            
-            std::istringstream iss(line);
-            std::string sl, local_address, rem_address, st, tx_queue, rx_queue, tr, tm_when, retrnsmt, uid, timeout, inode;
-            
-            iss >> sl >> local_address >> rem_address >> st >> tx_queue >> rx_queue 
-                >> tr >> tm_when >> retrnsmt >> uid >> timeout >> inode;
-            
-            if (!st.empty()) {
-                udp_total++;
+    size_t workers = 1 + (probes ? 1 : 0) + (options.connections_interval_ms > 0 ? 1 : 0) + (screen ? 1 : 0);
+    std::vector<DashboardInterface> interface_rows;     // Filled by the bandwidth job
+    DashboardView frame_view;                           // Copy drawn by the dashboard job
+    JobScheduler jobs(workers);
+    
+    jobs.addPeriodic("bandwidth", std::chrono::milliseconds(bandwidth_period_ms), [&]() {
+        if (bandwidth.adaptive && !bandwidth.adaptive->anyDue(steadyNowNs())) {
+            return;
+        }
+        if (!sampleInterfaces()) {
+            emit("Error reading interface stats\n");
+            return;
+        }
+        std::ostringstream output;
+        output << std::fixed << std::setprecision(2);
+        collectBandwidth(bandwidth, currentTimeString(), output, bandwidth_log);
+        emit(output.str());
+        if (screen) {
+            fillDashboardInterfaces(bandwidth, interface_rows);
+            std::lock_guard<std::mutex> lock(view_mutex);
+            view.interfaces.swap(interface_rows);
+        }
+    });
+    
+    if (probes) {
+        jobs.addTask("probes", [&]() {
+            bool ok = probes->run(0, options.probe_report_interval_ms, [&](const ProbeScheduler& scheduler) {
+                std::ostringstream output;
+                reportProbeWindow(scheduler, currentTimeString(), output, probe_log);
+                emit(output.str());
+                if (screen) {
+                    std::lock_guard<std::mutex> lock(view_mutex);
+                    view.probes = probe_metrics_;
+                }
+            });
+            if (!ok) {
+                emit("Error: Could not create raw socket for probing. Root privileges required.\n");
+            }
+        }, [&]() { probes->stop(); });
+    }
+    
+    if (options.connections_interval_ms > 0) {
+        jobs.addPeriodic("connections", std::chrono::milliseconds(options.connections_interval_ms), [&]() {
+            std::ostringstream output;
+            if (!collectConnections(currentTimeString(), output, connections_log)) {
+                emit("Error: Unable to read connection statistics\n");
+                return;
             }
+            emit(output.str());
+            if (screen) {
+                std::lock_guard<std::mutex> lock(view_mutex);
+                view.connections = connection_states_;
+                view.has_connections = true;
+            }
+        });
+    }
+    
+    // The view is copied under the lock; frames are composed and drawn outside it
+    if (screen) {
+        int refresh_ms = std::min(std::max(options.bandwidth_interval_ms, 100), 1000);
+        jobs.addPeriodic("dashboard", std::chrono::milliseconds(refresh_ms), [&]() {
+            {
+                std::lock_guard<std::mutex> lock(view_mutex);
+                frame_view = view;
+            }
+            composeDashboard(frame_view, *screen);
+            screen->present();
+        });
+    }
+    
+    std::cout << "Daemon running " << jobs.jobCount() << " collectors on " << workers << " workers:" << std::endl;
+    std::cout << "  bandwidth every " << options.bandwidth_interval_ms << " ms" << std::endl;
+    if (probes) {
+        std::cout << "  probing " << probes->targetCount() << " targets, report every "
+                  << options.probe_report_interval_ms << " ms" << std::endl;
+    }
+    if (options.connections_interval_ms > 0) {
+        std::cout << "  connections every " << options.connections_interval_ms << " ms" << std::endl;
+    }
+    std::cout << "Press Ctrl+C to stop..." << std::endl << std::endl;
+    
+    if (screen && !screen->start()) {
+        screen.reset();
+    }
+    jobs.run();
+    if (screen) {
+        screen->stop();
+    }
+    
+    for (size_t i = 0; i < jobs.jobCount(); i++) {
+        if (jobs.skipped(i) > 0) {
+            std::cerr << "Collector " << jobs.jobName(i) << " skipped " << jobs.skipped(i)
+                      << " of " << (jobs.runs(i) + jobs.skipped(i)) << " runs" << std::endl;
         }
-        udp_file.close();
     }
     
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(2);
+    reportBandwidthHistory(bandwidth, summary);
+    std::cout << summary.str() << std::flush;
     return true;
 }
 
-// Phase 4: CSV Data Logging
+// Select the collector used for connection statistics
+void NetworkMonitor::setConnectionBackend(ConnectionBackend backend) {
+    connection_backend_ = backend;
+    if (backend == ConnectionBackend::SOCK_DIAG && !sock_diag_) {
+        sock_diag_.reset(new SockDiagClient());
+    }
+}
 
-// Get current timestamp as string
-std::string getCurrentTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t_now = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t_now), "%Y-%m-%d %H:%M:%S");
-    return ss.str();
+// Phase 3: Display active network connections
+void NetworkMonitor::displayActiveConnections() {
+    ConnectionStats stats;
+    if (!getConnectionStats(stats)) {
+        std::cerr << "Error: Unable to read connection statistics" << std::endl;
+        return;
+    }
+    ConsoleRenderer(std::cout).renderConnections(stats);
 }
 
-// Log bandwidth data to CSV
-bool NetworkMonitor::logBandwidthToCSV(const std::string& filename, const std::string& interface,
-                                       double download_bps, double upload_bps) {
-    std::ofstream csv_file;
+// Get connection statistics (helper for logging)
+bool NetworkMonitor::getConnectionStats(int& tcp_total, int& tcp_established, int& udp_total) {
+    ConnectionStats stats;
+    bool ok = getConnectionStats(stats);
+    tcp_total = stats.tcp_total;
+    tcp_established = stats.tcp_established;
+    udp_total = stats.udp_total;
+    return ok;
+}
+
+// Get connection statistics from the active backend
+bool NetworkMonitor::getConnectionStats(ConnectionStats& stats) {
+    stats.tcp_total = 0;
+    stats.tcp_established = 0;
+    stats.udp_total = 0;
+    
+    if (connection_backend_ == ConnectionBackend::SOCK_DIAG) {
+        return querySockDiagConnections(stats);
+    }
+    return parseProcNetConnections(stats);
+}
+
+// Count connections through sock_diag (IPv4 and IPv6). Totals come from the
+// /proc/net/sockstat summary; only ESTABLISHED sockets are dumped, and the
+// kernel filters them by state before replying.
+bool NetworkMonitor::querySockDiagConnections(ConnectionStats& stats) {
+    if (!sock_diag_->count(IPPROTO_TCP, tcpStateMask(TCP_ESTABLISHED), stats.tcp_established)) {
+        return false;
+    }
     
-    // Check if file exists to determine if we need headers
-    bool file_exists = std::ifstream(filename).good();
+    SockstatSummary summary;
+    if (readSockstat(summary)) {
+        stats.tcp_total = summary.tcp_inuse + summary.tcp_timewait;
+        stats.udp_total = summary.udp_inuse;
+        return true;
+    }
     
-    csv_file.open(filename, std::ios::app);
-    if (!csv_file.is_open()) {
-        std::cerr << "Error: Could not open CSV file: " << filename << std::endl;
+    // No sockstat (unusual /proc setups): fall back to full dumps
+    return sock_diag_->count(IPPROTO_TCP, kAllSocketStates, stats.tcp_total) &&
+           sock_diag_->count(IPPROTO_UDP, kAllSocketStates, stats.udp_total);
+}
+
+// Flow endpoint as "addr:port" ("[addr]:port" for IPv6)
+static std::string formatFlowEndpoint(int family, const uint8_t* address, uint16_t port) {
+    char text[INET6_ADDRSTRLEN];
+    if (inet_ntop(family, address, text, sizeof(text)) == nullptr) {
+        return "?";
+    }
+    std::ostringstream out;
+    if (family == AF_INET6) {
+        out << "[" << text << "]:" << port;
+    } else {
+        out << text << ":" << port;
+    }
+    return out.str();
+}
+
+// Print the busiest TCP flows between consecutive sock_diag snapshots
+bool NetworkMonitor::monitorTopTalkers(size_t top_k, int interval_ms, int duration_seconds) {
+    if (!sock_diag_) {
+        sock_diag_.reset(new SockDiagClient());
+    }
+    TcpFlowTracker tracker(*sock_diag_);
+    if (!tracker.sample()) {
+        std::cerr << "Error: Unable to dump TCP sockets through sock_diag" << std::endl;
         return false;
     }
     
-    // Write header if new file
-    if (!file_exists) {
-        csv_file << "Timestamp,Interface,Download_bps,Upload_bps,Download_Mbps,Upload_Mbps\n";
+    IntervalTimer timer;
+    if (!timer.start(std::chrono::milliseconds(interval_ms))) {
+        return false;
     }
+    std::cout << "Tracking top " << top_k << " TCP flows (" << tracker.flowCount()
+              << " sockets)" << std::endl;
+    std::cout << "Press Ctrl+C to stop..." << std::endl << std::endl;
     
-    // Write data
-    csv_file << getCurrentTimestamp() << ","
-             << interface << ","
-             << std::fixed << std::setprecision(2)
-             << download_bps << ","
-             << upload_bps << ","
-             << (download_bps / 1000000.0) << ","
-             << (upload_bps / 1000000.0) << "\n";
+    auto start = std::chrono::steady_clock::now();
+    std::vector<FlowRate> top;
+    while (true) {
+        uint64_t missed = 0;
+        if (!timer.wait(missed)) {
+            break;
+        }
+        if (!tracker.sample()) {
+            std::cerr << "Error reading TCP sockets" << std::endl;
+            return false;
+        }
+        tracker.topK(top_k, top);
+        
+        std::ostringstream output;
+        output << std::fixed << std::setprecision(2);
+        output << "[" << currentTimeString() << "] " << tracker.flowCount() << " sockets, "
+               << tracker.activeCount() << " active\n";
+        for (size_t i = 0; i < top.size(); i++) {
+            const FlowRate& flow = top[i];
+            output << std::setw(3) << (i + 1) << ". "
+                   << formatFlowEndpoint(flow.family, flow.local_address, flow.local_port) << " -> "
+                   << formatFlowEndpoint(flow.family, flow.remote_address, flow.remote_port) << "  ↓ ";
+            appendRate(output, flow.rx_bps);
+            output << " | ↑ ";
+            appendRate(output, flow.tx_bps);
+            if (flow.delivery_bps > 0.0) {
+                output << " | delivery ";
+                appendRate(output, flow.delivery_bps);
+            }
+            output << " | rtt " << flow.rtt_ms << " ms\n";
+        }
+        output << "\n";
+        writeOutput(output.str());
+        
+        if (duration_seconds > 0 &&
+            calculateTimeDiff(start, std::chrono::steady_clock::now()) >= duration_seconds) {
+            break;
+        }
+    }
+    return true;
+}
+
+// Count TCP states and diff socket inodes against the previous sample
+bool NetworkMonitor::sampleConnectionStates(ConnectionStateSample& sample) {
+    SocketTableCounts tcp;
+    sample.udp_total = 0;
+    churn_->begin();
+    
+    if (connection_backend_ == ConnectionBackend::SOCK_DIAG) {
+        SocketChurnTracker& churn = *churn_;
+        SockDiagClient::Visitor visit = [&tcp, &churn](const struct inet_diag_msg& msg,
+                                                       const struct rtattr*, int) {
+            tcp.rows++;
+            tcp.states[msg.idiag_state & (kTcpStateSlots - 1)]++;
+            churn.add(msg.idiag_inode);
+        };
+        if (!sock_diag_->dump(AF_INET, IPPROTO_TCP, kAllSocketStates, 0, visit)) {
+            return false;
+        }
+        // IPv6 may be disabled; IPv4 results are still valid
+        sock_diag_->dump(AF_INET6, IPPROTO_TCP, kAllSocketStates, 0, visit);
+        
+        SockstatSummary summary;
+        int udp_total = 0;
+        if (readSockstat(summary)) {
+            udp_total = summary.udp_inuse;
+        } else {
+            sock_diag_->count(IPPROTO_UDP, kAllSocketStates, udp_total);
+        }
+        sample.udp_total = static_cast<uint64_t>(udp_total);
+    } else {
+        inode_scratch_.clear();
+        if (!proc_net_parser_->parseFile("/proc/net/tcp", tcp, &inode_scratch_)) {
+            return false;
+        }
+        proc_net_parser_->parseFile("/proc/net/tcp6", tcp, &inode_scratch_);
+        for (size_t i = 0; i < inode_scratch_.size(); i++) {
+            churn_->add(inode_scratch_[i]);
+        }
+        
+        SocketTableCounts udp;
+        proc_net_parser_->parseFile("/proc/net/udp", udp);
+        proc_net_parser_->parseFile("/proc/net/udp6", udp);
+        sample.udp_total = udp.rows;
+    }
     
-    csv_file.close();
+    auto now = std::chrono::steady_clock::now();
+    sample.has_churn = churn_->end(sample.opened, sample.closed);
+    sample.interval_seconds = sample.has_churn ? calculateTimeDiff(last_connection_sample_, now) : 0.0;
+    last_connection_sample_ = now;
+    
+    memcpy(sample.tcp_states, tcp.states, sizeof(sample.tcp_states));
+    sample.tcp_total = tcp.rows;
     return true;
 }
 
-// Log latency measurement to CSV
-bool NetworkMonitor::logLatencyToCSV(const std::string& filename, const LatencyResult& result) {
-    std::ofstream csv_file;
+// Sample connection states and report, log, store and export them
+bool NetworkMonitor::collectConnections(const std::string& time_str, std::ostream& output,
+                                        const std::string& log_file) {
+    ConnectionStateSample sample;
+    if (!sampleConnectionStates(sample)) {
+        return false;
+    }
+    int tcp_total = static_cast<int>(sample.tcp_total);
+    int tcp_established = static_cast<int>(sample.tcp_states[TCP_ESTABLISHED]);
+    int udp_total = static_cast<int>(sample.udp_total);
+    
+    output << "[" << time_str << "] Connections - TCP: " << tcp_total << " (";
+    bool first = true;
+    for (int state = 1; state < kTcpStateSlots; state++) {
+        const char* name = tcpStateName(state);
+        if (sample.tcp_states[state] == 0 || name == nullptr) {
+            continue;
+        }
+        output << (first ? "" : ", ") << name << " " << sample.tcp_states[state];
+        first = false;
+    }
+    output << ")";
+    if (sample.has_churn && sample.interval_seconds > 0.0) {
+        output << std::fixed << std::setprecision(2)
+               << " | opened " << sample.opened / sample.interval_seconds << "/s"
+               << ", closed " << sample.closed / sample.interval_seconds << "/s";
+    }
+    output << " | UDP: " << udp_total << "\n";
+    connection_states_ = sample;
     
-    bool file_exists = std::ifstream(filename).good();
+    if (!log_file.empty()) {
+        logConnectionsToCSV(log_file, tcp_total, tcp_established, udp_total);
+    }
+    storeConnections(tcp_total, tcp_established, udp_total);
+    if (exporter_) {
+        MetricsSection<ConnectionMetric>& section = exporter_->connections().writeBuffer();
+        section.data.valid = true;
+        section.data.tcp_total = tcp_total;
+        section.data.tcp_established = tcp_established;
+        section.data.udp_total = udp_total;
+        section.updated_ms = metricsNowMs();
+        exporter_->connections().publish();
+    }
+    return true;
+}
+
+// Continuous connection monitoring with state counts and churn
+bool NetworkMonitor::monitorConnectionsContinuous(int interval_ms, int duration_seconds,
+                                                  const std::string& log_file) {
+    IntervalTimer timer;
+    if (!timer.start(std::chrono::milliseconds(interval_ms))) {
+        return false;
+    }
+    std::cout << "Starting continuous connection monitoring" << std::endl;
+    std::cout << "Press Ctrl+C to stop..." << std::endl << std::endl;
     
-    csv_file.open(filename, std::ios::app);
-    if (!csv_file.is_open()) {
+    auto start = std::chrono::steady_clock::now();
+    while (true) {
+        std::ostringstream output;
+        if (!collectConnections(currentTimeString(), output, log_file)) {
+            std::cerr << "Error: Unable to read connection statistics" << std::endl;
+            return false;
+        }
+        writeOutput(output.str());
+        
+        if (duration_seconds > 0 &&
+            calculateTimeDiff(start, std::chrono::steady_clock::now()) >= duration_seconds) {
+            break;
+        }
+        uint64_t missed = 0;
+        if (!timer.wait(missed)) {
+            break;
+        }
+    }
+    return true;
+}
+
+// Parse /proc/net/tcp{,6} and /proc/net/udp{,6}
+bool NetworkMonitor::parseProcNetConnections(ConnectionStats& stats) {
+    SocketTableCounts tcp;
+    SocketTableCounts udp;
+    bool tcp_ok = proc_net_parser_->parseFile("/proc/net/tcp", tcp);
+    bool udp_ok = proc_net_parser_->parseFile("/proc/net/udp", udp);
+    // Missing when IPv6 is disabled
+    proc_net_parser_->parseFile("/proc/net/tcp6", tcp);
+    proc_net_parser_->parseFile("/proc/net/udp6", udp);
+    
+    stats.tcp_total = static_cast<int>(tcp.rows);
+    stats.tcp_established = static_cast<int>(tcp.states[TCP_ESTABLISHED]);
+    stats.udp_total = static_cast<int>(udp.rows);
+    return tcp_ok || udp_ok;
+}
+
+// Append one synthetic /proc/net/tcp{,6} row
+static void appendSyntheticRow(std::string& table, size_t slot, bool ipv6, unsigned state) {
+    char line[256];
+    unsigned port = 1024 + static_cast<unsigned>(slot % 60000);
+    int length;
+    if (ipv6) {
+        length = snprintf(line, sizeof(line),
+                          "%6zu: 0000000000000000FFFF00000100007F:%04X 0000000000000000FFFF00000A00000A:01BB "
+                          "%02X 00000000:00000000 00:00000000 00000000  1000        0 %zu 1 0000000000000000 20 4 30 10 -1\n",
+                          slot, port, state, 100000 + slot);
+    } else {
+        length = snprintf(line, sizeof(line),
+                          "%4zu: 0100007F:%04X 0A00000A:01BB %02X 00000000:00000000 00:00000000 00000000  "
+                          "1000        0 %zu 1 0000000000000000 20 4 30 10 -1\n",
+                          slot, port, state, 100000 + slot);
+    }
+    table.append(line, static_cast<size_t>(length));
+}
+
+// Time the connection table parser on synthetic tcp and tcp6 tables
+void NetworkMonitor::benchmarkConnectionParsing(size_t sockets) {
+    const char* header = "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when "
+                         "retrnsmt   uid  timeout inode\n";
+    std::string tables[2];
+    for (int family = 0; family < 2; family++) {
+        tables[family] = header;
+        size_t rows = sockets / 2 + (family == 0 ? sockets % 2 : 0);
+        for (size_t i = 0; i < rows; i++) {
+            // Mostly established, with some TIME_WAIT and listeners
+            unsigned state = i % 10 < 7 ? 0x01 : (i % 10 < 9 ? 0x06 : 0x0A);
+            appendSyntheticRow(tables[family], i, family == 1, state);
+        }
+    }
+    double megabytes = (tables[0].size() + tables[1].size()) / (1024.0 * 1024.0);
+    
+    std::cout << "Connection table parsing: " << sockets << " sockets, " << std::fixed
+              << std::setprecision(1) << megabytes << " MB of tcp + tcp6 text" << std::endl;
+    
+    unsigned thread_counts[2] = { 1, proc_net_parser_->threads() };
+    for (int run = 0; run < (thread_counts[1] > 1 ? 2 : 1); run++) {
+        ProcNetTableParser parser(thread_counts[run]);
+        double best = 0.0;
+        SocketTableCounts counts;
+        for (int repeat = 0; repeat < 5; repeat++) {
+            counts.clear();
+            auto start = std::chrono::steady_clock::now();
+            parser.parseBuffer(tables[0].data(), tables[0].size(), counts);
+            parser.parseBuffer(tables[1].data(), tables[1].size(), counts);
+            double seconds = calculateTimeDiff(start, std::chrono::steady_clock::now());
+            if (repeat == 0 || seconds < best) {
+                best = seconds;
+            }
+        }
+        std::cout << "  " << std::setw(2) << parser.threads() << " thread(s): "
+                  << std::setprecision(2) << best * 1000.0 << " ms, "
+                  << std::setprecision(1) << counts.rows / best / 1e6 << " M sockets/s, "
+                  << megabytes / best << " MB/s (" << counts.states[TCP_ESTABLISHED]
+                  << " established)" << std::endl;
+    }
+    
+    // The live tables for comparison (dominated by the kernel's text generation)
+    SocketTableCounts live;
+    auto start = std::chrono::steady_clock::now();
+    proc_net_parser_->parseFile("/proc/net/tcp", live);
+    proc_net_parser_->parseFile("/proc/net/tcp6", live);
+    double seconds = calculateTimeDiff(start, std::chrono::steady_clock::now());
+    std::cout << "  live /proc/net/tcp{,6}: " << live.rows << " sockets read and parsed in "
+              << std::setprecision(2) << seconds * 1000.0 << " ms" << std::endl;
+}
+
+// Phase 4: CSV Data Logging
+
+// Get (or open) the background CSV writer for a file
+CsvLogger* NetworkMonitor::csvLogger(const std::string& filename, int kind) {
+    unsigned long long generation = csv_logger_generation.load(std::memory_order_acquire);
+    if (!cached_csv_loggers.empty() && cached_csv_loggers.front().generation != generation) {
+        cached_csv_loggers.clear();
+    }
+    for (const CachedCsvLogger& cached : cached_csv_loggers) {
+        if (cached.owner == this && cached.filename == filename) {
+            return cached.logger;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(csv_mutex_);
+    std::unique_ptr<CsvLogger>& logger = csv_loggers_[filename];
+    if (!logger) {
+        LogRecord::Kind record_kind = static_cast<LogRecord::Kind>(kind);
+        logger.reset(new CsvLogger(filename, CsvLogger::headerFor(record_kind)));
+    }
+    
+    if (!logger->isOpen()) {
         std::cerr << "Error: Could not open CSV file: " << filename << std::endl;
+        csv_loggers_.erase(filename);
+        return nullptr;
+    }
+    CachedCsvLogger cached = { this, generation, filename, logger.get() };
+    cached_csv_loggers.push_back(cached);
+    return logger.get();
+}
+
+// Start a record stamped with the current wall-clock second
+static void beginRecord(LogRecord& record, LogRecord::Kind kind, const std::string& name) {
+    record.kind = kind;
+    record.wall_time = std::time(nullptr);
+    size_t length = std::min(name.size(), sizeof(record.name) - 1);
+    memcpy(record.name, name.data(), length);
+    record.name[length] = '\0';
+}
+
+// Log bandwidth data to CSV
+bool NetworkMonitor::logBandwidthToCSV(const std::string& filename, const std::string& interface,
+                                       double download_bps, double upload_bps, double interval_seconds) {
+    CsvLogger* logger = csvLogger(filename, LogRecord::BANDWIDTH);
+    if (logger == nullptr) {
         return false;
     }
     
-    // Write header if new file
-    if (!file_exists) {
-        csv_file << "Timestamp,Host,RTT_ms,Success\n";
+    LogRecord record;
+    beginRecord(record, LogRecord::BANDWIDTH, interface);
+    record.values[0] = download_bps;
+    record.values[1] = upload_bps;
+    record.values[2] = interval_seconds;
+    logger->push(record);
+    return true;
+}
+
+// Log latency measurement to CSV
+bool NetworkMonitor::logLatencyToCSV(const std::string& filename, const LatencyResult& result) {
+    CsvLogger* logger = csvLogger(filename, LogRecord::LATENCY);
+    if (logger == nullptr) {
+        return false;
     }
     
-    // Write data
-    csv_file << getCurrentTimestamp() << ","
-             << result.host << ","
-             << std::fixed << std::setprecision(2)
-             << result.rtt_ms << ","
-             << (result.success ? "Yes" : "No") << "\n";
-    
-    csv_file.close();
+    LogRecord record;
+    beginRecord(record, LogRecord::LATENCY, result.host);
+    record.values[0] = result.rtt_ms;
+    record.counts[0] = result.success ? 1 : 0;
+    logger->push(record);
     return true;
 }
 
 // Log packet loss statistics to CSV
 bool NetworkMonitor::logPacketLossToCSV(const std::string& filename, const std::string& host,
                                        const PacketLossStats& stats) {
-    std::ofstream csv_file;
-    
-    bool file_exists = std::ifstream(filename).good();
-    
-    csv_file.open(filename, std::ios::app);
-    if (!csv_file.is_open()) {
-        std::cerr << "Error: Could not open CSV file: " << filename << std::endl;
+    CsvLogger* logger = csvLogger(filename, LogRecord::PACKET_LOSS);
+    if (logger == nullptr) {
         return false;
     }
     
-    // Write header if new file
-    if (!file_exists) {
-        csv_file << "Timestamp,Host,Packets_Sent,Packets_Received,Loss_Percentage,"
-                 << "Min_RTT_ms,Max_RTT_ms,Avg_RTT_ms,Jitter_ms\n";
+    LogRecord record;
+    beginRecord(record, LogRecord::PACKET_LOSS, host);
+    record.counts[0] = stats.packets_sent;
+    record.counts[1] = stats.packets_received;
+    record.values[0] = stats.loss_percentage;
+    record.values[1] = stats.min_rtt;
+    record.values[2] = stats.max_rtt;
+    record.values[3] = stats.avg_rtt;
+    record.values[4] = stats.jitter;
+    logger->push(record);
+    return true;
+}
+
+// Log an anomaly alert (raised or cleared) to CSV
+bool NetworkMonitor::logAlertToCSV(const std::string& filename, const std::string& series, int metric,
+                                   const AnomalyEvent& event) {
+    CsvLogger* logger = csvLogger(filename, LogRecord::ALERT);
+    if (logger == nullptr) {
+        return false;
     }
     
-    // Write data
-    csv_file << getCurrentTimestamp() << ","
-             << host << ","
-             << stats.packets_sent << ","
-             << stats.packets_received << ","
-             << std::fixed << std::setprecision(2)
-             << stats.loss_percentage << ","
-             << stats.min_rtt << ","
-             << stats.max_rtt << ","
-             << stats.avg_rtt << ","
-             << stats.jitter << "\n";
-    
-    csv_file.close();
+    LogRecord record;
+    beginRecord(record, LogRecord::ALERT, series);
+    record.counts[0] = metric;
+    record.counts[1] = event.active ? 1 : 0;
+    record.values[0] = event.value;
+    record.values[1] = event.expected;
+    record.values[2] = event.score;
+    logger->push(record);
     return true;
 }
 
 // Log connection statistics to CSV
 bool NetworkMonitor::logConnectionsToCSV(const std::string& filename, int tcp_total, 
                                          int tcp_established, int udp_total) {
-    std::ofstream csv_file;
-    
-    bool file_exists = std::ifstream(filename).good();
-    
-    csv_file.open(filename, std::ios::app);
-    if (!csv_file.is_open()) {
-        std::cerr << "Error: Could not open CSV file: " << filename << std::endl;
+    CsvLogger* logger = csvLogger(filename, LogRecord::CONNECTIONS);
+    if (logger == nullptr) {
         return false;
     }
     
-    // Write header if new file
-    if (!file_exists) {
-        csv_file << "Timestamp,TCP_Total,TCP_Established,UDP_Total,Total_Connections\n";
-    }
-    
-    // Write data
-    csv_file << getCurrentTimestamp() << ","
-             << tcp_total << ","
-             << tcp_established << ","
-             << udp_total << ","
-             << (tcp_total + udp_total) << "\n";
-    
-    csv_file.close();
+    LogRecord record;
+    beginRecord(record, LogRecord::CONNECTIONS, "");
+    record.counts[0] = tcp_total;
+    record.counts[1] = tcp_established;
+    record.counts[2] = udp_total;
+    logger->push(record);
     return true;
 }
 
@@ -872,26 +1795,188 @@ void NetworkMonitor::logToCSV(const std::string& filename) {
     }
     
     // Use first available interface
-    std::string interface = available_interfaces_[0];
-    InterfaceStats stats1, stats2;
-    
-    if (!readInterfaceStats(interface, stats1)) {
+    BandwidthResult result = measureBandwidth(available_interfaces_[0]);
+    if (!result.success) {
         std::cerr << "Error: Could not read interface stats" << std::endl;
         return;
     }
     
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    if (logBandwidthToCSV(filename, result.interface, result.download_bps, result.upload_bps,
+                          result.interval_seconds)) {
+        std::cout << "Bandwidth data logged to: " << filename << std::endl;
+    }
+}
+
+
+// Binary time-series store
+
+// Wall clock in nanoseconds since the epoch
+static int64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Open (or create) the store that measurements are appended to
+bool NetworkMonitor::openStore(const std::string& directory, const int64_t* retention_ns) {
+    std::unique_ptr<RollupStore> store(new RollupStore());
+    if (!store->open(directory, false, retention_ns)) {
+        return false;
+    }
+    store_ = std::move(store);
+    return true;
+}
+
+// Store a bandwidth sample together with the raw byte counters
+bool NetworkMonitor::storeBandwidth(const InterfaceStats& current, double download_bps, double upload_bps) {
+    std::lock_guard<std::mutex> lock(store_mutex_);
+    if (!store_) {
+        return false;
+    }
+    uint64_t counters[2] = {current.bytes_received, current.bytes_sent};
+    double rates[2] = {download_bps, upload_bps};
+    uint32_t id = store_->seriesId(SeriesKind::BANDWIDTH, current.interface_name);
+    return store_->append(id, wallClockNs(), counters, rates);
+}
+
+// Store a latency measurement
+bool NetworkMonitor::storeLatency(const LatencyResult& result) {
+    std::lock_guard<std::mutex> lock(store_mutex_);
+    if (!store_) {
+        return false;
+    }
+    uint64_t success = result.success ? 1 : 0;
+    uint32_t id = store_->seriesId(SeriesKind::LATENCY, result.host);
+    return store_->append(id, wallClockNs(), &success, &result.rtt_ms);
+}
+
+// Store packet loss statistics
+bool NetworkMonitor::storePacketLoss(const std::string& host, const PacketLossStats& stats) {
+    std::lock_guard<std::mutex> lock(store_mutex_);
+    if (!store_) {
+        return false;
+    }
+    uint64_t counts[2] = {static_cast<uint64_t>(stats.packets_sent),
+                          static_cast<uint64_t>(stats.packets_received)};
+    double values[6] = {stats.loss_percentage, stats.min_rtt, stats.max_rtt,
+                        stats.avg_rtt, stats.jitter, stats.p99_rtt};
+    uint32_t id = store_->seriesId(SeriesKind::PACKET_LOSS, host);
+    return store_->append(id, wallClockNs(), counts, values);
+}
+
+// Store connection counts
+bool NetworkMonitor::storeConnections(int tcp_total, int tcp_established, int udp_total) {
+    std::lock_guard<std::mutex> lock(store_mutex_);
+    if (!store_) {
+        return false;
+    }
+    uint64_t counts[3] = {static_cast<uint64_t>(tcp_total), static_cast<uint64_t>(tcp_established),
+                          static_cast<uint64_t>(udp_total)};
+    uint32_t id = store_->seriesId(SeriesKind::CONNECTIONS, "");
+    return store_->append(id, wallClockNs(), counts, nullptr);
+}
+
+// Export stored rows through the CSV writer so the output matches --log files.
+// The range is read an hour (or 1000 buckets) at a time and each chunk is
+// merged across series in timestamp order, so memory stays bounded for long
+// captures. Rollup rows are exported as their per-bucket averages.
+bool NetworkMonitor::exportStoreToCSV(const std::string& directory, const std::string& filename,
+                                      SeriesKind kind, const std::vector<std::string>& names,
+                                      int64_t from_ns, int64_t to_ns, int64_t resolution_ns) {
+    RollupStore store;
+    if (!store.open(directory, true)) {
+        return false;
+    }
     
-    if (!readInterfaceStats(interface, stats2)) {
-        std::cerr << "Error: Could not read interface stats" << std::endl;
-        return;
+    std::vector<std::string> series;
+    for (const auto& info : store.raw().series()) {
+        if (info.kind == kind && (names.empty() ||
+                                  std::find(names.begin(), names.end(), info.name) != names.end())) {
+            series.push_back(info.name);
+        }
+    }
+    
+    int64_t first_ns, last_ns;
+    if (series.empty() || !store.timeRange(first_ns, last_ns)) {
+        std::cerr << "Error: No " << seriesKindName(kind) << " series in " << directory << std::endl;
+        return false;
     }
     
-    double download_bps, upload_bps;
-    calculateBandwidth(stats1, stats2, download_bps, upload_bps);
+    // Pick the tier for the whole requested range, then read only what it holds
+    int tier = store.selectTier(std::max(from_ns, first_ns), resolution_ns);
+    if (!store.tierTimeRange(tier, first_ns, last_ns)) {
+        std::cerr << "Error: No " << RollupStore::tierName(tier) << " rows in " << directory << std::endl;
+        return false;
+    }
+    from_ns = std::max(from_ns, first_ns);
+    to_ns = std::min(to_ns, last_ns);
+    
+    LogRecord::Kind record_kind = LogRecord::BANDWIDTH;
+    switch (kind) {
+        case SeriesKind::BANDWIDTH:   record_kind = LogRecord::BANDWIDTH; break;
+        case SeriesKind::LATENCY:     record_kind = LogRecord::LATENCY; break;
+        case SeriesKind::PACKET_LOSS: record_kind = LogRecord::PACKET_LOSS; break;
+        case SeriesKind::CONNECTIONS: record_kind = LogRecord::CONNECTIONS; break;
+    }
+    int u64_columns, f64_columns;
+    seriesColumns(kind, u64_columns, f64_columns);
     
-    if (logBandwidthToCSV(filename, interface, download_bps, upload_bps)) {
-        std::cout << "Bandwidth data logged to: " << filename << std::endl;
+    CsvLogger* logger = csvLogger(filename, record_kind);
+    if (logger == nullptr) {
+        return false;
     }
+    
+    const int64_t chunk_ns = std::max<int64_t>(3600LL * 1000000000LL, 1000 * RollupStore::tierResolution(tier));
+    std::vector<std::pair<RollupRow, size_t> > rows;
+    std::vector<int64_t> previous_ns(series.size(), 0);
+    size_t exported = 0;
+    
+    for (int64_t chunk = from_ns; chunk <= to_ns; chunk += chunk_ns) {
+        int64_t chunk_end = std::min(to_ns, chunk + chunk_ns - 1);
+        rows.clear();
+        for (size_t s = 0; s < series.size(); s++) {
+            store.query(kind, series[s], chunk, chunk_end, resolution_ns, [&](const RollupRow& row) {
+                // Buckets that start before the chunk were exported with the previous one
+                if (row.timestamp_ns >= chunk) {
+                    rows.push_back(std::make_pair(row, s));
+                }
+            });
+        }
+        std::stable_sort(rows.begin(), rows.end(),
+                         [](const std::pair<RollupRow, size_t>& a, const std::pair<RollupRow, size_t>& b) {
+                             return a.first.timestamp_ns < b.first.timestamp_ns;
+                         });
+        
+        for (const auto& entry : rows) {
+            const RollupRow& row = entry.first;
+            LogRecord record;
+            beginRecord(record, record_kind, series[entry.second]);
+            record.wall_time = static_cast<time_t>(row.timestamp_ns / 1000000000LL);
+            for (int c = 0; c < row.columns; c++) {
+                if (c < u64_columns) {
+                    record.counts[c] = static_cast<long long>(std::llround(row.avg[c]));
+                } else if (c - u64_columns < 8) {
+                    record.values[c - u64_columns] = row.avg[c];
+                }
+            }
+            if (record_kind == LogRecord::BANDWIDTH) {
+                // Raw rows: time since the series' previous row; rollups: the bucket width
+                int64_t& previous = previous_ns[entry.second];
+                int64_t interval_ns = tier > 0 ? RollupStore::tierResolution(tier)
+                                               : (previous != 0 ? row.timestamp_ns - previous : 0);
+                record.values[2] = interval_ns / 1e9;
+                previous = row.timestamp_ns;
+            }
+            logger->push(record);
+            exported++;
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(csv_mutex_);
+        csv_logger_generation.fetch_add(1, std::memory_order_acq_rel);
+        csv_loggers_.erase(filename);
+    }
+    std::cout << "Exported " << exported << " " << seriesKindName(kind) << " rows ("
+              << RollupStore::tierName(tier) << ") to " << filename << std::endl;
+    return true;
 }
-
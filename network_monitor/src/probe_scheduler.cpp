@@ -0,0 +1,403 @@
+#include "probe_scheduler.h"
+#include "shutdown.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+namespace {
+
+// Number of wheel slots (power of two); one slot per tick
+const size_t kWheelSlots = 4096;
+
+void resetStats(ProbeTargetStats& stats) {
+    stats.sent = 0;
+    stats.received = 0;
+    stats.lost = 0;
+    stats.late = 0;
+    stats.duplicates = 0;
+    stats.rtt.reset();
+    stats.clock_source = TimestampSource::HARDWARE;
+}
+
+// Absolute CLOCK_MONOTONIC time for timerfd (steady_clock uses that clock)
+struct timespec monotonicTime(std::chrono::steady_clock::time_point time) {
+    long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    struct timespec ts;
+    ts.tv_sec = ns / 1000000000LL;
+    ts.tv_nsec = ns % 1000000000LL;
+    if (ts.tv_sec == 0 && ts.tv_nsec == 0) {
+        ts.tv_nsec = 1;     // Zero would disarm the timer
+    }
+    return ts;
+}
+
+void addRtt(ProbeTargetStats& stats, double rtt_ms, TimestampSource source) {
+    if (source < stats.clock_source) {
+        stats.clock_source = source;
+    }
+    stats.received++;
+    stats.rtt.record(rtt_ms);
+}
+
+} // namespace
+
+// Read a target list file
+bool loadProbeTargets(const std::string& path, int default_interval_ms,
+                      std::vector<ProbeTargetConfig>& targets) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        ProbeTargetConfig target;
+        if (!(iss >> target.host) || target.host[0] == '#') {
+            continue;
+        }
+        if (!(iss >> target.interval_ms) || target.interval_ms <= 0) {
+            target.interval_ms = default_interval_ms;
+        }
+        targets.push_back(target);
+    }
+    return true;
+}
+
+ProbeScheduler::ProbeScheduler(int timeout_ms, int tick_ms)
+    : wheel_(kWheelSlots), occupied_(kWheelSlots / 64, 0), tx_keys_(kTxKeyRing), wheel_position_(0),
+      tick_ms_(tick_ms > 0 ? tick_ms : 1),
+      id_base_(static_cast<uint16_t>(getpid() & 0xFFFF)),
+      wake_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      stop_requested_(false) {
+    timeout_ticks_ = static_cast<uint32_t>((timeout_ms + tick_ms_ - 1) / tick_ms_);
+    if (timeout_ticks_ == 0) {
+        timeout_ticks_ = 1;
+    }
+}
+
+ProbeScheduler::~ProbeScheduler() {
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+    }
+}
+
+void ProbeScheduler::stop() {
+    stop_requested_ = true;
+    if (wake_fd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(wake_fd_, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+// Register a target; each one gets its own ICMP identifier
+bool ProbeScheduler::addTarget(const std::string& name, const struct sockaddr_in& addr, int interval_ms) {
+    Target target;
+    target.name = name;
+    target.addr = addr;
+    target.icmp_id = static_cast<uint16_t>(id_base_ + targets_.size());
+    target.next_sequence = 1;
+    target.interval_ticks = static_cast<uint32_t>((interval_ms + tick_ms_ - 1) / tick_ms_);
+    if (target.interval_ticks == 0) {
+        target.interval_ticks = 1;
+    }
+
+    // Probes sent within one timeout must not share a ring slot
+    size_t in_flight = timeout_ticks_ / target.interval_ticks + 1;
+    if (in_flight > kMaxProbeRing) {
+        return false;
+    }
+    size_t ring_size = kProbeRing;
+    while (ring_size < in_flight) {
+        ring_size *= 2;
+    }
+    ProbeSlot free_slot;
+    free_slot.sequence = 0;
+    free_slot.state = FREE;
+    target.ring.assign(ring_size, free_slot);
+    target.ring_mask = static_cast<uint16_t>(ring_size - 1);
+
+    resetStats(target.window);
+    resetStats(target.total);
+    targets_.push_back(target);
+    return true;
+}
+
+// Put an event on the wheel `ticks` ticks from now
+void ProbeScheduler::schedule(uint32_t target, EventKind kind, uint16_t sequence, uint32_t ticks) {
+    if (ticks == 0) {
+        ticks = 1;
+    }
+    WheelEntry entry;
+    entry.target = target;
+    entry.kind = kind;
+    entry.sequence = sequence;
+    entry.rounds = (ticks - 1) / kWheelSlots;
+    size_t slot = (wheel_position_ + ticks) & (kWheelSlots - 1);
+    wheel_[slot].push_back(entry);
+    occupied_[slot / 64] |= 1ULL << (slot % 64);
+}
+
+// Move the wheel forward by one tick and fire everything due
+void ProbeScheduler::advanceTick() {
+    wheel_position_ = (wheel_position_ + 1) & (kWheelSlots - 1);
+
+    // Swap the slot out so events scheduled while firing land in a fresh list
+    scratch_.swap(wheel_[wheel_position_]);
+    occupied_[wheel_position_ / 64] &= ~(1ULL << (wheel_position_ % 64));
+    for (size_t i = 0; i < scratch_.size(); i++) {
+        WheelEntry& entry = scratch_[i];
+        if (entry.rounds > 0) {
+            entry.rounds--;
+            wheel_[wheel_position_].push_back(entry);
+            occupied_[wheel_position_ / 64] |= 1ULL << (wheel_position_ % 64);
+        } else if (entry.kind == SEND_PROBE) {
+            sendProbe(entry.target);
+        } else {
+            expireProbe(entry.target, entry.sequence);
+        }
+    }
+    scratch_.clear();
+}
+
+// Move the wheel forward by several ticks, visiting only occupied slots
+void ProbeScheduler::advanceTicks(unsigned long long ticks) {
+    while (ticks > 0) {
+        uint32_t distance;
+        if (!nextOccupiedTick(distance) || distance > ticks) {
+            wheel_position_ = (wheel_position_ + ticks) & (kWheelSlots - 1);
+            return;
+        }
+        wheel_position_ = (wheel_position_ + distance - 1) & (kWheelSlots - 1);
+        advanceTick();
+        ticks -= distance;
+    }
+}
+
+// Ticks from now to the next wheel slot holding an event, false if none.
+// Scans the occupancy bitmap a word at a time.
+bool ProbeScheduler::nextOccupiedTick(uint32_t& ticks) const {
+    size_t distance = 1;
+    while (distance <= kWheelSlots) {
+        size_t slot = (wheel_position_ + distance) & (kWheelSlots - 1);
+        uint64_t bits = occupied_[slot / 64] >> (slot % 64);
+        if (bits != 0) {
+            distance += static_cast<size_t>(__builtin_ctzll(bits));
+            if (distance > kWheelSlots) {
+                return false;
+            }
+            ticks = static_cast<uint32_t>(distance);
+            return true;
+        }
+        distance += 64 - slot % 64;
+    }
+    return false;
+}
+
+// Count a probe as lost
+void ProbeScheduler::loseSlot(Target& target, ProbeSlot& slot) {
+    slot.state = TIMED_OUT;
+    target.window.lost++;
+    target.total.lost++;
+}
+
+// Send the next probe to a target and schedule its timeout and successor
+void ProbeScheduler::sendProbe(uint32_t index) {
+    Target& target = targets_[index];
+    uint16_t sequence = target.next_sequence++;
+    ProbeSlot& slot = target.ring[sequence & target.ring_mask];
+
+    // The ring wrapped onto a probe that is still waiting: it is lost
+    if (slot.state == IN_FLIGHT) {
+        loseSlot(target, slot);
+    }
+
+    slot.sequence = sequence;
+    uint32_t tx_key = 0;
+    if (socket_.sendEcho(target.addr, target.icmp_id, sequence, &slot.sent, &tx_key)) {
+        slot.state = IN_FLIGHT;
+        tx_keys_[tx_key & (kTxKeyRing - 1)] = std::make_pair(index, sequence);
+        target.window.sent++;
+        target.total.sent++;
+        schedule(index, PROBE_TIMEOUT, sequence, timeout_ticks_);
+    } else {
+        slot.state = FREE;
+    }
+
+    schedule(index, SEND_PROBE, 0, target.interval_ticks);
+}
+
+// Timeout event for one probe
+void ProbeScheduler::expireProbe(uint32_t index, uint16_t sequence) {
+    Target& target = targets_[index];
+    ProbeSlot& slot = target.ring[sequence & target.ring_mask];
+    if (slot.sequence == sequence && slot.state == IN_FLIGHT) {
+        loseSlot(target, slot);
+    }
+}
+
+// Attach kernel send timestamps from the error queue to their probes
+void ProbeScheduler::handleTxTimestamps() {
+    uint32_t tx_key;
+    PacketTimestamps stamps;
+    while (socket_.receiveTxTimestamp(tx_key, stamps) > 0) {
+        const std::pair<uint32_t, uint16_t>& owner = tx_keys_[tx_key & (kTxKeyRing - 1)];
+        if (owner.first >= targets_.size()) {
+            continue;
+        }
+        Target& target = targets_[owner.first];
+        ProbeSlot& slot = target.ring[owner.second & target.ring_mask];
+        if (slot.sequence == owner.second && slot.state == IN_FLIGHT) {
+            mergeTxTimestamps(slot.sent, stamps);
+        }
+    }
+}
+
+// Drain the socket and match replies to targets by ICMP id and sequence
+void ProbeScheduler::handleReplies() {
+    IcmpEchoReply reply;
+    while (socket_.receiveEcho(reply) > 0) {
+        uint32_t index = static_cast<uint16_t>(reply.id - id_base_);
+        if (index >= targets_.size()) {
+            continue;
+        }
+        Target& target = targets_[index];
+        if (reply.from.sin_addr.s_addr != target.addr.sin_addr.s_addr) {
+            continue;
+        }
+
+        ProbeSlot& slot = target.ring[reply.sequence & target.ring_mask];
+        if (slot.sequence != reply.sequence || slot.state == TIMED_OUT) {
+            target.window.late++;
+            target.total.late++;
+        } else if (slot.state == REPLIED) {
+            target.window.duplicates++;
+            target.total.duplicates++;
+        } else if (slot.state == IN_FLIGHT) {
+            slot.state = REPLIED;
+            TimestampSource source;
+            double rtt_ms = computeRtt(slot.sent, reply.timestamps, source);
+            addRtt(target.window, rtt_ms, source);
+            addRtt(target.total, rtt_ms, source);
+        }
+    }
+}
+
+// Main probe loop
+bool ProbeScheduler::run(int duration_ms, int report_interval_ms, const ReportHandler& on_report) {
+    if (!socket_.open(true)) {
+        return false;
+    }
+    socket_.enableTimestamps();
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epoll_fd < 0 || timer_fd < 0 || wake_fd_ < 0) {
+        if (epoll_fd >= 0) close(epoll_fd);
+        if (timer_fd >= 0) close(timer_fd);
+        return false;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = socket_.fd();
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket_.fd(), &event);
+    event.data.fd = timer_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event);
+    event.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd_, &event);
+
+    for (size_t slot = 0; slot < wheel_.size(); slot++) {
+        wheel_[slot].clear();
+    }
+
+    // Spread first probes over each target's interval to avoid bursts
+    for (size_t i = 0; i < targets_.size(); i++) {
+        uint32_t offset = static_cast<uint32_t>((i * 2654435761u) % targets_[i].interval_ticks);
+        schedule(static_cast<uint32_t>(i), SEND_PROBE, 0, offset + 1);
+    }
+
+    // Tick n of the wheel is due at start + n * tick_ms_
+    const std::chrono::milliseconds tick(tick_ms_);
+    auto start = std::chrono::steady_clock::now();
+    auto next_report = start + std::chrono::milliseconds(report_interval_ms);
+    unsigned long long ticks_done = 0;
+
+    while (!stop_requested_ && !shutdownRequested()) {
+        // Sleep until the next occupied slot, report or end of the run
+        auto wake = std::chrono::steady_clock::time_point::max();
+        uint32_t ticks_ahead;
+        if (nextOccupiedTick(ticks_ahead)) {
+            wake = start + tick * (ticks_done + ticks_ahead);
+        }
+        if (report_interval_ms > 0) {
+            wake = std::min(wake, next_report);
+        }
+        if (duration_ms > 0) {
+            wake = std::min(wake, start + std::chrono::milliseconds(duration_ms));
+        }
+        struct itimerspec spec;
+        memset(&spec, 0, sizeof(spec));
+        if (wake != std::chrono::steady_clock::time_point::max()) {
+            spec.it_value = monotonicTime(wake);
+        }
+        timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+
+        struct epoll_event events[3];
+        int ready = epoll_wait(epoll_fd, events, 3, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for (int i = 0; i < ready; i++) {
+            if (events[i].data.fd == socket_.fd()) {
+                handleTxTimestamps();
+                handleReplies();
+            } else {
+                uint64_t count;
+                ssize_t drained = read(events[i].data.fd, &count, sizeof(count));
+                (void)drained;
+            }
+        }
+
+        // Fire every slot that has come due, including ones slept through.
+        // After a stall longer than a wheel revolution (suspend, SIGSTOP)
+        // only one revolution is replayed; later events are delayed instead.
+        auto now = std::chrono::steady_clock::now();
+        unsigned long long due_ticks = static_cast<unsigned long long>((now - start) / tick);
+        if (due_ticks > ticks_done + kWheelSlots) {
+            ticks_done = due_ticks - kWheelSlots;
+        }
+        if (due_ticks > ticks_done) {
+            advanceTicks(due_ticks - ticks_done);
+            ticks_done = due_ticks;
+        }
+
+        if (report_interval_ms > 0 && now >= next_report) {
+            on_report(*this);
+            for (size_t i = 0; i < targets_.size(); i++) {
+                resetStats(targets_[i].window);
+            }
+            next_report += std::chrono::milliseconds(report_interval_ms);
+        }
+        if (duration_ms > 0 && now - start >= std::chrono::milliseconds(duration_ms)) {
+            break;
+        }
+    }
+
+    close(timer_fd);
+    close(epoll_fd);
+    socket_.close();
+    return true;
+}
@@ -0,0 +1,90 @@
+#include "probe_session.h"
+#include "resolver_cache.h"
+#include <iostream>
+#include <cstring>
+#include <unistd.h>
+#include <errno.h>
+
+ProbeSession::ProbeSession(const std::string& host, ResolverCache& resolver)
+    : host_(host), resolver_(resolver),
+      id_(static_cast<uint16_t>(getpid() & 0xFFFF)), next_sequence_(1) {
+    memset(&dest_addr_, 0, sizeof(dest_addr_));
+}
+
+ProbeSession::~ProbeSession() {
+}
+
+// Resolve the destination and create the socket
+bool ProbeSession::open() {
+    if (!resolver_.resolve(host_, &dest_addr_)) {
+        std::cerr << "Error: Could not resolve hostname: " << host_ << std::endl;
+        return false;
+    }
+
+    // Create raw socket with kernel timestamps where available
+    if (!socket_.open(false)) {
+        std::cerr << "Error: Could not create raw socket. Root privileges required." << std::endl;
+        return false;
+    }
+    socket_.enableTimestamps();
+    return true;
+}
+
+// Send one echo request and wait for the matching reply
+ProbeSample ProbeSession::measure(int timeout_ms) {
+    ProbeSample sample;
+    sample.success = false;
+    sample.rtt_ms = 0.0;
+    sample.clock_source = TimestampSource::USERSPACE;
+
+    // Pick up DNS changes; the cache keeps serving the old address on failure
+    resolver_.resolve(host_, &dest_addr_);
+
+    // Sequence numbers keep late replies to earlier probes from matching
+    uint16_t sequence = next_sequence_++;
+    PacketTimestamps sent;
+    uint32_t tx_key = 0;
+    if (!socket_.sendEcho(dest_addr_, id_, sequence, &sent, &tx_key)) {
+        std::cerr << "Error: Failed to send ICMP packet: " << strerror(errno) << std::endl;
+        return sample;
+    }
+
+    // Receive ICMP echo reply, ignoring replies meant for other probes
+    auto deadline = sent.user + std::chrono::milliseconds(timeout_ms);
+    IcmpEchoReply reply;
+    while (true) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        int received = 0;
+        if (remaining > 0) {
+            socket_.setReceiveTimeout(static_cast<int>(remaining));
+            received = socket_.receiveEcho(reply);
+        }
+
+        if (received == 0) {
+            std::cerr << "Error: Timeout waiting for ICMP reply from " << host_ << std::endl;
+            return sample;
+        }
+        if (received < 0) {
+            std::cerr << "Error: Failed to receive ICMP reply: " << strerror(errno) << std::endl;
+            return sample;
+        }
+        if (reply.id == id_ && reply.sequence == sequence &&
+            reply.from.sin_addr.s_addr == dest_addr_.sin_addr.s_addr) {
+            break;
+        }
+    }
+
+    // Pick up the kernel send timestamp if one was reported
+    uint32_t key;
+    PacketTimestamps tx_stamps;
+    while (socket_.receiveTxTimestamp(key, tx_stamps) > 0) {
+        if (key == tx_key) {
+            mergeTxTimestamps(sent, tx_stamps);
+        }
+    }
+
+    sample.rtt_ms = computeRtt(sent, reply.timestamps, sample.clock_source);
+    sample.success = true;
+    return sample;
+}
@@ -0,0 +1,151 @@
+#include "proc_net_dev_reader.h"
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace {
+
+// Number of counters per row: 8 RX fields followed by 8 TX fields
+const int kProcNetDevFields = 16;
+
+// Initial read buffer size, grown on demand
+const size_t kInitialBufferSize = 16 * 1024;
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t';
+}
+
+// Parse an unsigned decimal number, advancing pos. Returns false at end of line.
+inline bool parseNumber(const char*& pos, const char* end, unsigned long long& value) {
+    while (pos < end && isSpace(*pos)) {
+        ++pos;
+    }
+    if (pos >= end || *pos < '0' || *pos > '9') {
+        return false;
+    }
+
+    unsigned long long result = 0;
+    while (pos < end && *pos >= '0' && *pos <= '9') {
+        result = result * 10 + static_cast<unsigned long long>(*pos - '0');
+        ++pos;
+    }
+    value = result;
+    return true;
+}
+
+} // namespace
+
+ProcNetDevReader::ProcNetDevReader(const char* path)
+    : path_(path), fd_(-1), buffer_(kInitialBufferSize) {
+    fd_ = open(path, O_RDONLY | O_CLOEXEC);
+}
+
+ProcNetDevReader::~ProcNetDevReader() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+// Read the whole file into buffer_, growing it until the content fits
+bool ProcNetDevReader::readFile(size_t& length) {
+    if (fd_ < 0) {
+        fd_ = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0) {
+            return false;
+        }
+    }
+
+    length = 0;
+    while (true) {
+        if (length == buffer_.size()) {
+            buffer_.resize(buffer_.size() * 2);
+        }
+
+        ssize_t n = pread(fd_, &buffer_[length], buffer_.size() - length,
+                          static_cast<off_t>(length));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (n == 0) {
+            return true;
+        }
+        length += static_cast<size_t>(n);
+    }
+}
+
+// Take a snapshot of /proc/net/dev
+bool ProcNetDevReader::sample() {
+    size_t length = 0;
+    if (!readFile(length)) {
+        return false;
+    }
+
+    auto current_time = std::chrono::steady_clock::now();
+    beginSample();
+
+    const char* pos = buffer_.data();
+    const char* end = pos + length;
+
+    // Skip the two header lines
+    for (int header = 0; header < 2 && pos < end; header++) {
+        const char* newline = static_cast<const char*>(memchr(pos, '\n', end - pos));
+        pos = newline ? newline + 1 : end;
+    }
+
+    size_t position = 0;
+    while (pos < end) {
+        const char* newline = static_cast<const char*>(memchr(pos, '\n', end - pos));
+        const char* line_end = newline ? newline : end;
+
+        // Interface name is right-aligned and terminated by a colon
+        const char* name = pos;
+        while (name < line_end && isSpace(*name)) {
+            ++name;
+        }
+        const char* colon = static_cast<const char*>(memchr(name, ':', line_end - name));
+
+        if (colon != nullptr && colon > name) {
+            unsigned long long fields[kProcNetDevFields];
+            const char* cursor = colon + 1;
+            int parsed = 0;
+            while (parsed < kProcNetDevFields && parseNumber(cursor, line_end, fields[parsed])) {
+                parsed++;
+            }
+
+            if (parsed == kProcNetDevFields) {
+                size_t index = findOrInsert(name, static_cast<size_t>(colon - name), position);
+                InterfaceStats& stat = row(index);
+
+                // Format: bytes packets errs drop fifo frame compressed multicast (RX, then TX)
+                stat.bytes_received = fields[0];
+                stat.packets_received = fields[1];
+                stat.receive_errors = fields[2];
+                stat.receive_dropped = fields[3];
+                stat.receive_fifo_errors = fields[4];
+                stat.receive_frame_errors = fields[5];
+                stat.receive_compressed = fields[6];
+                stat.receive_multicast = fields[7];
+                stat.bytes_sent = fields[8];
+                stat.packets_sent = fields[9];
+                stat.transmit_errors = fields[10];
+                stat.transmit_dropped = fields[11];
+                stat.transmit_fifo_errors = fields[12];
+                stat.transmit_collisions = fields[13];
+                stat.transmit_carrier_errors = fields[14];
+                stat.transmit_compressed = fields[15];
+                stat.timestamp = current_time;
+                markPresent(index);
+                position++;
+            }
+        }
+
+        pos = newline ? newline + 1 : end;
+    }
+
+    commitSample();
+    return true;
+}
@@ -0,0 +1,272 @@
+#include "proc_net_parser.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+const unsigned ProcNetTableParser::kMaxThreads;
+const size_t ProcNetTableParser::kMinChunkBytes;
+
+namespace {
+
+// Initial read buffer size, doubled until a table fits
+const size_t kInitialBufferSize = 64 * 1024;
+
+inline int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+// Skip whitespace, then return the start of the next token
+inline const char* nextToken(const char* pos, const char* end) {
+    while (pos < end && *pos != ' ') {
+        ++pos;
+    }
+    while (pos < end && *pos == ' ') {
+        ++pos;
+    }
+    return pos;
+}
+
+const char* const kTcpStateNames[] = {
+    nullptr, "ESTABLISHED", "SYN_SENT", "SYN_RECV", "FIN_WAIT1", "FIN_WAIT2", "TIME_WAIT",
+    "CLOSE", "CLOSE_WAIT", "LAST_ACK", "LISTEN", "CLOSING", "NEW_SYN_RECV"
+};
+
+} // namespace
+
+const char* tcpStateName(int state) {
+    if (state <= 0 || state >= static_cast<int>(sizeof(kTcpStateNames) / sizeof(kTcpStateNames[0]))) {
+        return nullptr;
+    }
+    return kTcpStateNames[state];
+}
+
+void SocketTableCounts::clear() {
+    rows = 0;
+    memset(states, 0, sizeof(states));
+}
+
+void SocketTableCounts::add(const SocketTableCounts& other) {
+    rows += other.rows;
+    for (int i = 0; i < kTcpStateSlots; i++) {
+        states[i] += other.states[i];
+    }
+}
+
+ProcNetTableParser::ProcNetTableParser(unsigned threads)
+    : threads_(threads), buffer_(kInitialBufferSize), chunks_(0), want_inodes_(false),
+      round_(0), pending_(0), stopping_(false) {
+    if (threads_ == 0) {
+        threads_ = std::thread::hardware_concurrency();
+    }
+    threads_ = std::max(1u, std::min(threads_, kMaxThreads));
+}
+
+ProcNetTableParser::~ProcNetTableParser() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    start_.notify_all();
+    for (size_t i = 0; i < workers_.size(); i++) {
+        workers_[i].join();
+    }
+}
+
+// Wait for each round and parse this worker's chunk, if the round has one
+void ProcNetTableParser::workerLoop(size_t worker) {
+    unsigned long long seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        start_.wait(lock, [&] { return stopping_ || round_ != seen; });
+        if (stopping_) {
+            return;
+        }
+        seen = round_;
+        size_t chunk = worker + 1;
+        if (chunk >= chunks_) {
+            continue;
+        }
+
+        lock.unlock();
+        parseLines(bounds_[chunk], bounds_[chunk + 1], partial_[chunk],
+                   want_inodes_ ? &chunk_inodes_[chunk] : nullptr);
+        lock.lock();
+        if (--pending_ == 0) {
+            done_.notify_one();
+        }
+    }
+}
+
+// Count rows by state. A row is
+//   "  sl: LOCAL:PORT REMOTE:PORT ST ..."
+// where both addresses have the same width (8 hex digits for IPv4, 32 for
+// IPv6), so the state column sits at a fixed offset from the local address.
+void ProcNetTableParser::parseLines(const char* begin, const char* end, SocketTableCounts& counts,
+                                    std::vector<uint64_t>* inodes) {
+    uint64_t rows = 0;
+    uint64_t states[kTcpStateSlots] = {0};
+
+    const char* pos = begin;
+    while (pos < end) {
+        const char* line_end = static_cast<const char*>(memchr(pos, '\n', end - pos));
+        if (line_end == nullptr) {
+            line_end = end;
+        }
+
+        const char* colon = static_cast<const char*>(memchr(pos, ':', line_end - pos));
+        if (colon != nullptr) {
+            const char* local = colon + 1;
+            while (local < line_end && *local == ' ') {
+                ++local;
+            }
+            const char* separator = local;
+            while (separator < line_end && *separator != ':') {
+                ++separator;
+            }
+
+            // "ADDR:PORT " twice, then the two-digit state
+            size_t field = static_cast<size_t>(separator - local) + 5;
+            const char* state = local + 2 * (field + 1);
+            if (state + 2 <= line_end && state[-1] == ' ') {
+                int high = hexValue(state[0]);
+                int low = hexValue(state[1]);
+                if (high >= 0 && low >= 0) {
+                    rows++;
+                    states[(high * 16 + low) & (kTcpStateSlots - 1)]++;
+
+                    if (inodes != nullptr) {
+                        // st tx:rx tr:when retrnsmt uid timeout inode
+                        const char* field_pos = state;
+                        for (int i = 0; i < 6; i++) {
+                            field_pos = nextToken(field_pos, line_end);
+                        }
+                        uint64_t inode = 0;
+                        while (field_pos < line_end && *field_pos >= '0' && *field_pos <= '9') {
+                            inode = inode * 10 + static_cast<uint64_t>(*field_pos - '0');
+                            ++field_pos;
+                        }
+                        inodes->push_back(inode);
+                    }
+                }
+            }
+        }
+        pos = line_end < end ? line_end + 1 : end;
+    }
+
+    counts.rows += rows;
+    for (int i = 0; i < kTcpStateSlots; i++) {
+        counts.states[i] += states[i];
+    }
+}
+
+// Split the rows at line boundaries and parse the chunks on the workers
+void ProcNetTableParser::parseBuffer(const char* data, size_t length, SocketTableCounts& counts,
+                                     std::vector<uint64_t>* inodes) {
+    const char* end = data + length;
+    const char* header_end = static_cast<const char*>(memchr(data, '\n', length));
+    if (header_end == nullptr) {
+        return;
+    }
+    const char* begin = header_end + 1;
+    size_t rows_length = static_cast<size_t>(end - begin);
+
+    size_t chunks = std::min<size_t>(threads_, rows_length / kMinChunkBytes);
+    if (chunks <= 1) {
+        parseLines(begin, end, counts, inodes);
+        return;
+    }
+
+    // Chunk i covers [bounds_[i], bounds_[i + 1]); each bound is moved past
+    // the next newline so no line is split between two threads
+    bounds_.resize(chunks + 1);
+    bounds_[0] = begin;
+    bounds_[chunks] = end;
+    for (size_t i = 1; i < chunks; i++) {
+        const char* bound = begin + rows_length / chunks * i;
+        bound = std::max(bound, bounds_[i - 1]);
+        const char* newline = static_cast<const char*>(memchr(bound, '\n', end - bound));
+        bounds_[i] = newline == nullptr ? end : newline + 1;
+    }
+
+    partial_.assign(chunks, SocketTableCounts());
+    if (inodes != nullptr) {
+        if (chunk_inodes_.size() < chunks) {
+            chunk_inodes_.resize(chunks);
+        }
+        for (size_t i = 0; i < chunks; i++) {
+            chunk_inodes_[i].clear();
+        }
+    }
+
+    if (workers_.empty()) {
+        for (size_t w = 0; w + 1 < threads_; w++) {
+            workers_.push_back(std::thread(&ProcNetTableParser::workerLoop, this, w));
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        chunks_ = chunks;
+        want_inodes_ = inodes != nullptr;
+        pending_ = chunks - 1;
+        round_++;
+    }
+    start_.notify_all();
+
+    parseLines(bounds_[0], bounds_[1], partial_[0], inodes != nullptr ? &chunk_inodes_[0] : nullptr);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [&] { return pending_ == 0; });
+    }
+    for (size_t i = 0; i < chunks; i++) {
+        counts.add(partial_[i]);
+        if (inodes != nullptr) {
+            inodes->insert(inodes->end(), chunk_inodes_[i].begin(), chunk_inodes_[i].end());
+        }
+    }
+}
+
+// Read a whole table into buffer_ and parse it
+bool ProcNetTableParser::parseFile(const char* path, SocketTableCounts& counts,
+                                   std::vector<uint64_t>* inodes) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    size_t length = 0;
+    while (true) {
+        if (length == buffer_.size()) {
+            buffer_.resize(buffer_.size() * 2);
+        }
+        ssize_t n = read(fd, &buffer_[length], buffer_.size() - length);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        length += static_cast<size_t>(n);
+    }
+    close(fd);
+
+    parseBuffer(buffer_.data(), length, counts, inodes);
+    return true;
+}
@@ -0,0 +1,122 @@
+#include "resolver_cache.h"
+#include <cstring>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+
+ResolverCache::ResolverCache(int ttl_seconds, int negative_ttl_seconds)
+    : ttl_(ttl_seconds), negative_ttl_(negative_ttl_seconds), stopping_(false) {
+}
+
+ResolverCache::~ResolverCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    refresh_cv_.notify_all();
+    if (refresh_thread_.joinable()) {
+        refresh_thread_.join();
+    }
+}
+
+// Blocking getaddrinfo() lookup of the first IPv4 address
+bool ResolverCache::lookup(const std::string& hostname, struct in_addr& address) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_RAW;
+
+    struct addrinfo* results = nullptr;
+    if (getaddrinfo(hostname.c_str(), nullptr, &hints, &results) != 0 || results == nullptr) {
+        return false;
+    }
+
+    address = ((struct sockaddr_in*)results->ai_addr)->sin_addr;
+    freeaddrinfo(results);
+    return true;
+}
+
+// Record a lookup result (caller must not hold mutex_)
+void ResolverCache::store(const std::string& hostname, bool valid, const struct in_addr& address) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry& entry = entries_[hostname];
+    entry.refreshing = false;
+
+    // Keep serving the previous address if a refresh fails
+    if (!valid && entry.valid) {
+        entry.expires = std::chrono::steady_clock::now() + negative_ttl_;
+        return;
+    }
+
+    entry.valid = valid;
+    entry.address = address;
+    entry.expires = std::chrono::steady_clock::now() + (valid ? ttl_ : negative_ttl_);
+}
+
+// Background thread that re-resolves stale entries
+void ResolverCache::refreshLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        refresh_cv_.wait(lock, [this] { return stopping_ || !refresh_queue_.empty(); });
+        if (stopping_) {
+            return;
+        }
+
+        std::string hostname = refresh_queue_.front();
+        refresh_queue_.pop_front();
+
+        lock.unlock();
+        struct in_addr address;
+        memset(&address, 0, sizeof(address));
+        bool valid = lookup(hostname, address);
+        store(hostname, valid, address);
+        lock.lock();
+    }
+}
+
+// Resolve a hostname, serving cached results where possible
+bool ResolverCache::resolve(const std::string& hostname, struct sockaddr_in* addr) {
+    addr->sin_family = AF_INET;
+
+    // Try to convert as IP address first
+    if (inet_pton(AF_INET, hostname.c_str(), &addr->sin_addr) == 1) {
+        return true;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(hostname);
+        if (it != entries_.end()) {
+            Entry& entry = it->second;
+            if (now < entry.expires) {
+                addr->sin_addr = entry.address;
+                return entry.valid;
+            }
+
+            // Stale but within the grace period: serve it and refresh in the background
+            if (entry.valid && now < entry.expires + ttl_) {
+                if (!entry.refreshing) {
+                    entry.refreshing = true;
+                    refresh_queue_.push_back(hostname);
+                    if (!refresh_thread_.joinable()) {
+                        refresh_thread_ = std::thread(&ResolverCache::refreshLoop, this);
+                    }
+                    refresh_cv_.notify_one();
+                }
+                addr->sin_addr = entry.address;
+                return true;
+            }
+        }
+    }
+
+    // Unknown or long expired: resolve in the caller's thread
+    struct in_addr address;
+    memset(&address, 0, sizeof(address));
+    bool valid = lookup(hostname, address);
+    store(hostname, valid, address);
+    if (valid) {
+        addr->sin_addr = address;
+    }
+    return valid;
+}
@@ -0,0 +1,267 @@
+#include "result_renderer.h"
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <ctime>
+
+namespace {
+
+// Value with a human readable unit, as in the continuous modes
+void writeRate(std::ostream& out, double bps) {
+    if (bps > 1000000) {
+        out << (bps / 1000000.0) << " Mbps";
+    } else if (bps > 1000) {
+        out << (bps / 1000.0) << " Kbps";
+    } else {
+        out << bps << " bps";
+    }
+}
+
+// JSON string literal
+void writeJsonString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (size_t i = 0; i < text.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c == '"' || c == '\\') {
+            out << '\\' << text[i];
+        } else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        } else {
+            out << text[i];
+        }
+    }
+    out << '"';
+}
+
+// Opening of every JSON object: type and wall-clock timestamp
+void beginJson(std::ostream& out, const char* type) {
+    out << std::fixed << std::setprecision(3);
+    out << "{\"type\":\"" << type << "\",\"timestamp\":" << static_cast<long long>(std::time(nullptr));
+}
+
+} // namespace
+
+bool parseOutputFormat(const std::string& text, OutputFormat& format) {
+    if (text == "console") {
+        format = OutputFormat::CONSOLE;
+    } else if (text == "csv") {
+        format = OutputFormat::CSV;
+    } else if (text == "json") {
+        format = OutputFormat::JSON;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+ResultRenderer* createRenderer(OutputFormat format, NetworkMonitor& monitor) {
+    switch (format) {
+        case OutputFormat::CSV:
+            return new CsvRenderer(monitor, "/dev/stdout");
+        case OutputFormat::JSON:
+            return new JsonRenderer(std::cout);
+        default:
+            return new ConsoleRenderer(std::cout);
+    }
+}
+
+// Console
+
+void ConsoleRenderer::renderBandwidth(const BandwidthResult& result) {
+    if (!result.success) {
+        std::cerr << "Error reading interface: " << result.interface << std::endl;
+        return;
+    }
+    out_ << "Interface: " << result.interface << std::endl;
+    out_ << std::fixed << std::setprecision(2);
+    out_ << "  Download: ";
+    writeRate(out_, result.download_bps);
+    out_ << std::endl << "  Upload:   ";
+    writeRate(out_, result.upload_bps);
+    out_ << std::endl;
+    if (result.from_snapshot) {
+        out_ << "  Averaged over " << result.interval_seconds << " s since the previous run" << std::endl;
+    }
+}
+
+void ConsoleRenderer::renderLatency(const LatencyResult& result) {
+    if (!result.success) {
+        out_ << "Request timed out or failed." << std::endl;
+        return;
+    }
+    out_ << "Reply from " << result.host << ": time="
+         << std::fixed << std::setprecision(2) << result.rtt_ms
+         << " ms (clock: " << timestampSourceName(result.clock_source) << ")" << std::endl;
+}
+
+void ConsoleRenderer::renderPacketLoss(const std::string& host, const PacketLossStats& stats) {
+    (void)host;
+    out_ << std::endl << "Packet Loss Statistics:" << std::endl;
+    out_ << "=========================" << std::endl;
+    out_ << std::fixed << std::setprecision(2);
+    out_ << "Packets sent:     " << stats.packets_sent << std::endl;
+    out_ << "Packets received: " << stats.packets_received << std::endl;
+    out_ << "Packet loss:      " << stats.loss_percentage << "%" << std::endl;
+    if (stats.late_replies > 0 || stats.duplicate_replies > 0) {
+        out_ << "Late replies:     " << stats.late_replies << std::endl;
+        out_ << "Duplicates:       " << stats.duplicate_replies << std::endl;
+    }
+
+    if (stats.packets_received > 0) {
+        out_ << "Min RTT:          " << stats.min_rtt << " ms" << std::endl;
+        out_ << "Max RTT:          " << stats.max_rtt << " ms" << std::endl;
+        out_ << "Avg RTT:          " << stats.avg_rtt << " ms" << std::endl;
+        out_ << "Jitter:           " << stats.jitter << " ms" << std::endl;
+        out_ << "P50/P90 RTT:      " << stats.p50_rtt << " / " << stats.p90_rtt << " ms" << std::endl;
+        out_ << "P99/P99.9 RTT:    " << stats.p99_rtt << " / " << stats.p999_rtt << " ms" << std::endl;
+        out_ << "Clock source:     " << timestampSourceName(stats.clock_source) << std::endl;
+    }
+}
+
+void ConsoleRenderer::renderConnections(const ConnectionStats& stats) {
+    out_ << "Active Network Connections" << std::endl;
+    out_ << "==========================" << std::endl << std::endl;
+
+    out_ << "TCP Connections:" << std::endl;
+    out_ << "  Total: " << stats.tcp_total << std::endl;
+    out_ << "  Established: " << stats.tcp_established << std::endl;
+    out_ << std::endl;
+
+    out_ << "UDP Connections:" << std::endl;
+    out_ << "  Total: " << stats.udp_total << std::endl;
+    out_ << std::endl;
+
+    out_ << "Total Active Connections: " << (stats.tcp_total + stats.udp_total) << std::endl;
+}
+
+// JSON
+
+void JsonRenderer::renderBandwidth(const BandwidthResult& result) {
+    beginJson(out_, "bandwidth");
+    out_ << ",\"interface\":";
+    writeJsonString(out_, result.interface);
+    out_ << ",\"success\":" << (result.success ? "true" : "false");
+    if (result.success) {
+        out_ << ",\"interval_seconds\":" << result.interval_seconds
+             << ",\"from_snapshot\":" << (result.from_snapshot ? "true" : "false")
+             << ",\"download_bps\":" << result.download_bps
+             << ",\"upload_bps\":" << result.upload_bps
+             << ",\"bytes_received\":" << result.current.bytes_received
+             << ",\"bytes_sent\":" << result.current.bytes_sent
+             << ",\"packets_received\":" << result.current.packets_received
+             << ",\"packets_sent\":" << result.current.packets_sent;
+    }
+    out_ << "}" << std::endl;
+}
+
+void JsonRenderer::renderLatency(const LatencyResult& result) {
+    beginJson(out_, "latency");
+    out_ << ",\"host\":";
+    writeJsonString(out_, result.host);
+    out_ << ",\"success\":" << (result.success ? "true" : "false");
+    if (result.success) {
+        out_ << ",\"rtt_ms\":" << result.rtt_ms
+             << ",\"clock\":\"" << timestampSourceName(result.clock_source) << "\"";
+    }
+    out_ << "}" << std::endl;
+}
+
+void JsonRenderer::renderPacketLoss(const std::string& host, const PacketLossStats& stats) {
+    beginJson(out_, "packet_loss");
+    out_ << ",\"host\":";
+    writeJsonString(out_, host);
+    out_ << ",\"packets_sent\":" << stats.packets_sent
+         << ",\"packets_received\":" << stats.packets_received
+         << ",\"loss_percentage\":" << stats.loss_percentage
+         << ",\"late_replies\":" << stats.late_replies
+         << ",\"duplicate_replies\":" << stats.duplicate_replies;
+    if (stats.packets_received > 0) {
+        out_ << ",\"rtt_ms\":{\"min\":" << stats.min_rtt
+             << ",\"max\":" << stats.max_rtt
+             << ",\"avg\":" << stats.avg_rtt
+             << ",\"jitter\":" << stats.jitter
+             << ",\"p50\":" << stats.p50_rtt
+             << ",\"p90\":" << stats.p90_rtt
+             << ",\"p99\":" << stats.p99_rtt
+             << ",\"p999\":" << stats.p999_rtt << "}"
+             << ",\"clock\":\"" << timestampSourceName(stats.clock_source) << "\"";
+    }
+    out_ << "}" << std::endl;
+}
+
+void JsonRenderer::renderConnections(const ConnectionStats& stats) {
+    beginJson(out_, "connections");
+    out_ << ",\"tcp_total\":" << stats.tcp_total
+         << ",\"tcp_established\":" << stats.tcp_established
+         << ",\"udp_total\":" << stats.udp_total
+         << ",\"total\":" << (stats.tcp_total + stats.udp_total) << "}" << std::endl;
+}
+
+// CSV
+
+void CsvRenderer::renderBandwidth(const BandwidthResult& result) {
+    if (result.success) {
+        monitor_.logBandwidthToCSV(filename_, result.interface, result.download_bps, result.upload_bps,
+                                   result.interval_seconds);
+    }
+}
+
+void CsvRenderer::renderLatency(const LatencyResult& result) {
+    monitor_.logLatencyToCSV(filename_, result);
+}
+
+void CsvRenderer::renderPacketLoss(const std::string& host, const PacketLossStats& stats) {
+    monitor_.logPacketLossToCSV(filename_, host, stats);
+}
+
+void CsvRenderer::renderConnections(const ConnectionStats& stats) {
+    monitor_.logConnectionsToCSV(filename_, stats.tcp_total, stats.tcp_established, stats.udp_total);
+}
+
+// Store
+
+void StoreRenderer::renderBandwidth(const BandwidthResult& result) {
+    if (result.success) {
+        monitor_.storeBandwidth(result.current, result.download_bps, result.upload_bps);
+    }
+}
+
+void StoreRenderer::renderLatency(const LatencyResult& result) {
+    monitor_.storeLatency(result);
+}
+
+void StoreRenderer::renderPacketLoss(const std::string& host, const PacketLossStats& stats) {
+    monitor_.storePacketLoss(host, stats);
+}
+
+void StoreRenderer::renderConnections(const ConnectionStats& stats) {
+    monitor_.storeConnections(stats.tcp_total, stats.tcp_established, stats.udp_total);
+}
+
+// Fan-out
+
+void MultiRenderer::renderBandwidth(const BandwidthResult& result) {
+    for (size_t i = 0; i < renderers_.size(); i++) {
+        renderers_[i]->renderBandwidth(result);
+    }
+}
+
+void MultiRenderer::renderLatency(const LatencyResult& result) {
+    for (size_t i = 0; i < renderers_.size(); i++) {
+        renderers_[i]->renderLatency(result);
+    }
+}
+
+void MultiRenderer::renderPacketLoss(const std::string& host, const PacketLossStats& stats) {
+    for (size_t i = 0; i < renderers_.size(); i++) {
+        renderers_[i]->renderPacketLoss(host, stats);
+    }
+}
+
+void MultiRenderer::renderConnections(const ConnectionStats& stats) {
+    for (size_t i = 0; i < renderers_.size(); i++) {
+        renderers_[i]->renderConnections(stats);
+    }
+}
@@ -0,0 +1,401 @@
+#include "rollup_store.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace {
+
+const int64_t kSecondNs = 1000000000LL;
+
+// Retention is checked at most this often while appending
+const int64_t kRetentionCheckNs = 60 * kSecondNs;
+
+// Segment sizes for the rollup tiers, which hold far fewer rows
+const size_t kSegmentBytes[kRollupTiers] = {8 * 1024 * 1024, 1024 * 1024, 256 * 1024};
+
+const char* kTierDirectories[kRollupTiers] = {"", "rollup-1m", "rollup-1h"};
+
+int64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Combine a rollup row with the continuation of the same bucket (a bucket
+// that was cut short when the monitor stopped and resumed later)
+void mergeRows(RollupRow& into, const RollupRow& next) {
+    uint64_t samples = into.samples + next.samples;
+    for (int c = 0; c < into.columns; c++) {
+        into.min[c] = std::min(into.min[c], next.min[c]);
+        into.max[c] = std::max(into.max[c], next.max[c]);
+        if (samples > 0) {
+            into.avg[c] = (into.avg[c] * into.samples + next.avg[c] * next.samples) / samples;
+        }
+        into.last[c] = next.last[c];
+    }
+    into.samples = samples;
+}
+
+} // namespace
+
+bool parseDuration(const std::string& text, int64_t& ns) {
+    char* end = nullptr;
+    double amount = strtod(text.c_str(), &end);
+    if (end == text.c_str() || amount < 0) {
+        return false;
+    }
+
+    std::string unit(end);
+    double scale;
+    if (unit.empty() || unit == "s") scale = 1e9;
+    else if (unit == "ms") scale = 1e6;
+    else if (unit == "m") scale = 60e9;
+    else if (unit == "h") scale = 3600e9;
+    else if (unit == "d") scale = 86400e9;
+    else if (unit == "w") scale = 7 * 86400e9;
+    else if (unit == "y") scale = 365 * 86400e9;
+    else return false;
+
+    ns = static_cast<int64_t>(amount * scale);
+    return true;
+}
+
+RollupStore::RollupStore()
+    : last_retention_check_ns_(0), read_only_(true) {
+    defaultRetention(retention_ns_);
+}
+
+RollupStore::~RollupStore() {
+    close();
+}
+
+int64_t RollupStore::tierResolution(int tier) {
+    switch (tier) {
+        case TIER_MINUTE: return 60 * kSecondNs;
+        case TIER_HOUR:   return 3600 * kSecondNs;
+        default:          return 0;
+    }
+}
+
+const char* RollupStore::tierName(int tier) {
+    switch (tier) {
+        case TIER_MINUTE: return "1m";
+        case TIER_HOUR:   return "1h";
+        default:          return "raw";
+    }
+}
+
+void RollupStore::defaultRetention(int64_t* retention_ns) {
+    retention_ns[TIER_RAW] = 7 * 86400 * kSecondNs;
+    retention_ns[TIER_MINUTE] = 90 * 86400 * kSecondNs;
+    retention_ns[TIER_HOUR] = 2 * 365 * 86400 * kSecondNs;
+}
+
+// Parse "raw=7d,1m=90d,1h=2y"; tiers that are not named keep their value
+bool RollupStore::parseRetention(const std::string& spec, int64_t* retention_ns) {
+    std::istringstream iss(spec);
+    std::string entry;
+    while (std::getline(iss, entry, ',')) {
+        size_t equals = entry.find('=');
+        if (equals == std::string::npos) {
+            return false;
+        }
+        std::string tier_name = entry.substr(0, equals);
+        int tier = -1;
+        for (int t = 0; t < kRollupTiers; t++) {
+            if (tier_name == tierName(t)) {
+                tier = t;
+            }
+        }
+        if (tier < 0 || !parseDuration(entry.substr(equals + 1), retention_ns[tier])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Open the raw store and the rollup tiers below it
+bool RollupStore::open(const std::string& directory, bool read_only, const int64_t* retention_ns) {
+    close();
+    read_only_ = read_only;
+    if (retention_ns != nullptr) {
+        std::copy(retention_ns, retention_ns + kRollupTiers, retention_ns_);
+    }
+
+    for (int t = 0; t < kRollupTiers; t++) {
+        std::string path = directory;
+        if (t != TIER_RAW) {
+            path += std::string("/") + kTierDirectories[t];
+
+            // Stores written before rollups existed have no tier directories
+            struct stat info;
+            if (read_only && stat(path.c_str(), &info) != 0) {
+                continue;
+            }
+        }
+        if (!stores_[t].open(path, read_only, kSegmentBytes[t])) {
+            close();
+            return false;
+        }
+        // Roughly eight segments per retention period
+        stores_[t].setSegmentSpan(retention_ns_[t] / 8);
+    }
+
+    if (!read_only) {
+        enforceRetention(wallClockNs());
+    }
+    return true;
+}
+
+// Write out open buckets and close every tier
+void RollupStore::close() {
+    if (!read_only_) {
+        flush();
+    }
+    for (int t = 0; t < kRollupTiers; t++) {
+        stores_[t].close();
+    }
+    states_.clear();
+}
+
+// Rollup state for a raw series, created on first use
+RollupStore::SeriesState& RollupStore::state(uint32_t series_id) {
+    if (series_id > states_.size()) {
+        size_t old_size = states_.size();
+        states_.resize(series_id);
+        for (size_t i = old_size; i < states_.size(); i++) {
+            const SeriesInfo& info = stores_[TIER_RAW].series()[i];
+            SeriesState& state = states_[i];
+            state.columns = std::min(info.u64_columns + info.f64_columns, kMaxRollupColumns);
+            for (int t = 0; t < kRollupTiers; t++) {
+                state.tier_ids[t] = 0;
+                state.open[t] = false;
+            }
+        }
+    }
+    return states_[series_id - 1];
+}
+
+// Append a raw row and fold it into the minute bucket
+bool RollupStore::append(uint32_t series_id, int64_t timestamp_ns, const uint64_t* u, const double* f) {
+    if (!stores_[TIER_RAW].append(series_id, timestamp_ns, u, f)) {
+        return false;
+    }
+
+    const SeriesInfo& info = stores_[TIER_RAW].series()[series_id - 1];
+    SeriesState& series = state(series_id);
+    double values[kMaxRollupColumns];
+    for (int c = 0; c < series.columns; c++) {
+        values[c] = c < info.u64_columns ? static_cast<double>(u[c]) : f[c - info.u64_columns];
+    }
+    fold(series_id, TIER_MINUTE, timestamp_ns, 1, values, values, values, values);
+
+    if (timestamp_ns - last_retention_check_ns_ >= kRetentionCheckNs) {
+        enforceRetention(timestamp_ns);
+    }
+    return true;
+}
+
+// Add samples to the open bucket of a tier, closing it first when the
+// timestamp has moved past it
+void RollupStore::fold(uint32_t series_id, int tier, int64_t timestamp_ns, uint64_t samples,
+                       const double* min, const double* max, const double* sum, const double* last) {
+    if (!stores_[tier].isOpen()) {
+        return;
+    }
+
+    SeriesState& series = state(series_id);
+    int64_t resolution = tierResolution(tier);
+    int64_t start = timestamp_ns - ((timestamp_ns % resolution) + resolution) % resolution;
+
+    Bucket& bucket = series.buckets[tier];
+    if (series.open[tier] && bucket.start != start) {
+        emit(series_id, tier);
+    }
+    if (!series.open[tier]) {
+        bucket.start = start;
+        bucket.samples = 0;
+        for (int c = 0; c < series.columns; c++) {
+            bucket.min[c] = std::numeric_limits<double>::infinity();
+            bucket.max[c] = -std::numeric_limits<double>::infinity();
+            bucket.sum[c] = 0.0;
+        }
+        series.open[tier] = true;
+    }
+
+    bucket.samples += samples;
+    for (int c = 0; c < series.columns; c++) {
+        bucket.min[c] = std::min(bucket.min[c], min[c]);
+        bucket.max[c] = std::max(bucket.max[c], max[c]);
+        bucket.sum[c] += sum[c];
+        bucket.last[c] = last[c];
+    }
+}
+
+// Write a tier's open bucket as a rollup row and fold it into the next tier.
+// Row layout: u64 sample count, then min/max/avg/last per source column.
+void RollupStore::emit(uint32_t series_id, int tier) {
+    SeriesState& series = state(series_id);
+    if (!series.open[tier]) {
+        return;
+    }
+    series.open[tier] = false;
+    const Bucket& bucket = series.buckets[tier];
+
+    if (series.tier_ids[tier] == 0) {
+        const SeriesInfo& info = stores_[TIER_RAW].series()[series_id - 1];
+        series.tier_ids[tier] = stores_[tier].seriesId(info.kind, info.name, 1, 4 * series.columns);
+    }
+
+    uint64_t samples = bucket.samples;
+    double values[4 * kMaxRollupColumns];
+    for (int c = 0; c < series.columns; c++) {
+        values[4 * c] = bucket.min[c];
+        values[4 * c + 1] = bucket.max[c];
+        values[4 * c + 2] = bucket.sum[c] / static_cast<double>(bucket.samples);
+        values[4 * c + 3] = bucket.last[c];
+    }
+    stores_[tier].append(series.tier_ids[tier], bucket.start, &samples, values);
+
+    if (tier + 1 < kRollupTiers) {
+        fold(series_id, tier + 1, bucket.start, bucket.samples,
+             bucket.min, bucket.max, bucket.sum, bucket.last);
+    }
+}
+
+// Close every open bucket (finest first so it reaches the next tier) and
+// write buffered rows
+void RollupStore::flush() {
+    for (uint32_t id = 1; id <= states_.size(); id++) {
+        for (int t = TIER_MINUTE; t < kRollupTiers; t++) {
+            emit(id, t);
+        }
+    }
+    for (int t = 0; t < kRollupTiers; t++) {
+        if (stores_[t].isOpen()) {
+            stores_[t].flush();
+        }
+    }
+}
+
+// Drop segments that fell out of each tier's retention window
+void RollupStore::enforceRetention(int64_t now_ns) {
+    last_retention_check_ns_ = now_ns;
+    for (int t = 0; t < kRollupTiers; t++) {
+        if (stores_[t].isOpen() && retention_ns_[t] > 0) {
+            stores_[t].dropSegmentsBefore(now_ns - retention_ns_[t]);
+        }
+    }
+}
+
+bool RollupStore::timeRange(int64_t& first_ns, int64_t& last_ns) const {
+    bool found = false;
+    for (int t = 0; t < kRollupTiers; t++) {
+        int64_t first, last;
+        if (stores_[t].isOpen() && stores_[t].timeRange(first, last)) {
+            first_ns = found ? std::min(first_ns, first) : first;
+            last_ns = found ? std::max(last_ns, last) : last;
+            found = true;
+        }
+    }
+    return found;
+}
+
+int RollupStore::selectTier(int64_t from_ns, int64_t resolution_ns) const {
+    int tier = TIER_RAW;
+    for (int t = TIER_MINUTE; t < kRollupTiers; t++) {
+        if (stores_[t].isOpen() && tierResolution(t) <= resolution_ns) {
+            tier = t;
+        }
+    }
+
+    // Older data than the tier still holds: read a coarser tier, but only
+    // when it has a whole bucket from before the finer tier's first row
+    // (a coarse bucket always starts a little before its first sample)
+    while (tier + 1 < kRollupTiers && stores_[tier + 1].isOpen() &&
+           from_ns != std::numeric_limits<int64_t>::min()) {
+        int64_t first_ns, last_ns, coarse_first_ns, coarse_last_ns;
+        bool have_rows = stores_[tier].timeRange(first_ns, last_ns);
+        if ((have_rows && from_ns >= first_ns) ||
+            !stores_[tier + 1].timeRange(coarse_first_ns, coarse_last_ns) ||
+            (have_rows && coarse_first_ns + tierResolution(tier + 1) > first_ns)) {
+            break;
+        }
+        tier++;
+    }
+    return tier;
+}
+
+bool RollupStore::tierTimeRange(int tier, int64_t& first_ns, int64_t& last_ns) const {
+    return tier >= 0 && tier < kRollupTiers && stores_[tier].isOpen() &&
+           stores_[tier].timeRange(first_ns, last_ns);
+}
+
+bool RollupStore::query(SeriesKind kind, const std::string& name, int64_t from_ns, int64_t to_ns,
+                        int64_t resolution_ns, const std::function<void(const RollupRow&)>& visit) const {
+    int tier = selectTier(from_ns, resolution_ns);
+    const TimeSeriesStore& store = stores_[tier];
+    uint32_t id;
+    if (!store.findSeries(kind, name, id)) {
+        return false;
+    }
+    const SeriesInfo& info = store.series()[id - 1];
+
+    if (tier == TIER_RAW) {
+        int columns = std::min(info.u64_columns + info.f64_columns, kMaxRollupColumns);
+        return store.query(id, from_ns, to_ns, [&](const SeriesRow& sample) {
+            RollupRow row;
+            row.timestamp_ns = sample.timestamp_ns;
+            row.resolution_ns = 0;
+            row.samples = 1;
+            row.columns = columns;
+            for (int c = 0; c < columns; c++) {
+                double value = c < info.u64_columns ? static_cast<double>(sample.u[c])
+                                                    : sample.f[c - info.u64_columns];
+                row.min[c] = row.max[c] = row.avg[c] = row.last[c] = value;
+            }
+            visit(row);
+        });
+    }
+
+    // Buckets start at their timestamp, so include the one that covers from_ns
+    int64_t resolution = tierResolution(tier);
+    int64_t bucket_from = from_ns;
+    if (from_ns != std::numeric_limits<int64_t>::min()) {
+        bucket_from -= ((from_ns % resolution) + resolution) % resolution;
+    }
+    bool have_pending = false;
+    RollupRow pending;
+
+    bool ok = store.query(id, bucket_from, to_ns, [&](const SeriesRow& sample) {
+        RollupRow row;
+        row.timestamp_ns = sample.timestamp_ns;
+        row.resolution_ns = resolution;
+        row.samples = sample.u[0];
+        row.columns = std::min(info.f64_columns / 4, kMaxRollupColumns);
+        for (int c = 0; c < row.columns; c++) {
+            row.min[c] = sample.f[4 * c];
+            row.max[c] = sample.f[4 * c + 1];
+            row.avg[c] = sample.f[4 * c + 2];
+            row.last[c] = sample.f[4 * c + 3];
+        }
+
+        if (have_pending && pending.timestamp_ns == row.timestamp_ns) {
+            mergeRows(pending, row);
+            return;
+        }
+        if (have_pending) {
+            visit(pending);
+        }
+        pending = row;
+        have_pending = true;
+    });
+
+    if (have_pending) {
+        visit(pending);
+    }
+    return ok;
+}
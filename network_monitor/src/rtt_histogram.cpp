@@ -0,0 +1,157 @@
+#include "rtt_histogram.h"
+#include <cstring>
+#include <cmath>
+
+RttHistogram::RttHistogram() {
+    reset();
+}
+
+void RttHistogram::reset() {
+    memset(counts_, 0, sizeof(counts_));
+    count_ = 0;
+    min_ms_ = 0.0;
+    max_ms_ = 0.0;
+    mean_ms_ = 0.0;
+    m2_ = 0.0;
+}
+
+// Bucket index for a value. Values below kSubBuckets map 1:1; above that,
+// each power of two adds kHalfSubBuckets slots of doubling width.
+int RttHistogram::indexFor(uint64_t value_us) {
+    if (value_us < static_cast<uint64_t>(kSubBuckets)) {
+        return static_cast<int>(value_us);
+    }
+
+    int magnitude = 63 - __builtin_clzll(value_us);     // floor(log2(value))
+    if (magnitude >= kMaxValueBits) {
+        return kCountsLength - 1;
+    }
+
+    int bucket = magnitude - kSubBucketBits + 1;
+    int sub_bucket = static_cast<int>(value_us >> bucket);  // In [kHalfSubBuckets, kSubBuckets)
+    return (bucket + 1) * kHalfSubBuckets + (sub_bucket - kHalfSubBuckets);
+}
+
+// Lowest value that maps to an index
+uint64_t RttHistogram::valueAt(int index) {
+    if (index < kSubBuckets) {
+        return static_cast<uint64_t>(index);
+    }
+
+    int bucket = index / kHalfSubBuckets - 1;
+    int sub_bucket = index % kHalfSubBuckets + kHalfSubBuckets;
+    return static_cast<uint64_t>(sub_bucket) << bucket;
+}
+
+// Record one RTT
+void RttHistogram::record(double rtt_ms) {
+    if (rtt_ms < 0.0) {
+        rtt_ms = 0.0;
+    }
+
+    uint64_t value_us = static_cast<uint64_t>(rtt_ms * 1000.0 + 0.5);
+    counts_[indexFor(value_us)]++;
+
+    if (count_ == 0 || rtt_ms < min_ms_) {
+        min_ms_ = rtt_ms;
+    }
+    if (count_ == 0 || rtt_ms > max_ms_) {
+        max_ms_ = rtt_ms;
+    }
+
+    count_++;
+    double delta = rtt_ms - mean_ms_;
+    mean_ms_ += delta / count_;
+    m2_ += delta * (rtt_ms - mean_ms_);
+}
+
+// Merge another histogram (parallel variance combination)
+void RttHistogram::merge(const RttHistogram& other) {
+    if (other.count_ == 0) {
+        return;
+    }
+
+    for (int i = 0; i < kCountsLength; i++) {
+        counts_[i] += other.counts_[i];
+    }
+
+    if (count_ == 0) {
+        min_ms_ = other.min_ms_;
+        max_ms_ = other.max_ms_;
+        mean_ms_ = other.mean_ms_;
+        m2_ = other.m2_;
+        count_ = other.count_;
+        return;
+    }
+
+    if (other.min_ms_ < min_ms_) {
+        min_ms_ = other.min_ms_;
+    }
+    if (other.max_ms_ > max_ms_) {
+        max_ms_ = other.max_ms_;
+    }
+
+    uint64_t total = count_ + other.count_;
+    double delta = other.mean_ms_ - mean_ms_;
+    mean_ms_ += delta * other.count_ / total;
+    m2_ += other.m2_ + delta * delta * (static_cast<double>(count_) * other.count_ / total);
+    count_ = total;
+}
+
+double RttHistogram::min() const {
+    return min_ms_;
+}
+
+double RttHistogram::max() const {
+    return max_ms_;
+}
+
+double RttHistogram::mean() const {
+    return mean_ms_;
+}
+
+// Population standard deviation (matches the jitter definition)
+double RttHistogram::stddev() const {
+    if (count_ < 2) {
+        return 0.0;
+    }
+    return std::sqrt(m2_ / count_);
+}
+
+// Value at a percentile, reported as the midpoint of its bucket
+double RttHistogram::percentile(double percent) const {
+    if (count_ == 0) {
+        return 0.0;
+    }
+    if (percent < 0.0) {
+        percent = 0.0;
+    }
+    if (percent > 100.0) {
+        percent = 100.0;
+    }
+
+    uint64_t target = static_cast<uint64_t>(std::ceil(percent / 100.0 * count_));
+    if (target == 0) {
+        target = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < kCountsLength; i++) {
+        seen += counts_[i];
+        if (seen >= target) {
+            uint64_t low = valueAt(i);
+            uint64_t high = (i + 1 < kCountsLength) ? valueAt(i + 1) : low + 1;
+            double value_ms = (low + high - 1) / 2.0 / 1000.0;
+
+            // Never report outside the exact observed range
+            if (value_ms < min_ms_) {
+                value_ms = min_ms_;
+            }
+            if (value_ms > max_ms_) {
+                value_ms = max_ms_;
+            }
+            return value_ms;
+        }
+    }
+    return max_ms_;
+}
@@ -0,0 +1,181 @@
+#include "shm_publisher.h"
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <errno.h>
+#include <signal.h>
+#include <sys/stat.h>
+
+namespace {
+
+int64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Copy a name into a fixed field, truncating and always terminating
+template <size_t N>
+void copyName(char (&field)[N], const std::string& value) {
+    size_t length = value.size() < N - 1 ? value.size() : N - 1;
+    memcpy(field, value.data(), length);
+    memset(field + length, 0, N - length);
+}
+
+// Writer half of the sequence lock
+template <typename Section>
+void beginWrite(Section& section) {
+    section.sequence.store(section.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+template <typename Section>
+void endWrite(Section& section) {
+    section.sequence.store(section.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+// Whether an existing segment was left by a netmonitor writer that has
+// exited. Segments of live writers, other programs or a writer still
+// setting up are not stale.
+bool staleSegment(const std::string& name, int32_t& writer_pid) {
+    writer_pid = 0;
+    int fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return errno == ENOENT;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(ShmMetricsLayout))) {
+        ::close(fd);
+        return false;
+    }
+    void* base = mmap(nullptr, sizeof(ShmMetricsLayout), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    const ShmMetricsLayout* layout = static_cast<const ShmMetricsLayout*>(base);
+    const std::atomic<uint32_t>* magic = reinterpret_cast<const std::atomic<uint32_t>*>(&layout->magic);
+    bool ours = magic->load(std::memory_order_acquire) == kShmMetricsMagic;
+    writer_pid = layout->writer_pid;
+    munmap(base, sizeof(ShmMetricsLayout));
+    return ours && writer_pid > 0 && kill(writer_pid, 0) != 0 && errno == ESRCH;
+}
+
+} // namespace
+
+ShmPublisher::ShmPublisher()
+    : layout_(nullptr) {
+}
+
+ShmPublisher::~ShmPublisher() {
+    close();
+}
+
+// Create, size and map the segment, then publish the header with the magic last
+bool ShmPublisher::open(const std::string& name) {
+    close();
+
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0 && errno == EEXIST) {
+        int32_t writer_pid;
+        if (!staleSegment(name, writer_pid)) {
+            std::cerr << "Error: Shared memory " << name << " is in use";
+            if (writer_pid > 0) {
+                std::cerr << " by process " << writer_pid;
+            }
+            std::cerr << " (remove /dev/shm" << name << " if it is left over)" << std::endl;
+            return false;
+        }
+        shm_unlink(name.c_str());
+        fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    }
+    if (fd < 0) {
+        std::cerr << "Error: Could not open shared memory " << name << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (ftruncate(fd, sizeof(ShmMetricsLayout)) != 0) {
+        std::cerr << "Error: Could not size shared memory " << name << ": " << strerror(errno) << std::endl;
+        ::close(fd);
+        return false;
+    }
+    void* base = mmap(nullptr, sizeof(ShmMetricsLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "Error: Could not map shared memory " << name << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    layout_ = static_cast<ShmMetricsLayout*>(base);
+    name_ = name;
+
+    std::atomic<uint32_t>* magic = reinterpret_cast<std::atomic<uint32_t>*>(&layout_->magic);
+    magic->store(0, std::memory_order_relaxed);
+    layout_->version_major = kShmMetricsVersionMajor;
+    layout_->version_minor = kShmMetricsVersionMinor;
+    layout_->layout_size = sizeof(ShmMetricsLayout);
+    layout_->writer_pid = static_cast<int32_t>(getpid());
+    layout_->started_ns = wallClockNs();
+    layout_->interfaces.sequence.store(0, std::memory_order_relaxed);
+    layout_->interfaces.count = 0;
+    layout_->interfaces.updated_ns = 0;
+    layout_->probes.sequence.store(0, std::memory_order_relaxed);
+    layout_->probes.count = 0;
+    layout_->probes.updated_ns = 0;
+    magic->store(kShmMetricsMagic, std::memory_order_release);
+    return true;
+}
+
+void ShmPublisher::close() {
+    if (layout_ != nullptr) {
+        munmap(layout_, sizeof(ShmMetricsLayout));
+        shm_unlink(name_.c_str());
+        layout_ = nullptr;
+    }
+}
+
+void ShmPublisher::publishInterfaces(const std::vector<InterfaceMetric>& metrics) {
+    ShmInterfaceSection& section = layout_->interfaces;
+    uint32_t count = metrics.size() < kShmMaxInterfaces ? static_cast<uint32_t>(metrics.size()) : kShmMaxInterfaces;
+
+    beginWrite(section);
+    for (uint32_t i = 0; i < count; i++) {
+        const InterfaceMetric& metric = metrics[i];
+        ShmInterfaceEntry& entry = section.entries[i];
+        copyName(entry.name, metric.name);
+        entry.bytes_received = metric.bytes_received;
+        entry.bytes_sent = metric.bytes_sent;
+        entry.packets_received = metric.packets_received;
+        entry.packets_sent = metric.packets_sent;
+        entry.download_bps = metric.download_bps;
+        entry.upload_bps = metric.upload_bps;
+    }
+    section.count = count;
+    section.updated_ns = wallClockNs();
+    endWrite(section);
+}
+
+void ShmPublisher::publishProbes(const std::vector<ProbeMetric>& metrics) {
+    ShmProbeSection& section = layout_->probes;
+    uint32_t count = metrics.size() < kShmMaxProbes ? static_cast<uint32_t>(metrics.size()) : kShmMaxProbes;
+
+    beginWrite(section);
+    for (uint32_t i = 0; i < count; i++) {
+        const ProbeMetric& metric = metrics[i];
+        ShmProbeEntry& entry = section.entries[i];
+        copyName(entry.host, metric.host);
+        entry.sent_total = metric.sent_total;
+        entry.received_total = metric.received_total;
+        entry.lost_total = metric.lost_total;
+        entry.loss_ratio = metric.loss_ratio;
+        entry.rtt_min_ms = metric.rtt_min_ms;
+        entry.rtt_avg_ms = metric.rtt_avg_ms;
+        entry.rtt_max_ms = metric.rtt_max_ms;
+        entry.rtt_p50_ms = metric.rtt_p50_ms;
+        entry.rtt_p90_ms = metric.rtt_p90_ms;
+        entry.rtt_p99_ms = metric.rtt_p99_ms;
+        entry.jitter_ms = metric.jitter_ms;
+        entry.has_rtt = metric.has_rtt ? 1 : 0;
+    }
+    section.count = count;
+    section.updated_ns = wallClockNs();
+    endWrite(section);
+}
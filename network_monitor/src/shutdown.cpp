@@ -0,0 +1,50 @@
+#include "shutdown.h"
+#include <csignal>
+#include <cstring>
+#include <errno.h>
+#include <time.h>
+
+namespace {
+
+volatile sig_atomic_t g_shutdown_requested = 0;
+
+void handleShutdownSignal(int) {
+    g_shutdown_requested = 1;
+}
+
+} // namespace
+
+// Install handlers without SA_RESTART so blocking calls return with EINTR
+void installShutdownHandlers() {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handleShutdownSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+}
+
+bool shutdownRequested() {
+    return g_shutdown_requested != 0;
+}
+
+// nanosleep() until the duration has passed or a shutdown signal arrives
+bool sleepUnlessShutdown(std::chrono::nanoseconds duration) {
+    auto ns = duration.count();
+    if (ns <= 0) {
+        return !shutdownRequested();
+    }
+
+    struct timespec remaining;
+    remaining.tv_sec = ns / 1000000000LL;
+    remaining.tv_nsec = ns % 1000000000LL;
+    while (!shutdownRequested()) {
+        if (nanosleep(&remaining, &remaining) == 0) {
+            return true;
+        }
+        if (errno != EINTR) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,170 @@
+#include "sock_diag.h"
+#include <cstring>
+#include <cstdio>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace {
+
+// Receive buffer size for dump replies
+const size_t kReceiveBufferSize = 64 * 1024;
+
+// Sum "<label> inuse N" style counters out of a sockstat file
+bool readSockstatFile(const char* path, const char* tcp_label, const char* udp_label,
+                      int& tcp_inuse, int& tcp_timewait, int& udp_inuse) {
+    FILE* file = fopen(path, "re");
+    if (file == nullptr) {
+        return false;
+    }
+
+    char line[256];
+    size_t tcp_len = strlen(tcp_label);
+    size_t udp_len = strlen(udp_label);
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        int inuse = 0;
+        int orphan = 0;
+        int tw = 0;
+        if (strncmp(line, tcp_label, tcp_len) == 0 && line[tcp_len] == ':') {
+            int fields = sscanf(line + tcp_len + 1, " inuse %d orphan %d tw %d", &inuse, &orphan, &tw);
+            if (fields >= 1) {
+                tcp_inuse += inuse;
+            }
+            if (fields == 3) {
+                tcp_timewait += tw;
+            }
+        } else if (strncmp(line, udp_label, udp_len) == 0 && line[udp_len] == ':') {
+            if (sscanf(line + udp_len + 1, " inuse %d", &inuse) == 1) {
+                udp_inuse += inuse;
+            }
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+} // namespace
+
+SockDiagClient::SockDiagClient()
+    : sock_(-1), seq_(0), buffer_(kReceiveBufferSize) {
+}
+
+SockDiagClient::~SockDiagClient() {
+    if (sock_ >= 0) {
+        close(sock_);
+    }
+}
+
+// Open the sock_diag socket on first use
+bool SockDiagClient::openSocket() {
+    if (sock_ >= 0) {
+        return true;
+    }
+    sock_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    return sock_ >= 0;
+}
+
+// Dump sockets matching family, protocol and state mask
+bool SockDiagClient::dump(int family, int protocol, uint32_t states, uint8_t extensions,
+                          const Visitor& visit) {
+    if (!openSocket()) {
+        return false;
+    }
+
+    struct {
+        struct nlmsghdr header;
+        struct inet_diag_req_v2 req;
+    } request;
+
+    memset(&request, 0, sizeof(request));
+    request.header.nlmsg_len = sizeof(request);
+    request.header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = ++seq_;
+    request.req.sdiag_family = static_cast<uint8_t>(family);
+    request.req.sdiag_protocol = static_cast<uint8_t>(protocol);
+    request.req.idiag_ext = extensions;
+    request.req.idiag_states = states;
+
+    struct sockaddr_nl kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+
+    if (sendto(sock_, &request, sizeof(request), 0,
+               (struct sockaddr*)&kernel, sizeof(kernel)) != static_cast<ssize_t>(sizeof(request))) {
+        return false;
+    }
+
+    while (true) {
+        ssize_t received = recv(sock_, buffer_.data(), buffer_.size(), 0);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        int remaining = static_cast<int>(received);
+        for (struct nlmsghdr* header = (struct nlmsghdr*)buffer_.data();
+             NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining)) {
+            if (header->nlmsg_seq != seq_) {
+                continue;
+            }
+            if (header->nlmsg_type == NLMSG_DONE) {
+                return true;
+            }
+            if (header->nlmsg_type == NLMSG_ERROR) {
+                // Reopen on the next dump so no stale replies are left queued
+                close(sock_);
+                sock_ = -1;
+                return false;
+            }
+            if (header->nlmsg_type != SOCK_DIAG_BY_FAMILY) {
+                continue;
+            }
+
+            const struct inet_diag_msg* msg = (const struct inet_diag_msg*)NLMSG_DATA(header);
+            int attrs_len = static_cast<int>(header->nlmsg_len - NLMSG_LENGTH(sizeof(*msg)));
+            const struct rtattr* attrs = (const struct rtattr*)(msg + 1);
+            visit(*msg, attrs, attrs_len);
+        }
+    }
+}
+
+// Count sockets for a protocol across IPv4 and IPv6
+bool SockDiagClient::count(int protocol, uint32_t states, int& total) {
+    int found = 0;
+    Visitor counter = [&found](const struct inet_diag_msg&, const struct rtattr*, int) {
+        found++;
+    };
+
+    if (!dump(AF_INET, protocol, states, 0, counter)) {
+        return false;
+    }
+    // IPv6 may be disabled; IPv4 results are still valid
+    dump(AF_INET6, protocol, states, 0, counter);
+
+    total = found;
+    return true;
+}
+
+// Read socket totals from /proc/net/sockstat{,6}
+bool readSockstat(SockstatSummary& summary) {
+    summary.tcp_inuse = 0;
+    summary.tcp_timewait = 0;
+    summary.udp_inuse = 0;
+
+    if (!readSockstatFile("/proc/net/sockstat", "TCP", "UDP",
+                          summary.tcp_inuse, summary.tcp_timewait, summary.udp_inuse)) {
+        return false;
+    }
+    // Missing when IPv6 is disabled
+    readSockstatFile("/proc/net/sockstat6", "TCP6", "UDP6",
+                     summary.tcp_inuse, summary.tcp_timewait, summary.udp_inuse);
+    return true;
+}
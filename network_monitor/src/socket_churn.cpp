@@ -0,0 +1,107 @@
+#include "socket_churn.h"
+
+namespace {
+
+// Initial table size (power of two)
+const size_t kInitialSlots = 1024;
+
+// Inode numbers are mostly sequential; spread them over the table
+inline size_t hashInode(uint64_t inode) {
+    inode ^= inode >> 33;
+    inode *= 0xff51afd7ed558ccdULL;
+    inode ^= inode >> 33;
+    return static_cast<size_t>(inode);
+}
+
+} // namespace
+
+SocketChurnTracker::SocketChurnTracker()
+    : slots_(kInitialSlots), mask_(kInitialSlots - 1), occupied_(0),
+      generation_(0), live_(0), survived_(0), opened_(0) {
+}
+
+void SocketChurnTracker::begin() {
+    generation_++;
+    survived_ = 0;
+    opened_ = 0;
+
+    // Mostly dead slots make probe chains long: drop them
+    if (occupied_ > live_ * 2 && occupied_ * 4 > slots_.size()) {
+        rebuild(slots_.size());
+    }
+}
+
+void SocketChurnTracker::add(uint64_t inode) {
+    if (inode == 0) {
+        return;
+    }
+
+    // Keep the load factor under 3/4, counting dead slots
+    if ((occupied_ + 1) * 4 > slots_.size() * 3) {
+        uint64_t wanted = (live_ + opened_ + 1) * 2;
+        size_t capacity = slots_.size();
+        while (capacity < wanted) {
+            capacity *= 2;
+        }
+        rebuild(capacity);
+    }
+
+    size_t index = hashInode(inode) & mask_;
+    size_t reusable = slots_.size();
+    while (slots_[index].inode != 0) {
+        Slot& slot = slots_[index];
+        if (slot.inode == inode) {
+            if (slot.generation + 1 == generation_) {
+                survived_++;
+            } else if (slot.generation != generation_) {
+                opened_++;      // Dead entry of an inode that came back
+            }
+            slot.generation = generation_;
+            return;
+        }
+        if (reusable == slots_.size() && slot.generation + 1 < generation_) {
+            reusable = index;
+        }
+        index = (index + 1) & mask_;
+    }
+
+    if (reusable == slots_.size()) {
+        reusable = index;
+        occupied_++;
+    }
+    slots_[reusable].inode = inode;
+    slots_[reusable].generation = generation_;
+    opened_++;
+}
+
+bool SocketChurnTracker::end(uint64_t& opened, uint64_t& closed) {
+    opened = opened_;
+    closed = live_ - survived_;
+    live_ = survived_ + opened_;
+    return generation_ > 1;
+}
+
+// Re-insert the current and previous snapshot into a table of capacity slots
+void SocketChurnTracker::rebuild(size_t capacity) {
+    Slot empty = { 0, 0 };
+    spare_.assign(capacity, empty);
+    size_t mask = capacity - 1;
+    size_t occupied = 0;
+
+    for (size_t i = 0; i < slots_.size(); i++) {
+        const Slot& slot = slots_[i];
+        if (slot.inode == 0 || slot.generation + 1 < generation_) {
+            continue;
+        }
+        size_t index = hashInode(slot.inode) & mask;
+        while (spare_[index].inode != 0) {
+            index = (index + 1) & mask;
+        }
+        spare_[index] = slot;
+        occupied++;
+    }
+
+    slots_.swap(spare_);
+    mask_ = mask;
+    occupied_ = occupied;
+}
@@ -0,0 +1,143 @@
+#include "terminal_screen.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+TerminalScreen::TerminalScreen(int fd)
+    : fd_(fd), active_(false), rows_(0), columns_(0), next_row_(0), full_redraw_(true) {
+}
+
+TerminalScreen::~TerminalScreen() {
+    stop();
+}
+
+bool TerminalScreen::isTerminal(int fd) {
+    return isatty(fd) == 1;
+}
+
+// Alternate screen and hidden cursor; the first frame clears it
+bool TerminalScreen::start() {
+    if (active_ || !isTerminal(fd_)) {
+        return active_;
+    }
+    if (!writeAll("\x1b[?1049h\x1b[?25l")) {
+        return false;
+    }
+    active_ = true;
+    full_redraw_ = true;
+    return true;
+}
+
+void TerminalScreen::stop() {
+    if (!active_) {
+        return;
+    }
+    writeAll("\x1b[?25h\x1b[?1049l");
+    active_ = false;
+}
+
+void TerminalScreen::resize(int rows, int columns) {
+    rows_ = rows;
+    columns_ = columns;
+    size_t cells = static_cast<size_t>(rows) * static_cast<size_t>(columns);
+    front_.assign(cells, ' ');
+    back_.assign(cells, ' ');
+    full_redraw_ = true;
+}
+
+// Start a frame at the current terminal size
+void TerminalScreen::beginFrame() {
+    struct winsize size;
+    int rows = 24;
+    int columns = 80;
+    if (ioctl(fd_, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+        rows = size.ws_row;
+        columns = size.ws_col;
+    }
+    if (rows != rows_ || columns != columns_) {
+        resize(rows, columns);
+    }
+    std::fill(back_.begin(), back_.end(), ' ');
+    next_row_ = 0;
+}
+
+void TerminalScreen::line(const std::string& text) {
+    if (next_row_ >= rows_) {
+        return;
+    }
+    size_t length = std::min(text.size(), static_cast<size_t>(columns_));
+    std::copy(text.begin(), text.begin() + length, back_.begin() + next_row_ * columns_);
+    next_row_++;
+}
+
+// Cursor position escape (1-based)
+void TerminalScreen::appendMove(int row, int column) {
+    char move[24];
+    int length = snprintf(move, sizeof(move), "\x1b[%d;%dH", row + 1, column + 1);
+    out_.append(move, length);
+}
+
+// Write the changed spans of every row in one write()
+size_t TerminalScreen::present() {
+    if (!active_) {
+        return 0;
+    }
+    out_.clear();
+    if (full_redraw_) {
+        // A cleared screen is all blanks, so only text cells get drawn
+        out_.append("\x1b[2J");
+        std::fill(front_.begin(), front_.end(), ' ');
+        full_redraw_ = false;
+    }
+
+    for (int row = 0; row < rows_; row++) {
+        const char* now = &back_[row * columns_];
+        char* shown = &front_[row * columns_];
+        int column = 0;
+        while (column < columns_) {
+            if (now[column] == shown[column]) {
+                column++;
+                continue;
+            }
+            // Extend the span while differences are at most kMergeGap cells apart
+            int start = column;
+            int end = column + 1;
+            int gap = 0;
+            for (int c = end; c < columns_ && gap <= kMergeGap; c++) {
+                if (now[c] != shown[c]) {
+                    end = c + 1;
+                    gap = 0;
+                } else {
+                    gap++;
+                }
+            }
+            appendMove(row, start);
+            out_.append(now + start, end - start);
+            std::copy(now + start, now + end, shown + start);
+            column = end;
+        }
+    }
+
+    if (out_.empty()) {
+        return 0;
+    }
+    return writeAll(out_) ? out_.size() : 0;
+}
+
+bool TerminalScreen::writeAll(const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = write(fd_, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
@@ -0,0 +1,880 @@
+#include "timeseries_store.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kSegmentMagic[8] = {'N', 'M', 'T', 'S', 'S', 'E', 'G', '1'};
+const uint32_t kSegmentVersion = 1;
+const uint32_t kBlockMagic = 0x4b4c4254;    // "TBLK"
+const char* kCatalogFile = "series.idx";
+const char* kLockFile = "writer.lock";
+
+// Rows older than this are written out even if the block is not full
+const int64_t kBlockFlushNs = 60LL * 1000000000LL;
+
+// Fixed header at the start of every segment file
+struct SegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t block_count;
+    uint64_t capacity;
+    uint64_t used;              // Bytes in use, including this header
+    int64_t min_ts;
+    int64_t max_ts;
+    uint8_t reserved[16];
+};
+
+// Header in front of every block. It is followed by one uint32 byte length
+// per column (timestamps first, then u64 columns, then f64 columns) and the
+// encoded columns themselves.
+struct BlockHeader {
+    uint32_t magic;
+    uint32_t series_id;
+    uint32_t rows;
+    uint16_t u64_columns;
+    uint16_t f64_columns;
+    int64_t min_ts;
+    int64_t max_ts;
+    uint32_t bytes;             // Whole block including this header, 8-byte aligned
+    uint32_t reserved;
+};
+
+inline uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline bool getVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+        uint8_t byte = *pos++;
+        result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline uint64_t doubleBits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline double bitsDouble(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Timestamps: first value, then delta-of-delta
+void encodeTimestamps(const std::vector<SeriesRow>& rows, std::vector<uint8_t>& out) {
+    int64_t prev = 0;
+    int64_t prev_delta = 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        int64_t ts = rows[i].timestamp_ns;
+        if (i == 0) {
+            putVarint(out, zigzag(ts));
+        } else {
+            int64_t delta = ts - prev;
+            putVarint(out, zigzag(delta - prev_delta));
+            prev_delta = delta;
+        }
+        prev = ts;
+    }
+}
+
+bool decodeTimestamps(const uint8_t* pos, const uint8_t* end, std::vector<SeriesRow>& rows) {
+    int64_t prev = 0;
+    int64_t prev_delta = 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        uint64_t raw;
+        if (!getVarint(pos, end, raw)) {
+            return false;
+        }
+        if (i == 0) {
+            prev = unzigzag(raw);
+        } else {
+            prev_delta += unzigzag(raw);
+            prev += prev_delta;
+        }
+        rows[i].timestamp_ns = prev;
+    }
+    return true;
+}
+
+// Counters: first value, then zigzag deltas
+void encodeCounters(const std::vector<SeriesRow>& rows, int column, std::vector<uint8_t>& out) {
+    uint64_t prev = 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        uint64_t value = rows[i].u[column];
+        if (i == 0) {
+            putVarint(out, value);
+        } else {
+            putVarint(out, zigzag(static_cast<int64_t>(value - prev)));
+        }
+        prev = value;
+    }
+}
+
+bool decodeCounters(const uint8_t* pos, const uint8_t* end, int column, std::vector<SeriesRow>& rows) {
+    uint64_t prev = 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        uint64_t raw;
+        if (!getVarint(pos, end, raw)) {
+            return false;
+        }
+        prev = (i == 0) ? raw : prev + static_cast<uint64_t>(unzigzag(raw));
+        rows[i].u[column] = prev;
+    }
+    return true;
+}
+
+// Gauges: first value raw, then the XOR with the previous value. A zero XOR
+// is one 0x00 byte; otherwise a byte 0x40 | leading << 3 | trailing (zero
+// byte counts) is followed by the remaining significant bytes.
+void encodeGauges(const std::vector<SeriesRow>& rows, int column, std::vector<uint8_t>& out) {
+    uint64_t prev = 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        uint64_t bits = doubleBits(rows[i].f[column]);
+        uint64_t value = (i == 0) ? bits : bits ^ prev;
+        prev = bits;
+
+        if (i > 0 && value == 0) {
+            out.push_back(0);
+            continue;
+        }
+
+        int leading = 0;
+        int trailing = 0;
+        if (i > 0) {
+            leading = __builtin_clzll(value) / 8;
+            trailing = __builtin_ctzll(value) / 8;
+            if (leading > 7) leading = 7;
+            if (trailing > 7) trailing = 7;
+            out.push_back(static_cast<uint8_t>(0x40 | (leading << 3) | trailing));
+        }
+        int significant = 8 - leading - trailing;
+        uint64_t shifted = value >> (trailing * 8);
+        for (int b = 0; b < significant; b++) {
+            out.push_back(static_cast<uint8_t>(shifted >> (b * 8)));
+        }
+    }
+}
+
+bool decodeGauges(const uint8_t* pos, const uint8_t* end, int column, std::vector<SeriesRow>& rows) {
+    uint64_t prev = 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        int leading = 0;
+        int trailing = 0;
+        if (i > 0) {
+            if (pos >= end) {
+                return false;
+            }
+            uint8_t control = *pos++;
+            if (control == 0) {
+                rows[i].f[column] = bitsDouble(prev);
+                continue;
+            }
+            leading = (control >> 3) & 7;
+            trailing = control & 7;
+        }
+
+        int significant = 8 - leading - trailing;
+        if (significant <= 0 || end - pos < significant) {
+            return false;
+        }
+        uint64_t value = 0;
+        for (int b = 0; b < significant; b++) {
+            value |= static_cast<uint64_t>(*pos++) << (b * 8);
+        }
+        value <<= trailing * 8;
+        prev = (i == 0) ? value : prev ^ value;
+        rows[i].f[column] = bitsDouble(prev);
+    }
+    return true;
+}
+
+// Encode rows column by column into a complete block (header, column
+// lengths, columns, padding)
+void encodeBlock(uint32_t series_id, int u64_columns, int f64_columns,
+                 const std::vector<SeriesRow>& rows, std::vector<uint8_t>& out) {
+    int columns = 1 + u64_columns + f64_columns;
+    size_t prefix = sizeof(BlockHeader) + columns * sizeof(uint32_t);
+    out.assign(prefix, 0);
+    uint32_t lengths[1 + 2 * kMaxSeriesColumns];
+
+    for (int c = 0; c < columns; c++) {
+        size_t start = out.size();
+        if (c == 0) {
+            encodeTimestamps(rows, out);
+        } else if (c <= u64_columns) {
+            encodeCounters(rows, c - 1, out);
+        } else {
+            encodeGauges(rows, c - 1 - u64_columns, out);
+        }
+        lengths[c] = static_cast<uint32_t>(out.size() - start);
+    }
+    out.resize((out.size() + 7) & ~static_cast<size_t>(7), 0);
+
+    BlockHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = kBlockMagic;
+    header.series_id = series_id;
+    header.rows = static_cast<uint32_t>(rows.size());
+    header.u64_columns = static_cast<uint16_t>(u64_columns);
+    header.f64_columns = static_cast<uint16_t>(f64_columns);
+    header.min_ts = rows.front().timestamp_ns;
+    header.max_ts = rows.back().timestamp_ns;
+    header.bytes = static_cast<uint32_t>(out.size());
+    memcpy(&out[0], &header, sizeof(header));
+    memcpy(&out[sizeof(header)], lengths, columns * sizeof(uint32_t));
+}
+
+// Decode one block into rows. Returns false if the block is malformed.
+bool decodeBlock(const uint8_t* block, std::vector<SeriesRow>& rows) {
+    const BlockHeader* header = reinterpret_cast<const BlockHeader*>(block);
+    int columns = 1 + header->u64_columns + header->f64_columns;
+    if (header->u64_columns > kMaxSeriesColumns || header->f64_columns > kMaxSeriesColumns) {
+        return false;
+    }
+
+    const uint32_t* lengths = reinterpret_cast<const uint32_t*>(block + sizeof(BlockHeader));
+    const uint8_t* pos = block + sizeof(BlockHeader) + columns * sizeof(uint32_t);
+    const uint8_t* block_end = block + header->bytes;
+
+    rows.assign(header->rows, SeriesRow());
+    for (int c = 0; c < columns; c++) {
+        const uint8_t* end = pos + lengths[c];
+        if (end > block_end) {
+            return false;
+        }
+        bool ok;
+        if (c == 0) {
+            ok = decodeTimestamps(pos, end, rows);
+        } else if (c <= header->u64_columns) {
+            ok = decodeCounters(pos, end, c - 1, rows);
+        } else {
+            ok = decodeGauges(pos, end, c - 1 - header->u64_columns, rows);
+        }
+        if (!ok) {
+            return false;
+        }
+        pos = end;
+    }
+    return true;
+}
+
+std::string segmentPath(const std::string& directory, uint32_t number) {
+    char name[32];
+    snprintf(name, sizeof(name), "seg-%06u.tsd", number);
+    return directory + "/" + name;
+}
+
+} // namespace
+
+struct TimeSeriesStore::Segment {
+    uint32_t number;
+    int fd;
+    uint8_t* base;
+    size_t mapped;
+    bool writable;
+
+    Segment() : number(0), fd(-1), base(nullptr), mapped(0), writable(false) {}
+
+    ~Segment() {
+        if (base != nullptr) {
+            munmap(base, mapped);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    SegmentHeader* header() const { return reinterpret_cast<SegmentHeader*>(base); }
+
+    // Bytes in use; pairs with the release store after a block is copied in
+    uint64_t used() const { return __atomic_load_n(&header()->used, __ATOMIC_ACQUIRE); }
+};
+
+const char* seriesKindName(SeriesKind kind) {
+    switch (kind) {
+        case SeriesKind::BANDWIDTH:   return "bandwidth";
+        case SeriesKind::LATENCY:     return "latency";
+        case SeriesKind::PACKET_LOSS: return "packetloss";
+        case SeriesKind::CONNECTIONS: return "connections";
+    }
+    return "unknown";
+}
+
+bool parseSeriesKind(const std::string& name, SeriesKind& kind) {
+    const SeriesKind kinds[] = {SeriesKind::BANDWIDTH, SeriesKind::LATENCY,
+                                SeriesKind::PACKET_LOSS, SeriesKind::CONNECTIONS};
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        if (name == seriesKindName(kinds[i])) {
+            kind = kinds[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+void seriesColumns(SeriesKind kind, int& u64_columns, int& f64_columns) {
+    switch (kind) {
+        case SeriesKind::BANDWIDTH:   u64_columns = 2; f64_columns = 2; return;
+        case SeriesKind::LATENCY:     u64_columns = 1; f64_columns = 1; return;
+        case SeriesKind::PACKET_LOSS: u64_columns = 2; f64_columns = 6; return;
+        case SeriesKind::CONNECTIONS: u64_columns = 3; f64_columns = 0; return;
+    }
+    u64_columns = 0;
+    f64_columns = 0;
+}
+
+TimeSeriesStore::TimeSeriesStore()
+    : read_only_(true), lock_fd_(-1), segment_bytes_(0), segment_span_ns_(0), next_segment_number_(1) {
+}
+
+TimeSeriesStore::~TimeSeriesStore() {
+    close();
+}
+
+// Open a store directory, loading the catalog and mapping every segment
+bool TimeSeriesStore::open(const std::string& directory, bool read_only, size_t segment_bytes) {
+    close();
+
+    if (!read_only && mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Error: Could not create store directory " << directory
+                  << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // One writer per directory: a second one would assign the same series
+    // ids and race on the segment headers
+    if (!read_only) {
+        std::string lock_path = directory + "/" + kLockFile;
+        lock_fd_ = ::open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (lock_fd_ < 0 || flock(lock_fd_, LOCK_EX | LOCK_NB) != 0) {
+            if (lock_fd_ >= 0 && errno == EWOULDBLOCK) {
+                std::cerr << "Error: Store " << directory
+                          << " is already being written by another process" << std::endl;
+            } else {
+                std::cerr << "Error: Could not lock store " << directory
+                          << ": " << strerror(errno) << std::endl;
+            }
+            if (lock_fd_ >= 0) {
+                ::close(lock_fd_);
+                lock_fd_ = -1;
+            }
+            return false;
+        }
+    }
+
+    directory_ = directory;
+    read_only_ = read_only;
+    segment_bytes_ = segment_bytes;
+
+    if (!loadCatalog() || !openSegments()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+// Write pending rows and unmap everything
+void TimeSeriesStore::close() {
+    if (directory_.empty()) {
+        return;
+    }
+    if (!read_only_) {
+        flush();
+    }
+    segments_.clear();
+    pending_.clear();
+    catalog_.clear();
+    catalog_index_.clear();
+    directory_.clear();
+    next_segment_number_ = 1;
+    if (lock_fd_ >= 0) {
+        ::close(lock_fd_);      // Releases the writer lock
+        lock_fd_ = -1;
+    }
+}
+
+// Read the "id<TAB>kind<TAB>name[<TAB>u64<TAB>f64]" catalog lines
+bool TimeSeriesStore::loadCatalog() {
+    std::ifstream file((directory_ + "/" + kCatalogFile).c_str());
+    if (!file.is_open()) {
+        if (read_only_) {
+            std::cerr << "Error: No series catalog in " << directory_ << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string id, kind_name, name;
+        if (!std::getline(fields, id, '\t') || !std::getline(fields, kind_name, '\t')) {
+            continue;
+        }
+        std::getline(fields, name, '\t');
+
+        SeriesInfo info;
+        info.id = static_cast<uint32_t>(strtoul(id.c_str(), nullptr, 10));
+        if (!parseSeriesKind(kind_name, info.kind)) {
+            continue;
+        }
+        info.name = name;
+        seriesColumns(info.kind, info.u64_columns, info.f64_columns);
+
+        // Explicit column counts (older catalogs only have the default layout)
+        std::string u64_columns, f64_columns;
+        if (std::getline(fields, u64_columns, '\t') && std::getline(fields, f64_columns)) {
+            info.u64_columns = atoi(u64_columns.c_str());
+            info.f64_columns = atoi(f64_columns.c_str());
+        }
+        if (info.u64_columns > kMaxSeriesColumns || info.f64_columns > kMaxSeriesColumns ||
+            info.id != catalog_.size() + 1) {
+            std::cerr << "Warning: Ignoring bad catalog line in " << directory_ << ": " << line << std::endl;
+            continue;
+        }
+        catalog_index_[std::make_pair(static_cast<int>(info.kind), name)] = info.id;
+        catalog_.push_back(info);
+    }
+    return true;
+}
+
+// Map every seg-NNNNNN.tsd file; only the newest one is appended to
+bool TimeSeriesStore::openSegments() {
+    DIR* dir = opendir(directory_.c_str());
+    if (dir == nullptr) {
+        std::cerr << "Error: Could not open store directory " << directory_
+                  << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    std::vector<uint32_t> numbers;
+    while (struct dirent* entry = readdir(dir)) {
+        unsigned number;
+        char tail;
+        if (sscanf(entry->d_name, "seg-%6u.tsd%c", &number, &tail) == 1) {
+            numbers.push_back(number);
+        }
+    }
+    closedir(dir);
+    std::sort(numbers.begin(), numbers.end());
+
+    for (size_t i = 0; i < numbers.size(); i++) {
+        bool writable = !read_only_ && i + 1 == numbers.size();
+        std::string path = segmentPath(directory_, numbers[i]);
+
+        std::unique_ptr<Segment> segment(new Segment());
+        segment->number = numbers[i];
+        segment->writable = writable;
+        segment->fd = ::open(path.c_str(), (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+        struct stat info;
+        if (segment->fd < 0 || fstat(segment->fd, &info) != 0 ||
+            static_cast<size_t>(info.st_size) < sizeof(SegmentHeader)) {
+            std::cerr << "Warning: Skipping unreadable segment " << path << std::endl;
+            continue;
+        }
+
+        segment->mapped = static_cast<size_t>(info.st_size);
+        void* base = mmap(nullptr, segment->mapped, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                          MAP_SHARED, segment->fd, 0);
+        if (base == MAP_FAILED) {
+            std::cerr << "Warning: Could not map segment " << path << ": " << strerror(errno) << std::endl;
+            continue;
+        }
+        segment->base = static_cast<uint8_t*>(base);
+
+        const SegmentHeader* header = segment->header();
+        if (memcmp(header->magic, kSegmentMagic, sizeof(kSegmentMagic)) != 0 ||
+            header->version != kSegmentVersion || header->used > segment->mapped) {
+            std::cerr << "Warning: Skipping corrupt segment " << path << std::endl;
+            continue;
+        }
+
+        next_segment_number_ = numbers[i] + 1;
+        segments_.push_back(std::move(segment));
+    }
+    return true;
+}
+
+// Create, size and map a new segment for appending
+TimeSeriesStore::Segment* TimeSeriesStore::createSegment() {
+    if (!segments_.empty()) {
+        segments_.back()->writable = false;
+    }
+
+    std::string path = segmentPath(directory_, next_segment_number_);
+    std::unique_ptr<Segment> segment(new Segment());
+    segment->number = next_segment_number_;
+    segment->writable = true;
+    segment->fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (segment->fd < 0 || ftruncate(segment->fd, static_cast<off_t>(segment_bytes_)) != 0) {
+        std::cerr << "Error: Could not create segment " << path << ": " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+
+    void* base = mmap(nullptr, segment_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, segment->fd, 0);
+    if (base == MAP_FAILED) {
+        std::cerr << "Error: Could not map segment " << path << ": " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+    segment->base = static_cast<uint8_t*>(base);
+    segment->mapped = segment_bytes_;
+
+    SegmentHeader* header = segment->header();
+    memcpy(header->magic, kSegmentMagic, sizeof(kSegmentMagic));
+    header->version = kSegmentVersion;
+    header->block_count = 0;
+    header->capacity = segment_bytes_;
+    header->min_ts = INT64_MAX;
+    header->max_ts = INT64_MIN;
+    __atomic_store_n(&header->used, sizeof(SegmentHeader), __ATOMIC_RELEASE);
+
+    next_segment_number_++;
+    segments_.push_back(std::move(segment));
+    return segments_.back().get();
+}
+
+// Look up a series, adding it to the catalog if it is new
+uint32_t TimeSeriesStore::seriesId(SeriesKind kind, const std::string& name) {
+    int u64_columns, f64_columns;
+    seriesColumns(kind, u64_columns, f64_columns);
+    return seriesId(kind, name, u64_columns, f64_columns);
+}
+
+uint32_t TimeSeriesStore::seriesId(SeriesKind kind, const std::string& name,
+                                   int u64_columns, int f64_columns) {
+    uint32_t id;
+    if (findSeries(kind, name, id)) {
+        return id;
+    }
+
+    SeriesInfo info;
+    info.id = static_cast<uint32_t>(catalog_.size() + 1);
+    info.kind = kind;
+    info.name = name;
+    info.u64_columns = std::min(u64_columns, kMaxSeriesColumns);
+    info.f64_columns = std::min(f64_columns, kMaxSeriesColumns);
+
+    if (!read_only_) {
+        std::ofstream file((directory_ + "/" + kCatalogFile).c_str(), std::ios::app);
+        file << info.id << '\t' << seriesKindName(kind) << '\t' << name << '\t'
+             << info.u64_columns << '\t' << info.f64_columns << '\n';
+        if (!file) {
+            std::cerr << "Error: Could not update series catalog in " << directory_ << std::endl;
+        }
+    }
+
+    catalog_index_[std::make_pair(static_cast<int>(kind), name)] = info.id;
+    catalog_.push_back(info);
+    return info.id;
+}
+
+// Find a series in the catalog
+bool TimeSeriesStore::findSeries(SeriesKind kind, const std::string& name, uint32_t& id) const {
+    std::map<std::pair<int, std::string>, uint32_t>::const_iterator it =
+        catalog_index_.find(std::make_pair(static_cast<int>(kind), name));
+    if (it == catalog_index_.end()) {
+        return false;
+    }
+    id = it->second;
+    return true;
+}
+
+// Buffer one row, encoding the block once it is full or old enough
+bool TimeSeriesStore::append(uint32_t series_id, int64_t timestamp_ns, const uint64_t* u, const double* f) {
+    if (read_only_ || series_id == 0 || series_id > catalog_.size()) {
+        return false;
+    }
+    const SeriesInfo& info = catalog_[series_id - 1];
+
+    SeriesRow row;
+    memset(&row, 0, sizeof(row));
+    row.timestamp_ns = timestamp_ns;
+    for (int c = 0; c < info.u64_columns; c++) {
+        row.u[c] = u[c];
+    }
+    for (int c = 0; c < info.f64_columns; c++) {
+        row.f[c] = f[c];
+    }
+
+    std::vector<SeriesRow>& rows = pending_[series_id].rows;
+    if (rows.capacity() == 0) {
+        rows.reserve(kBlockRows);
+    }
+    rows.push_back(row);
+
+    if (rows.size() >= kBlockRows || timestamp_ns - rows.front().timestamp_ns >= kBlockFlushNs) {
+        bool ok = writeBlock(series_id, rows);
+        rows.clear();
+        return ok;
+    }
+    return true;
+}
+
+// Encode every partially filled block
+void TimeSeriesStore::flush() {
+    for (std::map<uint32_t, PendingBlock>::iterator it = pending_.begin(); it != pending_.end(); ++it) {
+        if (!it->second.rows.empty()) {
+            writeBlock(it->first, it->second.rows);
+            it->second.rows.clear();
+        }
+    }
+}
+
+// Encode rows column by column and append the block to the current segment
+bool TimeSeriesStore::writeBlock(uint32_t series_id, const std::vector<SeriesRow>& rows) {
+    const SeriesInfo& info = catalog_[series_id - 1];
+    std::vector<uint8_t>& out = encode_buffer_;
+    encodeBlock(series_id, info.u64_columns, info.f64_columns, rows, out);
+    int64_t min_ts = rows.front().timestamp_ns;
+    int64_t max_ts = rows.back().timestamp_ns;
+
+    if (out.size() + sizeof(SegmentHeader) > segment_bytes_) {
+        std::cerr << "Error: Block of " << out.size() << " bytes does not fit in a segment" << std::endl;
+        return false;
+    }
+
+    Segment* segment = segments_.empty() ? nullptr : segments_.back().get();
+    if (segment == nullptr || !segment->writable ||
+        segment->header()->used + out.size() > segment->mapped ||
+        (segment_span_ns_ > 0 && segment->header()->block_count > 0 &&
+         max_ts - segment->header()->min_ts > segment_span_ns_)) {
+        segment = createSegment();
+        if (segment == nullptr) {
+            return false;
+        }
+    }
+
+    // Copy the block first and publish it by advancing used
+    SegmentHeader* segment_header = segment->header();
+    uint64_t used = segment_header->used;
+    memcpy(segment->base + used, &out[0], out.size());
+    segment_header->block_count++;
+    segment_header->min_ts = std::min(segment_header->min_ts, min_ts);
+    segment_header->max_ts = std::max(segment_header->max_ts, max_ts);
+    __atomic_store_n(&segment_header->used, used + out.size(), __ATOMIC_RELEASE);
+    return true;
+}
+
+// Range query: skip segments and blocks by their timestamp bounds, decode
+// only the blocks of the requested series that overlap [from_ns, to_ns]
+bool TimeSeriesStore::query(uint32_t series_id, int64_t from_ns, int64_t to_ns,
+                            const std::function<void(const SeriesRow&)>& visit) const {
+    if (series_id == 0 || series_id > catalog_.size()) {
+        return false;
+    }
+
+    std::vector<SeriesRow> rows;
+    for (size_t s = 0; s < segments_.size(); s++) {
+        const Segment& segment = *segments_[s];
+        const SegmentHeader* header = segment.header();
+        uint64_t used = segment.used();
+        if (header->block_count == 0 || header->max_ts < from_ns || header->min_ts > to_ns) {
+            continue;
+        }
+
+        uint64_t offset = sizeof(SegmentHeader);
+        while (offset + sizeof(BlockHeader) <= used) {
+            const uint8_t* block = segment.base + offset;
+            const BlockHeader* block_header = reinterpret_cast<const BlockHeader*>(block);
+            if (block_header->magic != kBlockMagic || block_header->bytes < sizeof(BlockHeader) ||
+                offset + block_header->bytes > used) {
+                std::cerr << "Warning: Corrupt block in segment " << segment.number << std::endl;
+                break;
+            }
+            offset += block_header->bytes;
+
+            if (block_header->series_id != series_id ||
+                block_header->max_ts < from_ns || block_header->min_ts > to_ns) {
+                continue;
+            }
+            if (!decodeBlock(block, rows)) {
+                std::cerr << "Warning: Could not decode block in segment " << segment.number << std::endl;
+                continue;
+            }
+            for (size_t i = 0; i < rows.size(); i++) {
+                if (rows[i].timestamp_ns >= from_ns && rows[i].timestamp_ns <= to_ns) {
+                    visit(rows[i]);
+                }
+            }
+        }
+    }
+
+    std::map<uint32_t, PendingBlock>::const_iterator pending = pending_.find(series_id);
+    if (pending != pending_.end()) {
+        const std::vector<SeriesRow>& buffered = pending->second.rows;
+        for (size_t i = 0; i < buffered.size(); i++) {
+            if (buffered[i].timestamp_ns >= from_ns && buffered[i].timestamp_ns <= to_ns) {
+                visit(buffered[i]);
+            }
+        }
+    }
+    return true;
+}
+
+// Total segment bytes holding data
+uint64_t TimeSeriesStore::bytesUsed() const {
+    uint64_t total = 0;
+    for (size_t s = 0; s < segments_.size(); s++) {
+        total += segments_[s]->used();
+    }
+    return total;
+}
+
+// Bounds from the segment headers and the rows still buffered
+bool TimeSeriesStore::timeRange(int64_t& first_ns, int64_t& last_ns) const {
+    first_ns = INT64_MAX;
+    last_ns = INT64_MIN;
+    for (size_t s = 0; s < segments_.size(); s++) {
+        const SegmentHeader* header = segments_[s]->header();
+        if (header->block_count > 0) {
+            first_ns = std::min(first_ns, header->min_ts);
+            last_ns = std::max(last_ns, header->max_ts);
+        }
+    }
+    for (std::map<uint32_t, PendingBlock>::const_iterator it = pending_.begin(); it != pending_.end(); ++it) {
+        if (!it->second.rows.empty()) {
+            first_ns = std::min(first_ns, it->second.rows.front().timestamp_ns);
+            last_ns = std::max(last_ns, it->second.rows.back().timestamp_ns);
+        }
+    }
+    return first_ns <= last_ns;
+}
+
+// Retention: unlink old segments whole, never rewriting live data
+int TimeSeriesStore::dropSegmentsBefore(int64_t cutoff_ns) {
+    if (read_only_) {
+        return 0;
+    }
+
+    int dropped = 0;
+    for (size_t s = 0; s < segments_.size();) {
+        const Segment& segment = *segments_[s];
+        const SegmentHeader* header = segment.header();
+        if (segment.writable || header->block_count == 0 || header->max_ts >= cutoff_ns) {
+            s++;
+            continue;
+        }
+        std::string path = segmentPath(directory_, segment.number);
+        if (unlink(path.c_str()) != 0) {
+            std::cerr << "Warning: Could not remove segment " << path << ": " << strerror(errno) << std::endl;
+            s++;
+            continue;
+        }
+        segments_.erase(segments_.begin() + s);
+        dropped++;
+    }
+    return dropped;
+}
+
+// Round-trip synthetic blocks through the encoder and decoder: irregular and
+// backwards timestamps, counter resets and wraparound, and gauges including
+// signed zeros, NaN, infinities and denormals. Values must come back bit
+// for bit.
+bool TimeSeriesStore::checkCodec(std::ostream& report) {
+    const int u64_columns = 3;
+    const int f64_columns = 3;
+    const double kSpecial[] = {
+        0.0, -0.0, std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity(),
+        -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::denorm_min(),
+        std::numeric_limits<double>::max(), -1.5, 1e-300, 123456.789
+    };
+    const size_t kSpecialCount = sizeof(kSpecial) / sizeof(kSpecial[0]);
+    const size_t sizes[] = { 1, 2, 17, kBlockRows };
+
+    uint64_t random = 88172645463325252ULL;
+    auto next = [&random]() {
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        return random;
+    };
+
+    std::vector<uint8_t> block;
+    std::vector<SeriesRow> decoded;
+    size_t checked = 0;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        std::vector<SeriesRow> rows(sizes[s]);
+        int64_t ts = 1700000000000000000LL;
+        for (size_t i = 0; i < rows.size(); i++) {
+            SeriesRow& row = rows[i];
+            memset(&row, 0, sizeof(row));
+
+            // Mostly regular with jitter, plus gaps and steps backwards
+            if (i % 50 == 7) {
+                ts -= 5000000000LL;
+            } else if (i % 50 == 31) {
+                ts += 86400LL * 365 * 1000000000LL;
+            } else {
+                ts += 1000000000LL + static_cast<int64_t>(next() % 2000000) - 1000000;
+            }
+            row.timestamp_ns = ts;
+
+            uint64_t previous = i == 0 ? 0 : rows[i - 1].u[0];
+            row.u[0] = (i % 40 == 20) ? 0 : previous + next() % 100000;      // Counter with resets
+            row.u[1] = std::numeric_limits<uint64_t>::max() - 3 + i;            // Wraps past zero
+            row.u[2] = next();                                                  // Arbitrary jumps
+
+            row.f[0] = kSpecial[i % kSpecialCount];
+            row.f[1] = (i / 3) * 0.25;                                          // Repeated values
+            uint64_t bits = next();
+            memcpy(&row.f[2], &bits, sizeof(bits));                             // Any bit pattern
+        }
+
+        encodeBlock(1, u64_columns, f64_columns, rows, block);
+        if (!decodeBlock(&block[0], decoded) || decoded.size() != rows.size()) {
+            report << "Store codec: block of " << rows.size() << " rows does not decode" << std::endl;
+            return false;
+        }
+        for (size_t i = 0; i < rows.size(); i++) {
+            bool same = decoded[i].timestamp_ns == rows[i].timestamp_ns;
+            for (int c = 0; c < u64_columns; c++) {
+                same = same && decoded[i].u[c] == rows[i].u[c];
+            }
+            for (int c = 0; c < f64_columns; c++) {
+                same = same && doubleBits(decoded[i].f[c]) == doubleBits(rows[i].f[c]);
+            }
+            if (!same) {
+                report << "Store codec: row " << i << " of a " << rows.size()
+                       << "-row block differs after decoding" << std::endl;
+                return false;
+            }
+        }
+        checked += rows.size();
+    }
+
+    report << "Store codec: " << checked << " rows round-tripped" << std::endl;
+    return true;
+}